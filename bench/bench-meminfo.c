@@ -0,0 +1,122 @@
+/* ========================================================================= *
+ * File: bench-meminfo.c, part of sp-memusage
+ *
+ * Copyright (C) 2005-2009 by Nokia Corporation
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ *
+ * Description:
+ *    Compares the single pass meminfo parser against the previous
+ *    fopen/fgets/strstr implementation on a captured meminfo file.
+ *
+ *    usage: bench-meminfo [meminfo file] [iterations]
+ *
+ * ========================================================================= */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../src/mem-monitor-util.h"
+
+#define CAPACITY(a)  (sizeof(a) / sizeof(*a))
+
+/* The parser used before the persistent descriptor/lookup table one */
+static unsigned
+parse_meminfo_reference(const char* path, MEMINFO* wanted, unsigned size)
+{
+	static char line[256];
+	unsigned counter = 0;
+	FILE* meminfo = fopen(path, "r");
+	if (!meminfo) return 0;
+	while (fgets(line, sizeof(line), meminfo)) {
+		unsigned idx;
+		for (idx=0; idx < size; ++idx) {
+			const char* key = wanted[idx].key;
+			if (line == strstr(line, key)) {
+				wanted[idx].value = (unsigned)
+					strtoul(line+strlen(key)+1, NULL, 0);
+				if (++counter == size) goto done;
+				continue;
+			}
+		}
+	}
+done:
+	fclose(meminfo);
+	return counter;
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+	/* same keys as mem-monitor uses */
+	static MEMINFO ref[] = {
+		{ "MemTotal:",  0 }, { "SwapTotal:", 0 }, { "MemFree:",   0 },
+		{ "Buffers:",   0 }, { "Cached:",    0 }, { "SwapCached:",0 },
+		{ "SwapFree:",  0 }
+	};
+	static MEMINFO vals[] = {
+		{ "MemTotal:",  0 }, { "SwapTotal:", 0 }, { "MemFree:",   0 },
+		{ "Buffers:",   0 }, { "Cached:",    0 }, { "SwapCached:",0 },
+		{ "SwapFree:",  0 }
+	};
+	const char* path = argc > 1 ? argv[1] : "bench/meminfo.fixture";
+	unsigned iterations = argc > 2 ? strtoul(argv[2], NULL, 0) : 100000;
+	unsigned i, found_ref = 0, found = 0;
+	double start, time_ref, time_new;
+
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		perror(path);
+		return 1;
+	}
+
+	start = now();
+	for (i = 0; i < iterations; i++) {
+		found_ref = parse_meminfo_reference(path, ref, CAPACITY(ref));
+	}
+	time_ref = now() - start;
+
+	start = now();
+	for (i = 0; i < iterations; i++) {
+		found = parse_meminfo_fd(fd, vals, CAPACITY(vals));
+	}
+	time_new = now() - start;
+	close(fd);
+
+	for (i = 0; i < CAPACITY(vals); i++) {
+		if (ref[i].value != vals[i].value) {
+			fprintf(stderr, "ERROR: %s %u != %u\n", vals[i].key, vals[i].value, ref[i].value);
+			return 1;
+		}
+	}
+	if (found != found_ref) {
+		fprintf(stderr, "ERROR: found %u keys, reference %u\n", found, found_ref);
+		return 1;
+	}
+
+	printf("%u iterations on %s\n", iterations, path);
+	printf("fopen/fgets/strstr: %8.0f ns/call\n", time_ref * 1e9 / iterations);
+	printf("pread/lookup:       %8.0f ns/call (%.1fx)\n", time_new * 1e9 / iterations,
+			time_ref / time_new);
+	return 0;
+}
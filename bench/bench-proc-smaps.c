@@ -0,0 +1,119 @@
+/* ========================================================================= *
+ * File: bench-proc-smaps.c, part of sp-memusage
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ *
+ * Description:
+ *    Compares the per-sample cost of the mem-cpu-monitor process
+ *    collectors: libspmeasure, the smaps collector reading smaps_rollup
+ *    and the smaps collector summing the per-mapping smaps (the fallback
+ *    for old kernels).  The benchmark process maps the given number of
+ *    separate memory areas and samples itself.
+ *
+ *    usage: bench-proc-smaps [mappings] [samples]
+ *
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <sp_measure.h>
+
+#include "../src/proc_smaps.h"
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* maps separate areas, alternating protections keep them from merging */
+static int
+map_areas(int count)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	char* base = mmap(NULL, count * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	int i;
+	if (base == MAP_FAILED) return -1;
+	for (i = 0; i < count; i++) {
+		base[i * page] = 1;
+		if (i & 1) mprotect(base + i * page, page, PROT_READ);
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int mappings = argc > 1 ? atoi(argv[1]) : 20000;
+	int samples = argc > 2 ? atoi(argv[2]) : 20;
+	sp_measure_proc_data_t data;
+	proc_smaps_t smaps;
+	proc_sample_t sample;
+	double start, time_spmeasure, time_rollup, time_smaps;
+	char path[64];
+	int i;
+
+	if (map_areas(mappings) != 0) {
+		perror("ERROR: failed to map memory");
+		return 1;
+	}
+
+	/* libspmeasure */
+	if (sp_measure_init_proc_data(&data, getpid(), SNAPSHOT_PROC, NULL) != 0) {
+		fprintf(stderr, "ERROR: failed to initialize libspmeasure process data\n");
+		return 1;
+	}
+	start = now();
+	for (i = 0; i < samples; i++) sp_measure_get_proc_data(&data, SNAPSHOT_PROC, NULL);
+	time_spmeasure = now() - start;
+	printf("libspmeasure:   dirty %8d kB\n", FIELD_PROC_MEM_PRIVATE_DIRTY(&data));
+	sp_measure_free_proc_data(&data);
+
+	/* smaps collector with smaps_rollup */
+	if (proc_smaps_open(&smaps, getpid()) != 0 || !smaps.is_rollup) {
+		fprintf(stderr, "ERROR: smaps_rollup is not available\n");
+		return 1;
+	}
+	start = now();
+	for (i = 0; i < samples; i++) proc_smaps_read(&smaps, &sample);
+	time_rollup = now() - start;
+	printf("smaps_rollup:   dirty %8d kB\n", sample.dirty);
+
+	/* smaps collector summing smaps */
+	close(smaps.fd);
+	sprintf(path, "/proc/%d/smaps", getpid());
+	smaps.fd = open(path, O_RDONLY);
+	smaps.is_rollup = false;
+	start = now();
+	for (i = 0; i < samples; i++) proc_smaps_read(&smaps, &sample);
+	time_smaps = now() - start;
+	printf("smaps:          dirty %8d kB\n", sample.dirty);
+	proc_smaps_close(&smaps);
+
+	printf("%d mappings, %d samples\n", mappings, samples);
+	printf("libspmeasure:   %10.3f ms/sample\n", time_spmeasure * 1e3 / samples);
+	printf("smaps_rollup:   %10.3f ms/sample (%.1fx)\n", time_rollup * 1e3 / samples,
+			time_spmeasure / time_rollup);
+	printf("smaps:          %10.3f ms/sample (%.1fx)\n", time_smaps * 1e3 / samples,
+			time_spmeasure / time_smaps);
+	return 0;
+}
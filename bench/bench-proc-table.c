@@ -0,0 +1,141 @@
+/* ========================================================================= *
+ * File: bench-proc-table.c, part of sp-memusage
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ *
+ * Description:
+ *    Scaling benchmark of the monitored process bookkeeping: compares the
+ *    hash indexed process table against the singly linked list previously
+ *    used by mem-cpu-monitor.  Every simulated update checks all running
+ *    processes for being monitored (as --name does) and replaces a part of
+ *    the monitored processes with new ones.
+ *
+ *    usage: bench-proc-table [processes] [updates] [churn %]
+ *
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/proc_table.h"
+
+/* the linked list process bookkeeping used before proc_table */
+typedef struct proc_t {
+	int pid;
+	struct proc_t* next;
+} proc_t;
+
+static proc_t* list = NULL;
+
+static void
+list_add(int pid)
+{
+	proc_t* proc = calloc(1, sizeof(proc_t));
+	proc->pid = pid;
+	if (list == NULL) {
+		list = proc;
+	}
+	else {
+		proc_t* next = list;
+		while (next->next != NULL) {
+			next = next->next;
+		}
+		next->next = proc;
+	}
+}
+
+static int
+list_exists(int pid)
+{
+	proc_t* proc;
+	for (proc = list; proc; proc = proc->next) {
+		if (proc->pid == pid) return 1;
+	}
+	return 0;
+}
+
+static void
+list_remove(int pid)
+{
+	proc_t** pproc = &list;
+	while (*pproc && (*pproc)->pid != pid) {
+		pproc = &(*pproc)->next;
+	}
+	if (*pproc) {
+		proc_t* proc = *pproc;
+		*pproc = proc->next;
+		free(proc);
+	}
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+	int count = argc > 1 ? atoi(argv[1]) : 10000;
+	int updates = argc > 2 ? atoi(argv[2]) : 20;
+	int churn = count * (argc > 3 ? atoi(argv[3]) : 1) / 100;
+	proc_table_t table = {0};
+	int i, update, next_pid;
+	long found_list = 0, found_table = 0;
+	double start, time_list, time_table;
+
+	/* linked list */
+	start = now();
+	for (i = 0; i < count; i++) list_add(i + 1);
+	for (update = 0, next_pid = count + 1; update < updates; update++) {
+		/* process scan, all running processes are checked */
+		for (i = next_pid - count; i < next_pid; i++) found_list += list_exists(i);
+		/* the oldest processes exit, new ones are started */
+		for (i = 0; i < churn; i++) {
+			list_remove(next_pid - count);
+			list_add(next_pid++);
+		}
+	}
+	time_list = now() - start;
+
+	/* process table */
+	start = now();
+	for (i = 0; i < count; i++) proc_table_add(&table, i + 1, 1000 + i, &table);
+	for (update = 0, next_pid = count + 1; update < updates; update++) {
+		for (i = next_pid - count; i < next_pid; i++) found_table += proc_table_find(&table, i, 0) != NULL;
+		for (i = 0; i < churn; i++) {
+			proc_table_remove(&table, next_pid - count, 0);
+			proc_table_add(&table, next_pid, 1000 + next_pid, &table);
+			next_pid++;
+		}
+		proc_table_compact(&table);
+	}
+	time_table = now() - start;
+	proc_table_free(&table);
+
+	if (found_list != found_table) {
+		fprintf(stderr, "ERROR: found %ld processes, linked list %ld\n", found_table, found_list);
+		return 1;
+	}
+	printf("%d monitored processes, %d updates, %d processes replaced per update\n",
+			count, updates, churn);
+	printf("linked list:   %10.3f ms/update\n", time_list * 1e3 / updates);
+	printf("process table: %10.3f ms/update (%.0fx)\n", time_table * 1e3 / updates,
+			time_list / time_table);
+	return 0;
+}
@@ -0,0 +1,283 @@
+/* ========================================================================= *
+ * File: bench-sp-report.c, part of sp-memusage
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ *
+ * Description:
+ *    Data row rendering benchmark: compares the flattened row layout of
+ *    sp_report_print_data() against the recursive header tree walk it
+ *    replaced.  The report has process-like column groups of 4 columns
+ *    each, with every other group colored as in mem-cpu-monitor.  Both
+ *    renderers write into the same file and their output is compared.
+ *    The same report is then built from typed value columns and its
+ *    table and CSV output is compared and timed against the snprintf()
+ *    callback columns.  Finally process column churn is timed by
+ *    replacing randomly selected column groups with new ones.
+ *
+ *    usage: bench-sp-report [rows] [columns] [output file]
+ *
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/sp_report.h"
+
+#define MAX_COLUMN_SIZE 256
+
+static int counter = 0;
+
+static int
+write_value(char* buffer, int size, void* arg)
+{
+	return snprintf(buffer, size + 1, "%8d", (int)(long)arg + counter);
+}
+
+static void
+get_value(sp_report_value_t* value, void* arg)
+{
+	value->type = SP_REPORT_VALUE_INT;
+	value->i = (int)(long)arg + counter;
+}
+
+/*
+ * The recursive renderer used before the flattened layout.
+ */
+
+static void
+ref_write_aligned_text(char* buffer, const char* text, int size, int alignment)
+{
+	int pos = 0;
+	int len = strlen(text);
+	memset(buffer, ' ', size);
+	buffer[size] = '\0';
+	if (len <= size) {
+		if (alignment == SP_REPORT_ALIGN_RIGHT) {
+			pos = size - len;
+		}
+		else if (alignment == SP_REPORT_ALIGN_CENTER) {
+			pos = (size - len) / 2;
+		}
+	}
+	else {
+		if (size > 0) buffer[--size] = '>';
+		len = size;
+	}
+	memcpy(buffer + pos, text, len);
+}
+
+static void
+ref_print_data(FILE* fp, const sp_report_header_t* header)
+{
+	char buffer[MAX_COLUMN_SIZE];
+	if (header->print) {
+		char data[MAX_COLUMN_SIZE];
+		int size = header->print(data, header->size, header->data);
+		data[size] = '\0';
+		ref_write_aligned_text(buffer, data, header->size_print, header->alignment);
+	}
+	else {
+		ref_write_aligned_text(buffer, "", header->size_print, 0);
+	}
+	fputs(buffer, fp);
+}
+
+static void
+ref_iterate_level(const sp_report_header_t* header, FILE* fp)
+{
+	if (header->color_prefix) fputs(header->color_prefix, fp);
+	if (header->child) {
+		ref_iterate_level(header->child, fp);
+	}
+	else {
+		ref_print_data(fp, header);
+	}
+	if (header->color_postfix) fputs(header->color_postfix, fp);
+	if (header->parent->parent && header->next) {
+		ref_iterate_level(header->next, fp);
+	}
+}
+
+static void
+ref_print_row(FILE* fp, const sp_report_header_t* root)
+{
+	const sp_report_header_t* header;
+	for (header = root->child; header; header = header->next) {
+		ref_iterate_level(header, fp);
+		if (header->next) fputc(' ', fp);
+	}
+	fputc('\n', fp);
+	fflush(fp);
+}
+
+static sp_report_header_t*
+add_group(sp_report_header_t* root, int index, bool typed)
+{
+	char title[64];
+	int j;
+	sprintf(title, "PID %d process", 1000 + index);
+	sp_report_header_t* group = sp_report_header_add_child(root, title, 30, SP_REPORT_ALIGN_LEFT, NULL, NULL);
+	sprintf(title, "pid%d", 1000 + index);
+	sp_report_header_set_key(group, title);
+	for (j = 0; j < 4; j++) {
+		sprintf(title, "column%d:", j);
+		if (typed) {
+			sp_report_header_add_value_child(group, title, 8, SP_REPORT_ALIGN_RIGHT, get_value, NULL, (void*)(long)(index * 4 + j));
+		}
+		else {
+			sp_report_header_add_child(group, title, 8, SP_REPORT_ALIGN_RIGHT, write_value, (void*)(long)(index * 4 + j));
+		}
+	}
+	if (!(index & 1)) sp_report_header_set_color(group, "\033[32m", "\033[0m");
+	return group;
+}
+
+static void
+build_report(sp_report_header_t* root, int columns, bool typed, sp_report_header_t** groups)
+{
+	int i;
+	memset(root, 0, sizeof(*root));
+	for (i = 0; i < columns / 4; i++) {
+		sp_report_header_t* group = add_group(root, i, typed);
+		if (groups) groups[i] = group;
+	}
+}
+
+/*
+ * Renders a row of both reports and checks that the outputs match.
+ */
+static int
+compare_rows(sp_report_header_t* root1, sp_report_header_t* root2,
+		int (*print)(FILE*, sp_report_header_t*))
+{
+	char *text1, *text2;
+	size_t size1, size2;
+	int rc = 0;
+	FILE* fp1 = open_memstream(&text1, &size1);
+	FILE* fp2 = open_memstream(&text2, &size2);
+	print(fp1, root1);
+	print(fp2, root2);
+	fclose(fp1);
+	fclose(fp2);
+	if (size1 != size2 || memcmp(text1, text2, size1)) rc = -1;
+	free(text1);
+	free(text2);
+	return rc;
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+	int rows = argc > 1 ? atoi(argv[1]) : 100000;
+	int columns = argc > 2 ? atoi(argv[2]) : 200;
+	const char* path = argc > 3 ? argv[3] : "/dev/null";
+	sp_report_header_t root, typed_root;
+	double start, time_ref, time_layout, time_typed, time_csv, time_typed_csv, time_churn;
+	FILE* fp;
+
+	/* build reports similar to mem-cpu-monitor process columns */
+	sp_report_header_t** groups = calloc(columns / 4 + 1, sizeof(sp_report_header_t*));
+	build_report(&root, columns, false, NULL);
+	build_report(&typed_root, columns, true, groups);
+
+	/* check that both renderers produce the same output */
+	char* ref_text = NULL;
+	char* layout_text = NULL;
+	size_t ref_size, layout_size;
+	FILE* tmp = tmpfile();
+	sp_report_print_header(tmp, &root);
+	ref_print_row(tmp, &root);
+	ref_size = ftell(tmp);
+	sp_report_print_data(tmp, &root);
+	layout_size = ftell(tmp) - ref_size;
+	rewind(tmp);
+	ref_text = malloc(ref_size + layout_size);
+	if (fread(ref_text, 1, ref_size + layout_size, tmp) != ref_size + layout_size) return 1;
+	fclose(tmp);
+	layout_text = ref_text + ref_size;
+	ref_text = strchr(ref_text, '\n') + 1;
+	ref_text = strchr(ref_text, '\n') + 1;
+	ref_text = strchr(ref_text, '\n') + 1;
+	if (strncmp(ref_text, layout_text, layout_size)) {
+		fprintf(stderr, "ERROR: the rendered rows differ\n");
+		return 1;
+	}
+	if (compare_rows(&root, &typed_root, sp_report_print_data) != 0 ||
+			compare_rows(&root, &typed_root, sp_report_print_data_csv) != 0) {
+		fprintf(stderr, "ERROR: the typed value rows differ\n");
+		return 1;
+	}
+
+	if ( (fp = fopen(path, "w")) == NULL) {
+		perror("ERROR: failed to open output file");
+		return 1;
+	}
+
+	start = now();
+	for (counter = 0; counter < rows; counter++) ref_print_row(fp, &root);
+	time_ref = now() - start;
+
+	start = now();
+	for (counter = 0; counter < rows; counter++) sp_report_print_data(fp, &root);
+	time_layout = now() - start;
+
+	start = now();
+	for (counter = 0; counter < rows; counter++) sp_report_print_data(fp, &typed_root);
+	time_typed = now() - start;
+
+	start = now();
+	for (counter = 0; counter < rows; counter++) sp_report_print_data_csv(fp, &root);
+	time_csv = now() - start;
+
+	start = now();
+	for (counter = 0; counter < rows; counter++) sp_report_print_data_csv(fp, &typed_root);
+	time_typed_csv = now() - start;
+
+	fclose(fp);
+
+	/* replace column groups in random order, similar to short living processes */
+	srand(1);
+	start = now();
+	for (counter = 0; counter < rows; counter++) {
+		int index = rand() % (columns / 4);
+		sp_report_header_remove(&typed_root, groups[index]);
+		sp_report_header_free(groups[index]);
+		groups[index] = add_group(&typed_root, counter, true);
+	}
+	time_churn = now() - start;
+	free(groups);
+
+	sp_report_free(&root);
+	sp_report_free(&typed_root);
+
+	printf("%d rows, %d columns\n", rows, columns);
+	printf("recursive walk:  %8.3f us/row\n", time_ref * 1e6 / rows);
+	printf("flattened rows:  %8.3f us/row (%.1fx)\n", time_layout * 1e6 / rows, time_ref / time_layout);
+	printf("typed values:    %8.3f us/row (%.1fx)\n", time_typed * 1e6 / rows, time_ref / time_typed);
+	printf("csv callbacks:   %8.3f us/row\n", time_csv * 1e6 / rows);
+	printf("csv typed:       %8.3f us/row (%.1fx)\n", time_typed_csv * 1e6 / rows, time_csv / time_typed_csv);
+	printf("column churn:    %8.3f us/group\n", time_churn * 1e6 / rows);
+	return 0;
+}
@@ -0,0 +1,125 @@
+/* ========================================================================= *
+ * File: bench-top-view.c, part of sp-memusage
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ *
+ * Description:
+ *    Terminal output volume of the full screen view: compares the bytes
+ *    sent per frame when only the changed cells are updated against
+ *    repainting the whole screen and against the scrolling mem-cpu-monitor
+ *    table line with the same processes.  On every frame the given
+ *    percentage of the processes change their memory and CPU values, the
+ *    rest stay idle as most processes do.
+ *
+ *    usage: bench-top-view [processes] [frames] [changed %] [rows] [cols]
+ *
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../src/top_view.h"
+
+typedef struct proc_t {
+	int pid;
+	int clean;
+	int dirty;
+	int change;
+	double cpu;
+} proc_t;
+
+static void
+draw(top_view_t* view, const proc_t* procs, int count, int frame)
+{
+	int i;
+	top_view_clear(view);
+	top_view_printf(view, 0, 0, "mem-cpu-monitor - 12:00:%02d.%03d  processes: %d", frame / 2 % 60, frame % 2 * 500, count);
+	top_view_printf(view, 1, 0, "memory used: %d kB (%+d)  CPU: %.1f%%  1000 MHz", 500000 + frame % 7, frame % 7 - 3, (frame % 13) * 1.5);
+	top_view_printf(view, 4, 0, "%7s %-24s %9s %9s %8s %6s", "PID", "NAME", "CLEAN", "DIRTY", "CHANGE", "CPU-%");
+	top_view_highlight(view, 4);
+	for (i = 0; i < count && 5 + i < view->rows; i++) {
+		top_view_printf(view, 5 + i, 0, "%7d %-24.24s %9d %9d %+8d %5.1f%%", procs[i].pid, "process",
+				procs[i].clean, procs[i].dirty, procs[i].change, procs[i].cpu);
+	}
+	top_view_flush(view);
+}
+
+int main(int argc, char** argv)
+{
+	int count = argc > 1 ? atoi(argv[1]) : 200;
+	int frames = argc > 2 ? atoi(argv[2]) : 1000;
+	int changed = argc > 3 ? atoi(argv[3]) : 10;
+	int rows = argc > 4 ? atoi(argv[4]) : 50;
+	int cols = argc > 5 ? atoi(argv[5]) : 132;
+	unsigned long long bytes_diff, bytes_full, bytes_line = 0;
+	top_view_t view;
+	int i, frame;
+
+	proc_t* procs = calloc(count, sizeof(proc_t));
+	for (i = 0; i < count; i++) {
+		procs[i].pid = 1000 + i * 7;
+		procs[i].clean = 100 + i;
+		procs[i].dirty = 1000 + i * 3;
+	}
+
+	int fd = open("/dev/null", O_WRONLY);
+	if (fd == -1 || top_view_init(&view, fd, -1) != 0) {
+		fprintf(stderr, "ERROR: failed to initialize the view\n");
+		return 1;
+	}
+	/* /dev/null has no size, so use the requested screen size */
+	top_view_set_size(&view, rows, cols);
+
+	for (int pass = 0; pass < 2; pass++) {
+		view.bytes_written = 0;
+		for (frame = 0; frame < frames; frame++) {
+			for (i = 0; i < count; i++) {
+				srand(frame * count + i);
+				if (rand() % 100 < changed) {
+					procs[i].change = rand() % 200 - 100;
+					procs[i].dirty += procs[i].change;
+					procs[i].cpu = (rand() % 1000) / 10.0;
+				}
+				else {
+					procs[i].change = 0;
+					procs[i].cpu = 0;
+				}
+				if (pass == 0) {
+					/* the mem-cpu-monitor table line has 4 columns per process */
+					char buffer[64];
+					bytes_line += snprintf(buffer, sizeof(buffer), "%8d%8d%+8d%6.1f%% ",
+							procs[i].clean, procs[i].dirty, procs[i].change, procs[i].cpu);
+				}
+			}
+			/* the second pass repaints the whole screen every frame */
+			if (pass == 1) view.is_invalid = true;
+			draw(&view, procs, count, frame);
+		}
+		if (pass == 0) bytes_diff = view.bytes_written;
+		else bytes_full = view.bytes_written;
+	}
+	top_view_release(&view);
+	close(fd);
+	free(procs);
+
+	printf("%d processes, %d frames, %d%% changed per frame, %dx%d screen\n", count, frames, changed, cols, rows);
+	printf("changed cells:   %8.0f bytes/frame\n", (double)bytes_diff / frames);
+	printf("full repaint:    %8.0f bytes/frame (%.1fx)\n", (double)bytes_full / frames, (double)bytes_full / bytes_diff);
+	printf("table line:      %8.0f bytes/frame (%.1fx)\n", (double)bytes_line / frames, (double)bytes_line / bytes_diff);
+	return 0;
+}
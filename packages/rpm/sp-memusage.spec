@@ -43,6 +43,7 @@ rm -rf %{buildroot}
 %{_bindir}/mem-smaps-*
 %{_bindir}/mem-dirty-code-pages
 %{_bindir}/run-with-mallinfo
+%{_bindir}/mallinfo-replay
 %{_bindir}/run-with-memusage
 %{_libdir}/mallinfo*
 %{_mandir}/man1/mem-cpu-monitor.1.gz
@@ -53,6 +54,7 @@ rm -rf %{buildroot}
 %{_mandir}/man1/mem-monitor-smaps.1.gz
 %{_mandir}/man1/mem-smaps-private.1.gz
 %{_mandir}/man1/run-with-mallinfo.1.gz
+%{_mandir}/man1/mallinfo-replay.1.gz
 %doc COPYING README
 
 
@@ -0,0 +1,81 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file alloc_trace.h
+ * Binary format of the allocation event traces.
+ *
+ * The mallinfo.so recorder writes the allocation events of every thread
+ * into a file of its own, mallinfo-PID.TID.alloc, through a memory mapped
+ * window. The file starts with the header followed by the fixed size
+ * events in the thread's call order. The file is extended in window
+ * sized steps and never truncated, so the unused zero filled end of the
+ * last window is recognized by the zero event type. A thread which gets
+ * the identifier of an exited thread writes mallinfo-PID.TID-N.alloc
+ * instead, so no trace is overwritten. The event times of
+ * all the thread files of the process are relative to the same start
+ * time, so the files can be merged into a single event stream.
+ */
+#ifndef ALLOC_TRACE_H
+#define ALLOC_TRACE_H
+
+#include <stdint.h>
+
+#define ALLOC_TRACE_MAGIC          "SPALLOC"
+#define ALLOC_TRACE_VERSION        1
+
+/* the event types, the zero type ends the trace */
+enum {
+	ALLOC_TRACE_END = 0,
+	ALLOC_TRACE_MALLOC,
+	ALLOC_TRACE_CALLOC,
+	ALLOC_TRACE_REALLOC,
+	ALLOC_TRACE_FREE,
+	ALLOC_TRACE_MEMALIGN,
+};
+
+/* the event time and type are packed into single field */
+#define ALLOC_TRACE_TYPE_BITS      8
+#define ALLOC_TRACE_TYPE(value)    ((unsigned)((value) & ((1 << ALLOC_TRACE_TYPE_BITS) - 1)))
+#define ALLOC_TRACE_TIME(value)    ((value) >> ALLOC_TRACE_TYPE_BITS)
+#define ALLOC_TRACE_PACK(time, type)  (((uint64_t)(time) << ALLOC_TRACE_TYPE_BITS) | (type))
+
+/**
+ * The trace file header.
+ */
+typedef struct alloc_trace_header_t {
+	char magic[8];
+	uint32_t version;
+	/* the process and thread identifiers */
+	uint32_t pid;
+	uint32_t tid;
+	uint32_t reserved;
+	/* the trace start time, nanoseconds of CLOCK_MONOTONIC */
+	uint64_t start;
+} alloc_trace_header_t;
+
+/**
+ * The allocation event.
+ */
+typedef struct alloc_trace_event_t {
+	/* the nanoseconds since the trace start and the event type */
+	uint64_t time_type;
+	/* the allocated or the freed block address */
+	uint64_t ptr;
+	/* the reallocated block address or the alignment */
+	uint64_t arg;
+	/* the requested size, nmemb * size for calloc */
+	uint64_t size;
+} alloc_trace_event_t;
+
+#endif
@@ -0,0 +1,532 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "flight_recorder.h"
+
+/**
+ * Private API
+ */
+
+/**
+ * The report schema, shared by the samples referring to it.
+ */
+struct flight_recorder_schema_t {
+	/* number of samples and recorders referring to the schema */
+	int refs;
+	/* the encoded schema payload */
+	unsigned char* data;
+	int size;
+};
+
+/**
+ * Releases a schema reference.
+ *
+ * @param[in] schema  the schema, can be NULL.
+ */
+static void schema_unref(
+		flight_recorder_schema_t* schema
+		)
+{
+	if (schema && --schema->refs == 0) {
+		free(schema->data);
+		free(schema);
+	}
+}
+
+/**
+ * Creates the schema of the report header structure.
+ *
+ * @param[in] root   the report root header.
+ * @return           the schema with single reference or NULL in the
+ *                   case of failure.
+ */
+static flight_recorder_schema_t* schema_create(
+		sp_report_header_t* root
+		)
+{
+	report_schema_t layout;
+	if (report_schema_init(&layout, root) != 0) return NULL;
+
+	flight_recorder_schema_t* schema = malloc(sizeof(flight_recorder_schema_t));
+	if (schema) {
+		schema->refs = 1;
+		if (report_schema_encode(&layout, &schema->data, &schema->size) != 0) {
+			free(schema);
+			schema = NULL;
+		}
+	}
+	report_schema_free(&layout);
+	return schema;
+}
+
+/**
+ * Reserves space in the slot payload buffer.
+ *
+ * @param[in] slot   the slot.
+ * @param[in] size   the additional space.
+ * @return           the reserved space or NULL in the case of failure.
+ */
+static char* slot_reserve(
+		flight_recorder_slot_t* slot,
+		int size
+		)
+{
+	if (slot->size + size > slot->capacity) {
+		int capacity = slot->capacity ? slot->capacity : 256;
+		while (capacity < slot->size + size) capacity *= 2;
+		char* data = realloc(slot->data, capacity);
+		if (!data) return NULL;
+		slot->data = data;
+		slot->capacity = capacity;
+	}
+	char* ptr = slot->data + slot->size;
+	slot->size += size;
+	return ptr;
+}
+
+/**
+ * Appends data to the slot payload.
+ *
+ * @param[in] slot   the slot.
+ * @param[in] data   the data.
+ * @param[in] size   the data size.
+ * @return           0 for success.
+ */
+static int slot_append(
+		flight_recorder_slot_t* slot,
+		const void* data,
+		int size
+		)
+{
+	char* ptr = slot_reserve(slot, size);
+	if (!ptr) return -ENOMEM;
+	memcpy(ptr, data, size);
+	return 0;
+}
+
+/**
+ * Writes a record into the dump file.
+ *
+ * @param[in] fp     the output file.
+ * @param[in] type   the record type.
+ * @param[in] data   the record payload.
+ * @param[in] size   the payload size.
+ * @return           0 for success.
+ */
+static int write_record(
+		FILE* fp,
+		uint8_t type,
+		const void* data,
+		uint32_t size
+		)
+{
+	if (fwrite(&type, sizeof(type), 1, fp) != 1 ||
+			fwrite(&size, sizeof(size), 1, fp) != 1 ||
+			fwrite(data, 1, size, fp) != size) return -EIO;
+	return 0;
+}
+
+/**
+ * Reads data from the dump file.
+ *
+ * @param[in] fp     the dump file.
+ * @param[out] data  the read data.
+ * @param[in] size   the data size.
+ * @return           0 for success, -EINVAL if the file ends.
+ */
+static int read_data(
+		FILE* fp,
+		void* data,
+		size_t size
+		)
+{
+	if (fread(data, 1, size, fp) != size) return ferror(fp) ? -EIO : -EINVAL;
+	return 0;
+}
+
+/**
+ * Reads a record payload into a buffer.
+ *
+ * @param[in] fp             the dump file.
+ * @param[in,out] buffer     the buffer.
+ * @param[in,out] capacity   the buffer capacity.
+ * @param[out] size          the payload size.
+ * @return                   0 for success.
+ */
+static int read_payload(
+		FILE* fp,
+		char** buffer,
+		int* capacity,
+		uint32_t* size
+		)
+{
+	int rc;
+	if ( (rc = read_data(fp, size, sizeof(*size))) != 0) return rc;
+	if ((int)*size < 0) return -EINVAL;
+	if ((int)*size > *capacity) {
+		char* data = realloc(*buffer, *size);
+		if (!data) return -ENOMEM;
+		*buffer = data;
+		*capacity = *size;
+	}
+	return read_data(fp, *buffer, *size);
+}
+
+/**
+ * Parses the schema payload.
+ *
+ * @param[in] self   the reader.
+ * @param[in] size   the payload size.
+ * @return           0 for success.
+ */
+static int reader_parse_schema(
+		flight_recorder_reader_t* self,
+		uint32_t size
+		)
+{
+	report_schema_t schema;
+	int rc;
+
+	if ( (rc = report_schema_decode(&schema, (const unsigned char*)self->schema_data, size)) != 0) return rc;
+	/* the schema is replaced only when the value array has room for its
+	 * columns */
+	sp_report_value_t* values = realloc(self->values, (schema.column_count + 1) * sizeof(sp_report_value_t));
+	if (!values) {
+		report_schema_free(&schema);
+		return -ENOMEM;
+	}
+	self->values = values;
+	report_schema_free(&self->schema);
+	self->schema = schema;
+	return 0;
+}
+
+/**
+ * Parses the sample payload into the sample time and values.
+ *
+ * @param[in] self   the reader.
+ * @param[in] size   the payload size.
+ * @return           0 for success.
+ */
+static int reader_parse_sample(
+		flight_recorder_reader_t* self,
+		uint32_t size
+		)
+{
+	const char* ptr = self->sample;
+	const char* end = self->sample + size;
+	uint16_t count;
+
+	if (size < sizeof(self->time) + sizeof(count)) return -EINVAL;
+	memcpy(&self->time, ptr, sizeof(self->time));
+	ptr += sizeof(self->time);
+	memcpy(&count, ptr, sizeof(count));
+	ptr += sizeof(count);
+	if (count != self->schema.column_count) return -EINVAL;
+
+	/* the strings take at most the payload size with the terminators */
+	if ((int)size + count > self->text_capacity) {
+		char* text = realloc(self->text, size + count);
+		if (!text) return -ENOMEM;
+		self->text = text;
+		self->text_capacity = size + count;
+	}
+	char* text = self->text;
+
+	int i;
+	for (i = 0; i < count; i++) {
+		sp_report_value_t* value = &self->values[i];
+		if (ptr == end) return -EINVAL;
+		value->type = (uint8_t)*ptr++;
+		switch (value->type) {
+		case SP_REPORT_VALUE_INT:
+			if (end - ptr < (int)sizeof(int64_t)) return -EINVAL;
+			memcpy(&value->i, ptr, sizeof(int64_t));
+			ptr += sizeof(int64_t);
+			break;
+		case SP_REPORT_VALUE_DOUBLE:
+			if (end - ptr < (int)sizeof(double)) return -EINVAL;
+			memcpy(&value->d, ptr, sizeof(double));
+			ptr += sizeof(double);
+			break;
+		case SP_REPORT_VALUE_STRING: {
+			if (ptr == end) return -EINVAL;
+			uint8_t len = *ptr++;
+			if (end - ptr < len) return -EINVAL;
+			memcpy(text, ptr, len);
+			text[len] = '\0';
+			value->s = text;
+			text += len + 1;
+			ptr += len;
+			break;
+		}
+		case SP_REPORT_VALUE_NA:
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Reads the dump header following the magic.
+ *
+ * @param[in] self   the reader.
+ * @return           0 for success.
+ */
+static int reader_read_dump(
+		flight_recorder_reader_t* self
+		)
+{
+	char magic[4];
+	uint16_t version, reason_len;
+	uint32_t value;
+	int rc;
+
+	if ( (rc = read_data(self->fp, magic, sizeof(magic))) != 0) return rc;
+	if (memcmp(magic, FLIGHT_RECORDER_MAGIC, sizeof(magic))) return -EINVAL;
+	if ( (rc = read_data(self->fp, &version, sizeof(version))) != 0) return rc;
+	if (version != FLIGHT_RECORDER_VERSION) return -ENOTSUP;
+	if ( (rc = read_data(self->fp, &reason_len, sizeof(reason_len))) != 0) return rc;
+
+	/* the reason is truncated to the buffer size */
+	int len = reason_len < sizeof(self->reason) ? reason_len : sizeof(self->reason) - 1;
+	if ( (rc = read_data(self->fp, self->reason, len)) != 0) return rc;
+	self->reason[len] = '\0';
+	if (len < reason_len && fseek(self->fp, reason_len - len, SEEK_CUR) != 0) return -EIO;
+
+	if ( (rc = read_data(self->fp, &self->dump_time, sizeof(self->dump_time))) != 0) return rc;
+	if ( (rc = read_data(self->fp, &value, sizeof(value))) != 0) return rc;
+	self->sample_count = value;
+	if ( (rc = read_data(self->fp, &value, sizeof(value))) != 0) return rc;
+	self->overwritten = value;
+
+	/* every dump starts with its own schema */
+	report_schema_free(&self->schema);
+	return 0;
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int flight_recorder_init(
+		flight_recorder_t* self,
+		int capacity
+		)
+{
+	memset(self, 0, sizeof(*self));
+	if (capacity < 1) return -EINVAL;
+	if ( (self->slots = calloc(capacity, sizeof(flight_recorder_slot_t))) == NULL) return -ENOMEM;
+	self->capacity = capacity;
+	return 0;
+}
+
+
+int flight_recorder_add(
+		flight_recorder_t* self,
+		sp_report_header_t* root,
+		const struct timespec* time
+		)
+{
+	int count = sp_report_get_column_count(root);
+	if (count < 0) return count;
+	if (count > UINT16_MAX) count = UINT16_MAX;
+
+	/* the schema is rebuilt only when the report columns change */
+	unsigned version = sp_report_get_layout_version(root);
+	if (!self->schema || version != self->layout_version) {
+		flight_recorder_schema_t* schema = schema_create(root);
+		if (!schema) return -ENOMEM;
+		schema_unref(self->schema);
+		self->schema = schema;
+		self->layout_version = version;
+	}
+
+	flight_recorder_slot_t* slot = &self->slots[self->head];
+	if (self->count == self->capacity) self->overwritten++;
+	else self->count++;
+	self->head = (self->head + 1) % self->capacity;
+
+	schema_unref(slot->schema);
+	slot->schema = self->schema;
+	slot->schema->refs++;
+	slot->size = 0;
+
+	uint64_t ns = (uint64_t)time->tv_sec * 1000000000ull + time->tv_nsec;
+	uint16_t value_count = count;
+	if (slot_append(slot, &ns, sizeof(ns)) != 0) goto failure;
+	if (slot_append(slot, &value_count, sizeof(value_count)) != 0) goto failure;
+
+	int i;
+	for (i = 0; i < count; i++) {
+		char buffer[SP_REPORT_VALUE_BUFFER_SIZE];
+		sp_report_value_t value;
+		if (sp_report_get_column_value(root, i, &value, buffer) != 0) value.type = SP_REPORT_VALUE_NA;
+
+		uint8_t type = value.type;
+		if (slot_append(slot, &type, sizeof(type)) != 0) goto failure;
+		switch (value.type) {
+		case SP_REPORT_VALUE_INT:
+			if (slot_append(slot, &value.i, sizeof(int64_t)) != 0) goto failure;
+			break;
+		case SP_REPORT_VALUE_DOUBLE:
+			if (slot_append(slot, &value.d, sizeof(double)) != 0) goto failure;
+			break;
+		case SP_REPORT_VALUE_STRING: {
+			size_t len = strlen(value.s);
+			uint8_t size = len > UINT8_MAX ? UINT8_MAX : len;
+			if (slot_append(slot, &size, sizeof(size)) != 0) goto failure;
+			if (slot_append(slot, value.s, size) != 0) goto failure;
+			break;
+		}
+		default:
+			break;
+		}
+	}
+	return 0;
+
+failure:
+	/* drop the partially written sample */
+	self->head = (self->head + self->capacity - 1) % self->capacity;
+	self->count--;
+	schema_unref(slot->schema);
+	slot->schema = NULL;
+	return -ENOMEM;
+}
+
+
+int flight_recorder_dump(
+		flight_recorder_t* self,
+		FILE* fp,
+		const char* reason
+		)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	uint16_t version = FLIGHT_RECORDER_VERSION;
+	uint16_t reason_len = strlen(reason);
+	uint64_t ns = (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+	uint32_t count = self->count;
+	uint32_t overwritten = self->overwritten;
+	if (fwrite(FLIGHT_RECORDER_MAGIC, 4, 1, fp) != 1 ||
+			fwrite(&version, sizeof(version), 1, fp) != 1 ||
+			fwrite(&reason_len, sizeof(reason_len), 1, fp) != 1 ||
+			fwrite(reason, 1, reason_len, fp) != reason_len ||
+			fwrite(&ns, sizeof(ns), 1, fp) != 1 ||
+			fwrite(&count, sizeof(count), 1, fp) != 1 ||
+			fwrite(&overwritten, sizeof(overwritten), 1, fp) != 1) return -EIO;
+
+	/* write the samples starting from the oldest one, preceded by their
+	 * schema whenever it changes */
+	flight_recorder_schema_t* schema = NULL;
+	int i, index = (self->head + self->capacity - self->count) % self->capacity;
+	for (i = 0; i < self->count; i++) {
+		flight_recorder_slot_t* slot = &self->slots[index];
+		if (slot->schema != schema) {
+			schema = slot->schema;
+			if (write_record(fp, FLIGHT_RECORDER_RECORD_SCHEMA, schema->data, schema->size) != 0) return -EIO;
+		}
+		if (write_record(fp, FLIGHT_RECORDER_RECORD_SAMPLE, slot->data, slot->size) != 0) return -EIO;
+		index = (index + 1) % self->capacity;
+	}
+	if (fflush(fp) != 0) return -EIO;
+
+	self->count = 0;
+	self->overwritten = 0;
+	return count;
+}
+
+
+void flight_recorder_free(
+		flight_recorder_t* self
+		)
+{
+	int i;
+	for (i = 0; i < self->capacity; i++) {
+		schema_unref(self->slots[i].schema);
+		free(self->slots[i].data);
+	}
+	schema_unref(self->schema);
+	free(self->slots);
+	memset(self, 0, sizeof(*self));
+}
+
+
+int flight_recorder_reader_open(
+		flight_recorder_reader_t* self,
+		const char* path
+		)
+{
+	memset(self, 0, sizeof(*self));
+	if ( (self->fp = fopen(path, "r")) == NULL) return -errno;
+	return 0;
+}
+
+
+int flight_recorder_reader_next(
+		flight_recorder_reader_t* self
+		)
+{
+	int c = fgetc(self->fp);
+	uint32_t size;
+	int rc;
+
+	if (c == EOF) return ferror(self->fp) ? -EIO : 0;
+	switch (c) {
+	case 'S':
+		/* the dump header magic */
+		ungetc(c, self->fp);
+		if ( (rc = reader_read_dump(self)) != 0) return rc;
+		return FLIGHT_RECORDER_DUMP;
+
+	case FLIGHT_RECORDER_RECORD_SCHEMA:
+		if ( (rc = read_payload(self->fp, &self->schema_data, &self->schema_capacity, &size)) != 0) return rc;
+		if ( (rc = reader_parse_schema(self, size)) != 0) return rc;
+		return FLIGHT_RECORDER_RECORD_SCHEMA;
+
+	case FLIGHT_RECORDER_RECORD_SAMPLE:
+		if ( (rc = read_payload(self->fp, &self->sample, &self->sample_capacity, &size)) != 0) return rc;
+		if ( (rc = reader_parse_sample(self, size)) != 0) return rc;
+		return FLIGHT_RECORDER_RECORD_SAMPLE;
+	}
+	return -EINVAL;
+}
+
+
+void flight_recorder_reader_close(
+		flight_recorder_reader_t* self
+		)
+{
+	if (self->fp) fclose(self->fp);
+	report_schema_free(&self->schema);
+	free(self->values);
+	free(self->schema_data);
+	free(self->sample);
+	free(self->text);
+	memset(self, 0, sizeof(*self));
+}
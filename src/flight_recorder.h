@@ -0,0 +1,215 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file flight_recorder.h
+ * In-memory ring of the last report samples.
+ *
+ * Every sample holds the values of all report data columns packed into
+ * a binary record. The ring has a fixed number of sample slots, whose
+ * record buffers are reused, so once the buffers have grown to the
+ * sample size no memory is allocated and nothing is written out while
+ * recording. The samples are written to a file only when dumped.
+ *
+ * The report header structure is stored in a schema shared by all
+ * samples taken with the same report layout, so the dumped samples can
+ * be printed with the titles, column sizes and value formats they were
+ * recorded with.
+ *
+ * The dump format (integers in host byte order):
+ *   dump header:
+ *     char[4]  magic "SPFR"
+ *     u16      format version (1)
+ *     u16      reason length, followed by the reason text
+ *     u64      dump time, nanoseconds since the epoch
+ *     u32      number of samples in the dump
+ *     u32      number of samples overwritten since the previous dump
+ *   followed by records:
+ *     u8       record type: 1 - schema, 2 - sample
+ *     u32      payload length
+ *   schema payload (applies to the samples following it):
+ *     the report header structure, see report_schema.h
+ *   sample payload:
+ *     u64      sample time, nanoseconds since the epoch
+ *     u16      number of values, followed by the values:
+ *     u8       value type (sp_report_value_type_t), followed by
+ *              i64 for integers, double for doubles, u8 length and
+ *              the text for strings, nothing for n/a values.
+ */
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "sp_report.h"
+#include "report_schema.h"
+
+#define FLIGHT_RECORDER_MAGIC          "SPFR"
+#define FLIGHT_RECORDER_VERSION        1
+
+/* the record types */
+#define FLIGHT_RECORDER_RECORD_SCHEMA  1
+#define FLIGHT_RECORDER_RECORD_SAMPLE  2
+
+/* flight_recorder_reader_next() results, besides the record types */
+#define FLIGHT_RECORDER_DUMP           3
+
+typedef struct flight_recorder_schema_t flight_recorder_schema_t;
+
+/**
+ * The sample slot.
+ */
+typedef struct flight_recorder_slot_t {
+	/* the packed sample payload */
+	char* data;
+	int size;
+	int capacity;
+	/* the schema of the sample */
+	flight_recorder_schema_t* schema;
+} flight_recorder_slot_t;
+
+/**
+ * The flight recorder.
+ */
+typedef struct flight_recorder_t {
+	/* the sample slots */
+	flight_recorder_slot_t* slots;
+	int capacity;
+	/* the next slot to write */
+	int head;
+	/* the number of recorded samples */
+	int count;
+	/* number of samples overwritten since the last dump */
+	unsigned overwritten;
+
+	/* the schema of the current report layout */
+	flight_recorder_schema_t* schema;
+	unsigned layout_version;
+} flight_recorder_t;
+
+/**
+ * The dump file reader.
+ */
+typedef struct flight_recorder_reader_t {
+	FILE* fp;
+
+	/* the current dump header */
+	char reason[256];
+	uint64_t dump_time;
+	unsigned sample_count;
+	unsigned overwritten;
+
+	/* the current schema */
+	report_schema_t schema;
+
+	/* the current sample time, nanoseconds since the epoch, and values,
+	 * the string values are valid until the next read */
+	uint64_t time;
+	sp_report_value_t* values;
+
+	/* the schema and sample payloads and the sample strings */
+	char* schema_data;
+	int schema_capacity;
+	char* sample;
+	int sample_capacity;
+	char* text;
+	int text_capacity;
+} flight_recorder_reader_t;
+
+
+/**
+ * Initializes the flight recorder.
+ *
+ * @param[in] self      the flight recorder.
+ * @param[in] capacity  the number of samples to keep.
+ * @return              0 for success.
+ */
+int flight_recorder_init(
+		flight_recorder_t* self,
+		int capacity
+		);
+
+/**
+ * Records the current report column values.
+ *
+ * The oldest sample is overwritten when the ring is full.
+ * @param[in] self   the flight recorder.
+ * @param[in] root   the report root header.
+ * @param[in] time   the sample time.
+ * @return           0 for success.
+ */
+int flight_recorder_add(
+		flight_recorder_t* self,
+		sp_report_header_t* root,
+		const struct timespec* time
+		);
+
+/**
+ * Writes the recorded samples into a file and empties the ring.
+ *
+ * @param[in] self    the flight recorder.
+ * @param[in] fp      the output file.
+ * @param[in] reason  the dump reason.
+ * @return            the number of dumped samples or negative error code.
+ */
+int flight_recorder_dump(
+		flight_recorder_t* self,
+		FILE* fp,
+		const char* reason
+		);
+
+/**
+ * Releases the flight recorder resources.
+ *
+ * @param[in] self   the flight recorder.
+ */
+void flight_recorder_free(
+		flight_recorder_t* self
+		);
+
+/**
+ * Opens a dump file for reading.
+ *
+ * @param[in] self   the reader.
+ * @param[in] path   the dump file path.
+ * @return           0 for success.
+ */
+int flight_recorder_reader_open(
+		flight_recorder_reader_t* self,
+		const char* path
+		);
+
+/**
+ * Reads the next dump header, schema or sample.
+ *
+ * @param[in] self   the reader.
+ * @return           FLIGHT_RECORDER_DUMP, FLIGHT_RECORDER_RECORD_SCHEMA,
+ *                   FLIGHT_RECORDER_RECORD_SAMPLE, 0 at the end of file
+ *                   or negative error code.
+ */
+int flight_recorder_reader_next(
+		flight_recorder_reader_t* self
+		);
+
+/**
+ * Closes the dump file and releases the reader resources.
+ *
+ * @param[in] self   the reader.
+ */
+void flight_recorder_reader_close(
+		flight_recorder_reader_t* self
+		);
+
+#endif
@@ -0,0 +1,521 @@
+/* ========================================================================= *
+ *
+ * mallinfo-replay
+ * ---------------
+ *
+ * mallinfo-replay replays the allocation event traces recorded with
+ * mallinfo.so against the allocator it runs with, so different allocators
+ * and their tunings can be compared on the same allocation pattern without
+ * the original application. Another allocator is taken into use with
+ * LD_PRELOAD.
+ *
+ * The thread traces of the process are merged by their event times into
+ * a single event stream before the replay, which is then replayed from
+ * a single thread. The trace block addresses are mapped to the replayed
+ * blocks with a hash table, which is allocated with mmap(), like the
+ * merged events, so the replay tool itself doesn't use the measured
+ * allocator.
+ *
+ * This file is part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * ========================================================================= */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "alloc_trace.h"
+
+/**
+ * The thread trace file.
+ */
+typedef struct trace_file_t {
+	const char* path;
+	void* map;
+	size_t map_size;
+	const alloc_trace_header_t* header;
+	const alloc_trace_event_t* events;
+	/* the number of events and the next event to merge */
+	size_t count;
+	size_t pos;
+} trace_file_t;
+
+/**
+ * The replayed block, keyed by the trace block address.
+ */
+typedef struct block_t {
+	uint64_t key;
+	void* block;
+	size_t size;
+} block_t;
+
+/**
+ * The replay statistics.
+ */
+typedef struct replay_stats_t {
+	unsigned long long events[ALLOC_TRACE_MEMALIGN + 1];
+	unsigned long long failed;
+	unsigned long long unknown;
+	unsigned long long overwritten;
+	unsigned long long live_count;
+	unsigned long long live_bytes;
+} replay_stats_t;
+
+/* the replayed blocks, open addressing with linear probing */
+static block_t* blocks;
+static size_t blocks_mask;
+
+/* write every page of the allocated blocks, as the application would */
+static bool touch_pages = true;
+static long page_size;
+
+static const char* event_names[] = {
+	[ALLOC_TRACE_MALLOC] = "malloc",
+	[ALLOC_TRACE_CALLOC] = "calloc",
+	[ALLOC_TRACE_REALLOC] = "realloc",
+	[ALLOC_TRACE_FREE] = "free",
+	[ALLOC_TRACE_MEMALIGN] = "posix_memalign",
+};
+
+
+static void
+usage(const char* name)
+{
+	fprintf(stderr,
+		"%s replays allocation event traces recorded with mallinfo.so\n"
+		"(MALLINFO=record=1) and reports the replay time and memory usage.\n"
+		"\n"
+		"Usage:\n"
+		"        [LD_PRELOAD=<allocator>] %s [OPTIONS] TRACE [TRACE...]\n"
+		"\n"
+		"The TRACE files are the mallinfo-PID.TID.alloc files of one process.\n"
+		"\n"
+		"         --no-touch        Don't write the allocated memory.\n"
+		"     -h, --help            This help.\n",
+		name, name);
+}
+
+/**
+ * Allocates zeroed memory directly from the system.
+ *
+ * @param[in] size   the size to allocate.
+ * @return           the allocated memory or NULL.
+ */
+static void*
+map_memory(size_t size)
+{
+	void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return map == MAP_FAILED ? NULL : map;
+}
+
+/**
+ * Maps the trace file and counts its events.
+ *
+ * @param[in] file   the trace file with path set.
+ * @return           0 for success.
+ */
+static int
+trace_file_open(trace_file_t* file)
+{
+	struct stat st;
+	int fd, rc = 0;
+
+	if ( (fd = open(file->path, O_RDONLY)) == -1) return -errno;
+	if (fstat(fd, &st) == -1) {
+		rc = -errno;
+		goto out;
+	}
+	if ((size_t)st.st_size < sizeof(alloc_trace_header_t)) {
+		rc = -EINVAL;
+		goto out;
+	}
+	file->map_size = st.st_size;
+	if ( (file->map = mmap(NULL, file->map_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+		rc = -errno;
+		goto out;
+	}
+	file->header = file->map;
+	if (memcmp(file->header->magic, ALLOC_TRACE_MAGIC, sizeof(file->header->magic)) != 0 ||
+			file->header->version != ALLOC_TRACE_VERSION) {
+		munmap(file->map, file->map_size);
+		rc = -EINVAL;
+		goto out;
+	}
+	file->events = (const alloc_trace_event_t*)(file->header + 1);
+
+	/* the trace ends with the zero filled end of the last window */
+	size_t max = (file->map_size - sizeof(alloc_trace_header_t)) / sizeof(alloc_trace_event_t);
+	while (file->count < max && ALLOC_TRACE_TYPE(file->events[file->count].time_type) != ALLOC_TRACE_END) {
+		file->count++;
+	}
+out:
+	close(fd);
+	return rc;
+}
+
+/**
+ * Merges the thread traces into a single event stream ordered by time.
+ *
+ * @param[in] files       the trace files.
+ * @param[in] nfiles      the number of trace files.
+ * @param[out] events     the merged events, allocated with mmap().
+ * @param[out] count      the number of merged events.
+ * @return                0 for success.
+ */
+static int
+merge_traces(trace_file_t* files, int nfiles, alloc_trace_event_t** events, size_t* count)
+{
+	size_t total = 0, i;
+	int j;
+
+	for (j = 0; j < nfiles; j++) {
+		total += files[j].count;
+	}
+	if ( (*events = map_memory((total ? total : 1) * sizeof(alloc_trace_event_t))) == NULL) return -ENOMEM;
+
+	for (i = 0; i < total; i++) {
+		trace_file_t* next = NULL;
+		for (j = 0; j < nfiles; j++) {
+			trace_file_t* file = &files[j];
+			if (file->pos < file->count && (next == NULL ||
+					ALLOC_TRACE_TIME(file->events[file->pos].time_type) <
+					ALLOC_TRACE_TIME(next->events[next->pos].time_type))) {
+				next = file;
+			}
+		}
+		(*events)[i] = next->events[next->pos++];
+	}
+	*count = total;
+	return 0;
+}
+
+/**
+ * Finds the block slot for the trace address.
+ *
+ * @param[in] key   the trace block address.
+ * @return          the slot of the block or the empty slot for it.
+ */
+static block_t*
+blocks_find(uint64_t key)
+{
+	size_t idx = (key >> 4) * 0x9e3779b97f4a7c15ull >> 16 & blocks_mask;
+	while (blocks[idx].key && blocks[idx].key != key) {
+		idx = (idx + 1) & blocks_mask;
+	}
+	return &blocks[idx];
+}
+
+/**
+ * Removes the block slot, moving the following slots of the probe
+ * sequence back so that no deleted markers are needed.
+ *
+ * @param[in] slot   the slot to remove.
+ */
+static void
+blocks_remove(block_t* slot)
+{
+	size_t hole = slot - blocks, idx = hole;
+
+	while (true) {
+		idx = (idx + 1) & blocks_mask;
+		if (!blocks[idx].key) break;
+		size_t home = (blocks[idx].key >> 4) * 0x9e3779b97f4a7c15ull >> 16 & blocks_mask;
+		/* the entry can fill the hole if its home is not between the hole
+		 * and the entry itself */
+		if (((idx - home) & blocks_mask) >= ((idx - hole) & blocks_mask)) {
+			blocks[hole] = blocks[idx];
+			hole = idx;
+		}
+	}
+	blocks[hole].key = 0;
+}
+
+/**
+ * Writes every page of the allocated block.
+ *
+ * @param[in] block   the block.
+ * @param[in] size    the block size.
+ */
+static void
+touch_block(void* block, size_t size)
+{
+	size_t offset;
+	if (!touch_pages) return;
+	for (offset = 0; offset < size; offset += page_size) {
+		((volatile char*)block)[offset] = 1;
+	}
+}
+
+/**
+ * Stores the allocated block for the trace address.
+ *
+ * A live block at the same address means that its release was not
+ * recorded, or was recorded after the new allocation by another thread,
+ * so it's released now.
+ * @param[in] stats   the replay statistics.
+ * @param[in] key     the trace block address.
+ * @param[in] block   the allocated block.
+ * @param[in] size    the block size.
+ */
+static void
+blocks_add(replay_stats_t* stats, uint64_t key, void* block, size_t size)
+{
+	block_t* slot = blocks_find(key);
+	if (slot->key) {
+		free(slot->block);
+		stats->overwritten++;
+		stats->live_count--;
+		stats->live_bytes -= slot->size;
+	}
+	slot->key = key;
+	slot->block = block;
+	slot->size = size;
+	stats->live_count++;
+	stats->live_bytes += size;
+	touch_block(block, size);
+}
+
+/**
+ * Takes the block of the trace address out of the replayed blocks.
+ *
+ * @param[in] stats   the replay statistics.
+ * @param[in] key     the trace block address.
+ * @return            the block or NULL if the address is not known.
+ */
+static void*
+blocks_take(replay_stats_t* stats, uint64_t key)
+{
+	block_t* slot = blocks_find(key);
+	if (!slot->key) {
+		stats->unknown++;
+		return NULL;
+	}
+	void* block = slot->block;
+	stats->live_count--;
+	stats->live_bytes -= slot->size;
+	blocks_remove(slot);
+	return block;
+}
+
+/**
+ * Replays the events.
+ *
+ * @param[in] events   the events.
+ * @param[in] count    the number of events.
+ * @param[out] stats   the replay statistics.
+ */
+static void
+replay(const alloc_trace_event_t* events, size_t count, replay_stats_t* stats)
+{
+	size_t i;
+	for (i = 0; i < count; i++) {
+		const alloc_trace_event_t* event = &events[i];
+		unsigned type = ALLOC_TRACE_TYPE(event->time_type);
+		void* block = NULL;
+
+		stats->events[type]++;
+		switch (type) {
+		case ALLOC_TRACE_MALLOC:
+			block = malloc(event->size);
+			break;
+		case ALLOC_TRACE_CALLOC:
+			block = calloc(1, event->size);
+			break;
+		case ALLOC_TRACE_MEMALIGN:
+			if (posix_memalign(&block, event->arg, event->size) != 0) block = NULL;
+			break;
+		case ALLOC_TRACE_REALLOC: {
+			if (!event->arg) {
+				/* realloc(NULL, size) is malloc(size), also for zero size */
+				block = malloc(event->size);
+				break;
+			}
+			void* old = blocks_take(stats, event->arg);
+			if (!event->size) {
+				/* glibc releases the block, the other allocators may not */
+				free(old);
+				continue;
+			}
+			block = realloc(old, event->size);
+			break;
+		}
+		case ALLOC_TRACE_FREE:
+			free(blocks_take(stats, event->ptr));
+			continue;
+		default:
+			continue;
+		}
+		if (block) blocks_add(stats, event->ptr, block, event->size);
+		else stats->failed++;
+	}
+}
+
+/**
+ * Reads a memory usage value from /proc/self/status.
+ *
+ * @param[in] name   the value name with the colon.
+ * @return           the value in kilobytes or -1.
+ */
+static long
+read_status(const char* name)
+{
+	char line[256];
+	long value = -1;
+	size_t len = strlen(name);
+	FILE* fp = fopen("/proc/self/status", "r");
+	if (!fp) return -1;
+	while (fgets(line, sizeof(line), fp)) {
+		if (!strncmp(line, name, len)) {
+			value = strtol(line + len, NULL, 10);
+			break;
+		}
+	}
+	fclose(fp);
+	return value;
+}
+
+/**
+ * Resets the peak resident set size, supported since Linux 4.0.
+ */
+static void
+reset_peak_rss(void)
+{
+	int fd = open("/proc/self/clear_refs", O_WRONLY);
+	if (fd != -1) {
+		if (write(fd, "5", 1) != 1) {
+			/* the peak is then the process peak */
+		}
+		close(fd);
+	}
+}
+
+/**
+ * Converts timeval to seconds.
+ */
+static double
+timeval_to_s(const struct timeval* tv)
+{
+	return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+int
+main(int argc, char** argv)
+{
+	struct option long_opts[] = {
+			{"help", 0, NULL, 'h'},
+			{"no-touch", 0, NULL, 1001},
+			{0},
+	};
+	trace_file_t* files;
+	alloc_trace_event_t* events;
+	replay_stats_t stats = {.failed = 0};
+	size_t count, capacity;
+	int nfiles, opt, rc, i;
+
+	while ((opt = getopt_long(argc, argv, "h", long_opts, NULL)) != -1) {
+		switch (opt) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 1001:
+			touch_pages = false;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (optind == argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	page_size = sysconf(_SC_PAGESIZE);
+
+	nfiles = argc - optind;
+	if ( (files = map_memory(nfiles * sizeof(trace_file_t))) == NULL) {
+		fprintf(stderr, "ERROR: failed to allocate trace files.\n");
+		return 1;
+	}
+	for (i = 0; i < nfiles; i++) {
+		files[i].path = argv[optind + i];
+		if ( (rc = trace_file_open(&files[i])) != 0) {
+			fprintf(stderr, "ERROR: failed to read trace %s (%s).\n", files[i].path, strerror(-rc));
+			return 1;
+		}
+		if (files[i].header->start != files[0].header->start) {
+			fprintf(stderr, "ERROR: trace %s is not from the same process as %s.\n", files[i].path, files[0].path);
+			return 1;
+		}
+	}
+	if ( (rc = merge_traces(files, nfiles, &events, &count)) != 0) {
+		fprintf(stderr, "ERROR: failed to merge the traces (%s).\n", strerror(-rc));
+		return 1;
+	}
+	/* the thread traces are not needed after merging and would be
+	 * counted in the RSS of the replay */
+	for (i = 0; i < nfiles; i++) {
+		munmap(files[i].map, files[i].map_size);
+	}
+
+	/* at most every event is a live block, keep the load below half */
+	for (capacity = 16; capacity < count * 2; capacity <<= 1);
+	if ( (blocks = map_memory(capacity * sizeof(block_t))) == NULL) {
+		fprintf(stderr, "ERROR: failed to allocate block table.\n");
+		return 1;
+	}
+	/* fault the table in before the measurement */
+	memset(blocks, 0, capacity * sizeof(block_t));
+	blocks_mask = capacity - 1;
+
+	struct rusage usage1, usage2;
+	struct timespec ts1, ts2;
+	long rss_before = read_status("VmRSS:");
+	reset_peak_rss();
+	getrusage(RUSAGE_SELF, &usage1);
+	clock_gettime(CLOCK_MONOTONIC, &ts1);
+
+	replay(events, count, &stats);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts2);
+	getrusage(RUSAGE_SELF, &usage2);
+	long rss_peak = read_status("VmHWM:");
+	long rss_after = read_status("VmRSS:");
+
+	double elapsed = (ts2.tv_sec - ts1.tv_sec) + (ts2.tv_nsec - ts1.tv_nsec) / 1e9;
+	printf("Trace: %zu events from %d threads\n", count, nfiles);
+	for (i = ALLOC_TRACE_MALLOC; i <= ALLOC_TRACE_MEMALIGN; i++) {
+		if (stats.events[i]) printf("  %-16s %llu\n", event_names[i], stats.events[i]);
+	}
+	printf("Replay: %.3f s, %.1f ns per event, CPU time %.3f s user, %.3f s system\n",
+			elapsed, count ? elapsed * 1e9 / count : 0.0,
+			timeval_to_s(&usage2.ru_utime) - timeval_to_s(&usage1.ru_utime),
+			timeval_to_s(&usage2.ru_stime) - timeval_to_s(&usage1.ru_stime));
+	printf("RSS: %ld kB before replay, peak %ld kB, %ld kB after replay\n", rss_before, rss_peak, rss_after);
+	printf("Live at end: %llu blocks, %llu bytes\n", stats.live_count, stats.live_bytes);
+	if (stats.failed || stats.unknown || stats.overwritten) {
+		printf("Not replayed: %llu failed allocations, %llu releases of unknown blocks, "
+				"%llu blocks replaced without release\n", stats.failed, stats.unknown, stats.overwritten);
+	}
+	return 0;
+}
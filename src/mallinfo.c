@@ -21,9 +21,26 @@
  *    memory usage tracking.
  *
  *    To enable tracing you have to set MALLINFO variable:
- *       export MALLINFO="yes"        -- use 5 seconds timeout and SIGALRM
+ *       export MALLINFO="yes"        -- periodic report every 5 seconds
  *       export MALLINFO="signal=10"  -- use SIGUSR1 to generate the report
  *       export MALLINFO="period=10"  -- periodic report for 10 secons
+ *       export MALLINFO="period=10,batch=32" -- write the periodic reports
+ *                                       in batches of 32 lines
+ *       export MALLINFO="period=10,arenas=1" -- report also every malloc
+ *                                       arena into mallinfo-PID.arenas
+ *       export MALLINFO="period=10,counters=1" -- count also allocations
+ *       export MALLINFO="signal=10,profile=524288" -- heap profile sampled
+ *                                       every 512 KiB allocated on average
+ *       export MALLINFO="record=1"   -- record every allocation event
+ *
+ *    The reports are taken by a private sampling thread, which waits for
+ *    its own CLOCK_MONOTONIC timer, so the application SIGALRM and alarm()
+ *    are left alone. The signal handler of the signal mode only wakes up
+ *    the thread, as mallinfo() and stdio are not async-signal-safe and
+ *    would deadlock if the signal interrupted a thread holding the malloc
+ *    lock. The samples are pushed as fixed size records into a lock-free
+ *    ring and written in batches into the report file, which is kept
+ *    open, so a periodic report costs no file open or close.
  *
  *    The report format is the following:
  *       time    - time of report since application started
@@ -40,8 +57,63 @@
  *       total    - mi.uordblks + mi.fordblks + mi.hblkhd,
  *       sbrk     - sbrk pointer at the specified time
  *
+ *    The values are taken with mallinfo2() when Glibc provides it, so they
+ *    don't wrap above 2 GiB. The main report sums up all the arenas, but
+ *    Glibc gives every thread its own arena, which explains memory usage
+ *    growth of heavily threaded applications. With "arenas" option the
+ *    malloc_info() statistics are parsed at every report and written, one
+ *    line per arena, in the following format:
+ *       time     - time of report since application started
+ *       arena    - the arena number, 0 is the main arena
+ *       system   - memory allocated from system for the arena
+ *       max      - maximum memory allocated from system for the arena
+ *       inuse    - memory in allocated chunks (system - fast - rest)
+ *       fast     - memory in free fastbin chunks
+ *       rest     - memory in other free chunks, including the top chunk
+ *       free<N.. - number of free chunks smaller than N bytes (and not
+ *                  fitting the previous columns), the last column counts
+ *                  the free chunks of 1 MiB and more
+ *
+ *    With "counters" option malloc, calloc, realloc, free, posix_memalign,
+ *    mmap and munmap calls are counted. Every thread updates counters of
+ *    its own, padded to a cache line, and they are summed up only when
+ *    the report is taken, so counting causes no lock or cache line
+ *    contention. The following columns are added to the report, all per
+ *    second since the previous report:
+ *       allocs/s - malloc, calloc, posix_memalign and realloc calls
+ *       frees/s  - free and realloc calls releasing memory
+ *       bytes/s  - requested allocation bytes
+ *       mmaps/s, munmaps/s, mmap_bytes/s - the application mmap and munmap
+ *                  calls and mapped bytes, excluding the malloc ones
+ *       <N/s..   - allocations smaller than N bytes (and not fitting the
+ *                  previous columns), the last column counts 1 MiB and more
+ *
+ *    With "profile" option one allocation of every given number of bytes
+ *    on average is sampled, with Poisson process, so also the small
+ *    allocations get sampled in proportion to their bytes. The backtrace
+ *    of the sampled allocation is interned into lock-free stack table,
+ *    which keeps the sampled allocations and live (not yet freed) ones for
+ *    every distinct stack. The profile is written in pprof legacy heap
+ *    format into mallinfo-PID.NNNN.heap at exit and, in signal mode, when
+ *    the signal is received. The stacks are shown with:
+ *       pprof -inuse_space <binary> mallinfo-PID.NNNN.heap
+ *
+ *    With "record" option every malloc, calloc, realloc, free and
+ *    posix_memalign call is recorded with its time, size and addresses.
+ *    Every thread writes its events into a file of its own,
+ *    mallinfo-PID.TID.alloc, through a memory mapped window, so recording
+ *    needs no locks or system calls except when the window is moved. The
+ *    trace is closed when the thread exits, the next thread with the same
+ *    identifier writes mallinfo-PID.TID-N.alloc. See
+ *    alloc_trace.h for the format. The traces are replayed against any
+ *    allocator with mallinfo-replay.
+ *
  * History:
  *
+ * 16-Oct-2026
+ * - Sampling moved to a private thread, added per-arena reports, allocation
+ *   counters, sampling heap profiler and allocation event recorder.
+ *
  * 20-Dec-2005 Leonid Moiseichuk
  * - Added environment variable MALLINFO analysis and working for signal.
  *
@@ -57,25 +129,43 @@
 #define _GNU_SOURCE
 
 #include <sys/types.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
 
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <fcntl.h>
 #include <malloc.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "alloc_trace.h"
+
 /* ========================================================================= *
  * General settings.
  * ========================================================================= */
 
 #define TOOL_NAME    "mallinfo"
-#define TOOL_VERS    "0.2.0"
+#define TOOL_VERS    "0.3.0"
 #define TOOL_FILE    "%s/mallinfo-%d.trace"
+#define TOOL_ARENAS  "%s/mallinfo-%d.arenas"
+#define TOOL_PROFILE "%s/mallinfo-%d.%04u.heap"
+#define TOOL_TRACE   "%s/mallinfo-%d.%d.alloc"
+#define TOOL_TRACE_REUSED "%s/mallinfo-%d.%d-%u.alloc"
 #define TOOL_VAR     "MALLINFO"
-#define TOOL_SIGNAL  SIGALRM
 #define TOOL_PERIOD  5     /* reporting time in seconds */
+#define TOOL_BATCH   16    /* periodic reports written at once */
 
 #define TOOL_LOGO    1
 
@@ -83,6 +173,115 @@
  * Definitions.
  * ========================================================================= */
 
+#define MI_RING_SIZE 256   /* must be power of two, limits the batch size */
+#define MI_LINE_MAX  640   /* enough for one formatted report line */
+
+#define MI_HEADER "time,arena,ordblks,smblks,hblks,hblkhd,usmblks,fsmblks,uordblks,fordblks,keepcost,total,sbrk\n"
+#define MI_ARENAS_HEADER "time,arena,system,max,inuse,fast,rest"
+#define MI_COUNTERS_HEADER ",allocs/s,frees/s,bytes/s,mmaps/s,munmaps/s,mmap_bytes/s"
+
+#define MI_SIZE_CLASSES 16          /* chunk size classes, <64 .. >=1M       */
+#define MI_THREADS_MAX  256         /* threads with counters of their own    */
+
+#define MI_STACKS       4096        /* profile stacks, must be power of two  */
+#define MI_STACK_DEPTH  32          /* profile stack frames                  */
+#define MI_STACK_SKIP   2           /* frames of mi_profile_alloc and malloc */
+#define MI_LIVE         65536       /* initial live table size, power of 2   */
+#define MI_LIVE_MAX     (1 << 24)   /* live table does not grow beyond this  */
+#define MI_LIVE_PROBES  64          /* longest probe sequence in live table  */
+#define MI_TRACE_WINDOW (1024 * 1024) /* mapped part of the event trace     */
+#define MI_INFO_SIZE    (256 * 1024) /* malloc_info() output buffer          */
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#define MI_HAVE_MALLINFO2 1
+#endif
+
+/* The mallinfo fields, wide enough for 64-bit heaps */
+typedef struct
+{
+   size_t arena;
+   size_t ordblks;
+   size_t smblks;
+   size_t hblks;
+   size_t hblkhd;
+   size_t usmblks;
+   size_t fsmblks;
+   size_t uordblks;
+   size_t fordblks;
+   size_t keepcost;
+} mi_info_t;
+
+/* Allocation counters, totals since application launch */
+typedef struct
+{
+   unsigned long long allocs;
+   unsigned long long frees;
+   unsigned long long bytes;
+   unsigned long long mmaps;
+   unsigned long long munmaps;
+   unsigned long long mmap_bytes;
+   unsigned long long sizes[MI_SIZE_CLASSES];
+} mi_counts_t;
+
+/* Counters of one thread. Only the owner thread updates them, except the
+ * shared ones used when there are more than MI_THREADS_MAX threads */
+typedef struct
+{
+   mi_counts_t counts;
+   int         shared;
+   int         owned;   /* slot is taken by a running thread */
+} __attribute__((aligned(64))) mi_counters_t;
+
+/* Profile stack. The key is claimed with compare-and-swap and the frames
+ * are valid once ready is set */
+typedef struct
+{
+   uint64_t           key;
+   int                ready;
+   int                depth;
+   void*              frames[MI_STACK_DEPTH];
+   unsigned long long live_count;
+   unsigned long long live_bytes;
+   unsigned long long alloc_count;
+   unsigned long long alloc_bytes;
+} mi_stack_t;
+
+/* Live sampled allocation, keyed by its address */
+typedef struct
+{
+   uintptr_t ptr;
+   unsigned  stack;
+   size_t    size;
+} mi_live_t;
+
+/* Live table, doubled when it gets half full */
+typedef struct
+{
+   unsigned  mask;
+   unsigned  used;
+   mi_live_t entries[];
+} mi_live_table_t;
+
+/* One memory status sample, formatted only when the batch is written */
+typedef struct
+{
+   time_t          time;   /* seconds since application launch */
+   mi_info_t       mi;
+   uintptr_t       sbrk;
+   uint64_t        clock;  /* CLOCK_MONOTONIC nanoseconds for the rates */
+   mi_counts_t     counts;
+} mi_record_t;
+
+/* One arena from malloc_info() output */
+typedef struct
+{
+   unsigned long long system;
+   unsigned long long max;
+   unsigned long long fast;
+   unsigned long long rest;
+   unsigned long long free[MI_SIZE_CLASSES];
+} mi_arena_t;
+
 /* ========================================================================= *
  * Local data.
  * ========================================================================= */
@@ -90,13 +289,107 @@
 static time_t  s_epoch = 0;   /* Time of application launch */
 static char    s_path[256];   /* Path for storing report    */
 
-static time_t  s_period = 0;  /* Period of reporting          */
-static int     s_signal = 0;  /* Default signal for reporting */
+static time_t   s_period = 0; /* Period of reporting          */
+static int      s_signal = 0; /* Signal for on-demand reports */
+static unsigned s_batch = 0;  /* Periodic reports per write   */
+static int      s_arenas = 0; /* Per-arena reports enabled    */
+static int      s_counting = 0; /* Allocations are counted    */
+static uint64_t s_start = 0;  /* CLOCK_MONOTONIC ns at launch */
+
+static pid_t     s_pid = 0;         /* Process which owns the sampler  */
+static pthread_t s_thread;          /* Sampling thread                 */
+static int       s_running = 0;     /* Sampling thread is started      */
+static int       s_quit = 0;        /* Set when sampler should exit    */
+static int       s_wakeup = -1;     /* eventfd to wake up the sampler  */
+static int       s_timer = -1;      /* timerfd for periodic reports    */
+static int       s_output = -1;     /* report file, kept open          */
+static int       s_arenas_output = -1; /* per-arena report file       */
+
+/* malloc_info() is printed into static buffer through stream created in
+ * mi_start, so the sampler never allocates memory and does not get an
+ * arena of its own */
+static char      s_info[MI_INFO_SIZE];
+static char      s_info_buf[BUFSIZ];
+static FILE*     s_info_file = NULL;
+
+/* Ring of samples, the free running indices are accessed atomically */
+static mi_record_t s_ring[MI_RING_SIZE];
+static unsigned    s_head = 0;      /* next record to write */
+static unsigned    s_tail = 0;      /* next record to fill  */
+static mi_record_t s_last;          /* last written record, for rates */
+
+/* Allocation counters, the slots are taken by threads on their first call.
+ * Preloaded library TLS is in static TLS block, initial-exec model makes
+ * its access a plain load which never calls malloc. Exiting thread adds its
+ * counts to the retired ones and releases the slot, the lock keeps sampler
+ * from seeing the counts twice or missing them */
+static mi_counters_t  s_counters[MI_THREADS_MAX + 1];
+static mi_counts_t    s_counters_retired;
+static pthread_mutex_t s_counters_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t  s_counters_key;
+static __thread mi_counters_t* t_counters __attribute__((tls_model("initial-exec")));
+
+/* The real functions, malloc family from Glibc directly as dlsym may
+ * allocate memory itself */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void  __libc_free(void* ptr);
+
+/* Heap profile. Sampling state is per thread, bytes_left is the number of
+ * bytes to allocate before the next sample */
+static size_t      s_profile = 0;    /* mean bytes between samples      */
+static unsigned    s_profile_seq = 0; /* number of written profiles     */
+static unsigned long long s_profile_lost = 0; /* stack or live table full */
+static mi_stack_t  s_stacks[MI_STACKS];
+static unsigned    s_live_used = 0;  /* live table has been used        */
+
+/* Live table is changed under the lock. Removal moves the following entries
+ * back instead of leaving deleted markers, free() looks up the blocks
+ * without the lock and takes it only if the entries were moved meanwhile */
+static mi_live_table_t* s_live = NULL;
+static unsigned    s_live_seq = 0;   /* odd while entries are moved     */
+static pthread_mutex_t s_live_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread long long t_bytes_left __attribute__((tls_model("initial-exec")));
+static __thread uint64_t  t_random __attribute__((tls_model("initial-exec")));
+static __thread int       t_in_profile __attribute__((tls_model("initial-exec")));
+
+/* Allocation event trace. Every thread has its own trace file and mapped
+ * window, trace_state is 0 before the file is opened and -1 if it failed */
+static int         s_recording = 0;  /* allocation events are recorded  */
+static uint64_t    s_trace_start = 0; /* CLOCK_MONOTONIC ns of the start */
+static unsigned    s_trace_files = 0; /* number of opened trace files   */
+static unsigned long long s_trace_lost = 0; /* events not recorded      */
+static pthread_key_t s_trace_key;    /* closes the trace at thread exit */
+static __thread int    t_trace_state __attribute__((tls_model("initial-exec")));
+static __thread int    t_trace_fd __attribute__((tls_model("initial-exec")));
+static __thread char*  t_trace_map __attribute__((tls_model("initial-exec")));
+static __thread off_t  t_trace_offset __attribute__((tls_model("initial-exec")));
+static __thread size_t t_trace_pos __attribute__((tls_model("initial-exec")));
+static __thread int    t_in_trace __attribute__((tls_model("initial-exec")));
+
+static int   (*s_posix_memalign)(void**, size_t, size_t) = NULL;
+static void* (*s_mmap)(void*, size_t, int, int, int, off_t) = NULL;
+static int   (*s_munmap)(void*, size_t) = NULL;
 
 /* ========================================================================= *
  * Local methods.
  * ========================================================================= */
 
+/* ------------------------------------------------------------------------- *
+ * mi_size_class -- get the chunk size class.
+ * parameters: chunk size.
+ * returns: size class, 0 for chunks below 64 bytes.
+ * ------------------------------------------------------------------------- */
+static inline unsigned mi_size_class(unsigned long long size)
+{
+   unsigned cls = 0;
+
+   while (cls < MI_SIZE_CLASSES - 1 && size >= (64ull << cls))
+      cls++;
+   return cls;
+} /* mi_size_class */
+
 /* ------------------------------------------------------------------------- *
  * mi_get -- find the specified option in the configuration string and get it.
  * parameters: configuration, option name, default value.
@@ -109,65 +402,1310 @@ static unsigned mi_get(const char* config, const char* opt, unsigned def)
 } /* mi_get */
 
 /* ------------------------------------------------------------------------- *
- * mi_dump -- Create the file and dump trace information into it.
- * parameters: singal number. 0 means that we shall not create timer any more.
+ * mi_clock -- monotonic time for the rates.
+ * parameters: none.
+ * returns: CLOCK_MONOTONIC time in nanoseconds.
+ * ------------------------------------------------------------------------- */
+static uint64_t mi_clock(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+} /* mi_clock */
+
+/* ------------------------------------------------------------------------- *
+ * mi_uptime -- seconds passed from application launch.
+ * parameters: none.
+ * returns: monotonic time in seconds since mi_init.
+ * ------------------------------------------------------------------------- */
+static time_t mi_uptime(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec - s_epoch;
+} /* mi_uptime */
+
+/* ------------------------------------------------------------------------- *
+ * mi_mallinfo -- get the heap statistics with the widest available API.
+ * parameters: statistics to fill.
  * returns: none.
  * ------------------------------------------------------------------------- */
+static void mi_mallinfo(mi_info_t* info)
+{
+#ifdef MI_HAVE_MALLINFO2
+   const struct mallinfo2 mi = mallinfo2();
+#define MI_FIELD(field)  (mi.field)
+#else
+   const struct mallinfo  mi = mallinfo();
+   /* The mallinfo() fields are int and wrap, take them as unsigned */
+#define MI_FIELD(field)  ((size_t)(unsigned)mi.field)
+#endif
+
+   info->arena    = MI_FIELD(arena);
+   info->ordblks  = MI_FIELD(ordblks);
+   info->smblks   = MI_FIELD(smblks);
+   info->hblks    = MI_FIELD(hblks);
+   info->hblkhd   = MI_FIELD(hblkhd);
+   info->usmblks  = MI_FIELD(usmblks);
+   info->fsmblks  = MI_FIELD(fsmblks);
+   info->uordblks = MI_FIELD(uordblks);
+   info->fordblks = MI_FIELD(fordblks);
+   info->keepcost = MI_FIELD(keepcost);
+#undef MI_FIELD
+} /* mi_mallinfo */
 
-static void mi_dump(int signo)
+/* ------------------------------------------------------------------------- *
+ * mi_write -- write the whole buffer into report file, retrying short writes.
+ * parameters: file descriptor, buffer, its size.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_write(int fd, const char* data, size_t size)
 {
-   /* Got the tracing information first */
-   static time_t pred = 0;
-   const time_t    tm = time(NULL);
+   while (size > 0)
+   {
+      const ssize_t done = write(fd, data, size);
+      if (done < 0)
+      {
+         if (EINTR == errno)
+            continue;
+         return;
+      }
+      data += done;
+      size -= done;
+   }
+} /* mi_write */
 
-   /* Check that at least 1 second passed from the time of the previous call */
-   if (pred != tm)
-   {
-      /* Information about memory status */
-      const unsigned        bk = (unsigned)sbrk(0);
-      const struct mallinfo mi = mallinfo();
-
-      /* File to print */
-      FILE* file = fopen(s_path, "a");
-
-      /* Dump header: check the file is opened correctly and it is not new */
-      if (NULL == file || 0 == ftell(file))
-      {
-         if ( !file )
-            file = stderr;
-         fprintf(file,"time,arena,ordblks,smblks,hblks,hblkhd,usmblks,fsmblks,uordblks,fordblks,keepcost,total,sbrk\n");
-      }
-
-      /* Dump the number of allocated blocks */
-      fprintf(file,"%u,%i,%i,%i,%i,%i,%i,%i,%i,%i,%i,%i,0x%08x\n",
-               (unsigned)(tm - s_epoch),
-               mi.arena,
-               mi.ordblks,
-               mi.smblks,
-               mi.hblks,
-               mi.hblkhd,
-               mi.usmblks,
-               mi.fsmblks,
-               mi.uordblks,
-               mi.fordblks,
-               mi.keepcost,
-               mi.uordblks + mi.fordblks + mi.hblkhd,
-               bk
+/* ------------------------------------------------------------------------- *
+ * mi_rate -- counter change per second since the previous report.
+ * parameters: current and previous counter, time passed in nanoseconds.
+ * returns: the rate.
+ * ------------------------------------------------------------------------- */
+static unsigned long long mi_rate(unsigned long long now, unsigned long long pred, uint64_t ns)
+{
+   return (ns ? (unsigned long long)((now - pred) * 1e9 / ns) : 0);
+} /* mi_rate */
+
+/* ------------------------------------------------------------------------- *
+ * mi_format_rates -- format the allocation rate columns and the end of line.
+ * parameters: buffer, its size, the record.
+ * returns: length of the formatted text.
+ * ------------------------------------------------------------------------- */
+static size_t mi_format_rates(char* buf, size_t len, const mi_record_t* rec)
+{
+   const mi_counts_t* now  = &rec->counts;
+   const mi_counts_t* pred = &s_last.counts;
+   const uint64_t     ns   = rec->clock - s_last.clock;
+   size_t   size;
+   unsigned cls;
+
+   size = snprintf(buf, len, ",%llu,%llu,%llu,%llu,%llu,%llu",
+            mi_rate(now->allocs, pred->allocs, ns),
+            mi_rate(now->frees, pred->frees, ns),
+            mi_rate(now->bytes, pred->bytes, ns),
+            mi_rate(now->mmaps, pred->mmaps, ns),
+            mi_rate(now->munmaps, pred->munmaps, ns),
+            mi_rate(now->mmap_bytes, pred->mmap_bytes, ns));
+   for (cls = 0; cls < MI_SIZE_CLASSES; cls++)
+      size += snprintf(buf + size, len - size, ",%llu", mi_rate(now->sizes[cls], pred->sizes[cls], ns));
+   buf[size++] = '\n';
+   return size;
+} /* mi_format_rates */
+
+/* ------------------------------------------------------------------------- *
+ * mi_flush -- format the queued samples and write them with as few write()
+ *             calls as possible.
+ * parameters: none.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_flush(void)
+{
+   char     buf[32 * MI_LINE_MAX];
+   size_t   size = 0;
+   unsigned head = s_head;
+   const unsigned tail = __atomic_load_n(&s_tail, __ATOMIC_ACQUIRE);
+
+   while (head != tail)
+   {
+      const mi_record_t* rec = &s_ring[head & (MI_RING_SIZE - 1)];
+      const char* end = "\n";
+
+      if (size + MI_LINE_MAX > sizeof(buf))
+      {
+         mi_write(s_output, buf, size);
+         size = 0;
+      }
+      size += snprintf(buf + size, sizeof(buf) - size,
+               "%u,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,0x%08lx%s",
+               (unsigned)rec->time,
+               rec->mi.arena,
+               rec->mi.ordblks,
+               rec->mi.smblks,
+               rec->mi.hblks,
+               rec->mi.hblkhd,
+               rec->mi.usmblks,
+               rec->mi.fsmblks,
+               rec->mi.uordblks,
+               rec->mi.fordblks,
+               rec->mi.keepcost,
+               rec->mi.uordblks + rec->mi.fordblks + rec->mi.hblkhd,
+               (unsigned long)rec->sbrk,
+               s_counting ? "" : end
             );
+      if ( s_counting )
+         size += mi_format_rates(buf + size, sizeof(buf) - size, rec);
+      s_last = *rec;
+      head++;
+   }
+
+   if (size)
+      mi_write(s_output, buf, size);
+   __atomic_store_n(&s_head, head, __ATOMIC_RELEASE);
+} /* mi_flush */
+
+/* ------------------------------------------------------------------------- *
+ * mi_fold_counts -- add the counts to the totals.
+ * parameters: totals to update, counts to add.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_fold_counts(mi_counts_t* total, const mi_counts_t* counts)
+{
+   unsigned cls;
+
+   total->allocs     += __atomic_load_n(&counts->allocs, __ATOMIC_RELAXED);
+   total->frees      += __atomic_load_n(&counts->frees, __ATOMIC_RELAXED);
+   total->bytes      += __atomic_load_n(&counts->bytes, __ATOMIC_RELAXED);
+   total->mmaps      += __atomic_load_n(&counts->mmaps, __ATOMIC_RELAXED);
+   total->munmaps    += __atomic_load_n(&counts->munmaps, __ATOMIC_RELAXED);
+   total->mmap_bytes += __atomic_load_n(&counts->mmap_bytes, __ATOMIC_RELAXED);
+   for (cls = 0; cls < MI_SIZE_CLASSES; cls++)
+      total->sizes[cls] += __atomic_load_n(&counts->sizes[cls], __ATOMIC_RELAXED);
+} /* mi_fold_counts */
 
-      /* Close file if it not stderr */
-      fflush(file);
-      if (file != stderr)
-         fclose(file);
+/* ------------------------------------------------------------------------- *
+ * mi_retire_counters -- move the counts of the slot to the retired ones and
+ *                       release the slot. Called with the lock held.
+ * parameters: counters of the thread which is gone.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_retire_counters(mi_counters_t* counters)
+{
+   mi_fold_counts(&s_counters_retired, &counters->counts);
+   memset(&counters->counts, 0, sizeof(counters->counts));
+   __atomic_store_n(&counters->owned, 0, __ATOMIC_RELEASE);
+} /* mi_retire_counters */
+
+/* ------------------------------------------------------------------------- *
+ * mi_sum_counters -- sum up the allocation counters of all threads.
+ * parameters: totals to fill.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_sum_counters(mi_counts_t* total)
+{
+   unsigned i;
+
+   pthread_mutex_lock(&s_counters_lock);
+   *total = s_counters_retired;
+   /* Released slots are zeroed, the last slot is the shared one */
+   for (i = 0; i <= MI_THREADS_MAX; i++)
+      mi_fold_counts(total, &s_counters[i].counts);
+   pthread_mutex_unlock(&s_counters_lock);
+} /* mi_sum_counters */
+
+/* ------------------------------------------------------------------------- *
+ * mi_sample -- take memory status and put it into the ring.
+ * parameters: none.
+ * returns: time of the sample or -1 if it was skipped.
+ * ------------------------------------------------------------------------- */
+static time_t mi_sample(void)
+{
+   /* Check that at least 1 second passed from the time of the previous call */
+   static time_t pred = -1;
+   const time_t    tm = mi_uptime();
+   mi_record_t*   rec;
+
+   if (pred == tm)
+      return -1;
+   pred = tm;
+
+   /* Make room if the writer is behind, the batch never exceeds the ring */
+   if (s_tail - __atomic_load_n(&s_head, __ATOMIC_ACQUIRE) == MI_RING_SIZE)
+      mi_flush();
+
+   rec = &s_ring[s_tail & (MI_RING_SIZE - 1)];
+   rec->time = tm;
+   rec->sbrk = (uintptr_t)sbrk(0);
+   mi_mallinfo(&rec->mi);
+   if ( s_counting )
+   {
+      rec->clock = mi_clock();
+      mi_sum_counters(&rec->counts);
    }
+   __atomic_store_n(&s_tail, s_tail + 1, __ATOMIC_RELEASE);
+   return tm;
+} /* mi_sample */
+
 
-   /* Setup new alarm if it necessary */
-   if (signo && s_period)
+/* ------------------------------------------------------------------------- *
+ * mi_arenas_header -- write the per-arena report header.
+ * parameters: none.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_arenas_header(void)
+{
+   char     buf[MI_LINE_MAX + MI_SIZE_CLASSES * 16];
+   size_t   size;
+   unsigned cls;
+
+   size = snprintf(buf, sizeof(buf), "%s", MI_ARENAS_HEADER);
+   for (cls = 0; cls < MI_SIZE_CLASSES - 1; cls++)
+      size += snprintf(buf + size, sizeof(buf) - size, ",free<%llu", 64ull << cls);
+   size += snprintf(buf + size, sizeof(buf) - size, ",free>=%llu\n", 32ull << cls);
+   mi_write(s_arenas_output, buf, size);
+} /* mi_arenas_header */
+
+/* ------------------------------------------------------------------------- *
+ * mi_counters_header -- write the report header with allocation rates.
+ * parameters: none.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_counters_header(void)
+{
+   char     buf[MI_LINE_MAX];
+   size_t   size;
+   unsigned cls;
+
+   /* The base header without its line end */
+   size = snprintf(buf, sizeof(buf), "%.*s%s", (int)sizeof(MI_HEADER) - 2, MI_HEADER, MI_COUNTERS_HEADER);
+   for (cls = 0; cls < MI_SIZE_CLASSES - 1; cls++)
+      size += snprintf(buf + size, sizeof(buf) - size, ",<%llu/s", 64ull << cls);
+   size += snprintf(buf + size, sizeof(buf) - size, ",>=%llu/s\n", 32ull << cls);
+   mi_write(s_output, buf, size);
+} /* mi_counters_header */
+
+/* ------------------------------------------------------------------------- *
+ * mi_arenas -- parse malloc_info() output and write one line for every arena.
+ * parameters: time of the sample.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_arenas(time_t tm)
+{
+   char       buf[32 * MI_LINE_MAX];
+   size_t     size = 0;
+   mi_arena_t arena;
+   int        nr = -1;
+   long       len;
+   char*      line;
+   char*      next;
+
+   rewind(s_info_file);
+   if (malloc_info(0, s_info_file) < 0 || fflush(s_info_file) != 0)
+      return;
+   len = ftell(s_info_file);
+   if (len <= 0)
+      return;
+   /* Truncated output loses only the last arenas */
+   s_info[len < MI_INFO_SIZE ? len : MI_INFO_SIZE - 1] = 0;
+
+   for (line = s_info; line; line = next)
+   {
+      unsigned long long from, value;
+
+      if ( (next = strchr(line, '\n')) != NULL )
+         *next++ = 0;
+
+      if (1 == sscanf(line, " <heap nr=\"%d\">", &nr))
+      {
+         memset(&arena, 0, sizeof(arena));
+      }
+      else if (nr < 0)
+      {
+         /* Outside of heap element, the totals are in the main report */
+      }
+      else if (2 == sscanf(line, " <%*[a-z] from=\"%llu\" to=\"%*u\" total=\"%*u\" count=\"%llu\"", &from, &value))
+      {
+         /* Both size and unsorted ranges */
+         arena.free[mi_size_class(from)] += value;
+      }
+      else if (1 == sscanf(line, " <total type=\"fast\" count=\"%*u\" size=\"%llu\"", &value))
+      {
+         arena.fast = value;
+      }
+      else if (1 == sscanf(line, " <total type=\"rest\" count=\"%*u\" size=\"%llu\"", &value))
+      {
+         arena.rest = value;
+      }
+      else if (1 == sscanf(line, " <system type=\"current\" size=\"%llu\"", &value))
+      {
+         arena.system = value;
+      }
+      else if (1 == sscanf(line, " <system type=\"max\" size=\"%llu\"", &value))
+      {
+         arena.max = value;
+      }
+      else if (strstr(line, "</heap>"))
+      {
+         const unsigned long long avail = arena.fast + arena.rest;
+         unsigned cls;
+
+         if (size + MI_LINE_MAX + MI_SIZE_CLASSES * 21 > sizeof(buf))
+         {
+            mi_write(s_arenas_output, buf, size);
+            size = 0;
+         }
+         size += snprintf(buf + size, sizeof(buf) - size, "%u,%d,%llu,%llu,%llu,%llu,%llu",
+                  (unsigned)tm, nr, arena.system, arena.max,
+                  arena.system > avail ? arena.system - avail : 0,
+                  arena.fast, arena.rest);
+         for (cls = 0; cls < MI_SIZE_CLASSES; cls++)
+            size += snprintf(buf + size, sizeof(buf) - size, ",%llu", arena.free[cls]);
+         buf[size++] = '\n';
+         nr = -1;
+      }
+   }
+
+   if (size)
+      mi_write(s_arenas_output, buf, size);
+} /* mi_arenas */
+
+/* ------------------------------------------------------------------------- *
+ * mi_report -- take the sample and per-arena report if it is enabled.
+ * parameters: none.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_report(void)
+{
+   const time_t tm = mi_sample();
+
+   if (tm >= 0 && s_arenas_output >= 0)
+      mi_arenas(tm);
+} /* mi_report */
+
+/* ------------------------------------------------------------------------- *
+ * mi_hash -- mix bits of the value for hash table index.
+ * parameters: value.
+ * returns: hash, never 0.
+ * ------------------------------------------------------------------------- */
+static inline uint64_t mi_hash(uint64_t value)
+{
+   value ^= value >> 33;
+   value *= 0xff51afd7ed558ccdull;
+   value ^= value >> 33;
+   return (value ? value : 1);
+} /* mi_hash */
+
+/* ------------------------------------------------------------------------- *
+ * mi_next_sample -- draw the bytes until the next sample from exponential
+ *                   distribution, which makes the samples Poisson process.
+ * parameters: none.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_next_sample(void)
+{
+   double uniform;
+
+   if (0 == t_random)
+      t_random = mi_hash((uintptr_t)&t_random ^ mi_clock());
+   /* xorshift64* */
+   t_random ^= t_random >> 12;
+   t_random ^= t_random << 25;
+   t_random ^= t_random >> 27;
+   uniform = ((t_random * 0x2545f4914f6cdd1dull >> 11) + 1) / 9007199254740992.0;
+   t_bytes_left = (long long)(-log(uniform) * s_profile) + 1;
+} /* mi_next_sample */
+
+/* ------------------------------------------------------------------------- *
+ * mi_stack_intern -- find or add the stack in the stack table.
+ * parameters: frames, their number.
+ * returns: stack index or -1 if the table is full.
+ * ------------------------------------------------------------------------- */
+static int mi_stack_intern(void* const* frames, int depth)
+{
+   uint64_t key = (uint64_t)depth;
+   unsigned probe;
+   int      i;
+
+   for (i = 0; i < depth; i++)
+      key = mi_hash(key ^ (uintptr_t)frames[i]);
+
+   for (probe = 0; probe < MI_STACKS; probe++)
+   {
+      const unsigned idx = (key + probe) & (MI_STACKS - 1);
+      mi_stack_t*    stack = &s_stacks[idx];
+      uint64_t       found = __atomic_load_n(&stack->key, __ATOMIC_ACQUIRE);
+
+      if (0 == found)
+      {
+         if ( __atomic_compare_exchange_n(&stack->key, &found, key, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) )
+         {
+            memcpy(stack->frames, frames, depth * sizeof(void*));
+            stack->depth = depth;
+            __atomic_store_n(&stack->ready, 1, __ATOMIC_RELEASE);
+            return (int)idx;
+         }
+         /* Somebody else claimed it, found has its key now */
+      }
+      if (found != key)
+         continue;
+      /* The same hash, wait until the frames are written and compare */
+      while ( !__atomic_load_n(&stack->ready, __ATOMIC_ACQUIRE) )
+         ;
+      if (stack->depth == depth && 0 == memcmp(stack->frames, frames, depth * sizeof(void*)))
+         return (int)idx;
+   }
+   return -1;
+} /* mi_stack_intern */
+
+/* ------------------------------------------------------------------------- *
+ * mi_live_create -- map an empty live table, not through the interposed
+ *                   mmap() so it is not counted.
+ * parameters: number of entries, power of 2.
+ * returns: the table or NULL if mapping failed.
+ * ------------------------------------------------------------------------- */
+static mi_live_table_t* mi_live_create(unsigned size)
+{
+   mi_live_table_t* table = s_mmap(NULL, sizeof(*table) + size * sizeof(mi_live_t),
+                                   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+   if (MAP_FAILED == table)
+      return NULL;
+   table->mask = size - 1;
+   table->used = 0;
+   return table;
+} /* mi_live_create */
+
+/* ------------------------------------------------------------------------- *
+ * mi_live_find -- find the block within the probe limit.
+ * parameters: live table, block address.
+ * returns: entry index or -1 if the block is not in the table.
+ * ------------------------------------------------------------------------- */
+static int mi_live_find(const mi_live_table_t* table, uintptr_t ptr)
+{
+   const uint64_t hash = mi_hash(ptr);
+   unsigned probe;
+
+   for (probe = 0; probe < MI_LIVE_PROBES; probe++)
+   {
+      const unsigned  idx   = (hash + probe) & table->mask;
+      const uintptr_t found = __atomic_load_n(&table->entries[idx].ptr, __ATOMIC_RELAXED);
+
+      if (found == ptr)
+         return (int)idx;
+      if (0 == found)
+         break;
+   }
+   return -1;
+} /* mi_live_find */
+
+/* ------------------------------------------------------------------------- *
+ * mi_live_put -- put the block into the first empty entry within the probe
+ *                limit. Called with the lock held.
+ * parameters: live table, block address, its stack index and size.
+ * returns: 0 on success, -1 if there was no room.
+ * ------------------------------------------------------------------------- */
+static int mi_live_put(mi_live_table_t* table, uintptr_t ptr, unsigned stack, size_t size)
+{
+   const uint64_t hash = mi_hash(ptr);
+   unsigned probe;
+
+   for (probe = 0; probe < MI_LIVE_PROBES; probe++)
+   {
+      mi_live_t* live = &table->entries[(hash + probe) & table->mask];
+
+      if (0 == live->ptr)
+      {
+         live->stack = stack;
+         live->size  = size;
+         __atomic_store_n(&live->ptr, ptr, __ATOMIC_RELEASE);
+         table->used++;
+         return 0;
+      }
+   }
+   return -1;
+} /* mi_live_put */
+
+/* ------------------------------------------------------------------------- *
+ * mi_live_remove -- remove the entry, moving the following entries of the
+ *                   probe sequence back. Called with the lock held.
+ * parameters: live table, entry index.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_live_remove(mi_live_table_t* table, unsigned hole)
+{
+   unsigned idx = hole;
+
+   __atomic_store_n(&s_live_seq, s_live_seq + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   for (;;)
+   {
+      uintptr_t ptr;
+      unsigned  home;
+
+      idx = (idx + 1) & table->mask;
+      ptr = table->entries[idx].ptr;
+      if (0 == ptr)
+         break;
+      home = mi_hash(ptr) & table->mask;
+      /* The entry can fill the hole if its home is not between the hole
+       * and the entry itself */
+      if (((idx - home) & table->mask) >= ((idx - hole) & table->mask))
+      {
+         table->entries[hole].stack = table->entries[idx].stack;
+         table->entries[hole].size  = table->entries[idx].size;
+         __atomic_store_n(&table->entries[hole].ptr, ptr, __ATOMIC_RELAXED);
+         hole = idx;
+      }
+   }
+   __atomic_store_n(&table->entries[hole].ptr, 0, __ATOMIC_RELAXED);
+   table->used--;
+   __atomic_store_n(&s_live_seq, s_live_seq + 1, __ATOMIC_RELEASE);
+} /* mi_live_remove */
+
+/* ------------------------------------------------------------------------- *
+ * mi_live_grow -- move the live entries into a table of double size. The
+ *                 old table is left mapped, as free() may still probe it
+ *                 without the lock. Called with the lock held.
+ * parameters: none.
+ * returns: 0 on success, -1 if the table can not grow.
+ * ------------------------------------------------------------------------- */
+static int mi_live_grow(void)
+{
+   const mi_live_table_t* old = s_live;
+   mi_live_table_t*       table;
+   unsigned               idx;
+
+   if (old->mask + 1 >= MI_LIVE_MAX || NULL == (table = mi_live_create(2 * (old->mask + 1))))
+      return -1;
+   for (idx = 0; idx <= old->mask; idx++)
+   {
+      const mi_live_t* live = &old->entries[idx];
+
+      if (live->ptr && mi_live_put(table, live->ptr, live->stack, live->size) < 0)
+      {
+         /* Longer probe sequence than the limit is next to impossible in
+          * quarter full table, the block is forgotten then */
+         __atomic_fetch_sub(&s_stacks[live->stack].live_count, 1, __ATOMIC_RELAXED);
+         __atomic_fetch_sub(&s_stacks[live->stack].live_bytes, live->size, __ATOMIC_RELAXED);
+         __atomic_fetch_add(&s_profile_lost, 1, __ATOMIC_RELAXED);
+      }
+   }
+   __atomic_store_n(&s_live, table, __ATOMIC_RELEASE);
+   return 0;
+} /* mi_live_grow */
+
+/* ------------------------------------------------------------------------- *
+ * mi_profile_live -- add the sampled block to the live blocks of its stack.
+ * parameters: block address, its stack index and size.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_profile_live(uintptr_t ptr, unsigned stack, size_t size)
+{
+   pthread_mutex_lock(&s_live_lock);
+   if (2 * s_live->used >= s_live->mask + 1)
+      mi_live_grow();
+   if (0 == mi_live_put(s_live, ptr, stack, size) ||
+         (0 == mi_live_grow() && 0 == mi_live_put(s_live, ptr, stack, size)))
    {
-      alarm(s_period);
-      pred = tm;
+      __atomic_fetch_add(&s_stacks[stack].live_count, 1, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&s_stacks[stack].live_bytes, size, __ATOMIC_RELAXED);
+      if ( !s_live_used )
+         __atomic_store_n(&s_live_used, 1, __ATOMIC_RELEASE);
    }
-} /* mi_trace_dump */
+   else
+   {
+      __atomic_fetch_add(&s_profile_lost, 1, __ATOMIC_RELAXED);
+   }
+   pthread_mutex_unlock(&s_live_lock);
+} /* mi_profile_live */
+
+/* ------------------------------------------------------------------------- *
+ * mi_profile_alloc -- sample the allocation. Not inlined, so the backtrace
+ *                     has always the same frames of this library on top.
+ * parameters: allocated block, its size.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void __attribute__((noinline)) mi_profile_alloc(void* ptr, size_t size)
+{
+   void* frames[MI_STACK_DEPTH + MI_STACK_SKIP];
+   int   depth, idx;
+
+   /* The first call of the thread only starts the sampling, backtrace()
+    * and the tables may also allocate in the profiler itself */
+   if (0 == t_random || t_in_profile)
+   {
+      if ( !t_in_profile )
+         mi_next_sample();
+      return;
+   }
+   t_in_profile = 1;
+   mi_next_sample();
+
+   depth = backtrace(frames, MI_STACK_DEPTH + MI_STACK_SKIP) - MI_STACK_SKIP;
+   idx = (depth > 0 ? mi_stack_intern(frames + MI_STACK_SKIP, depth) : -1);
+   if (idx < 0)
+   {
+      __atomic_fetch_add(&s_profile_lost, 1, __ATOMIC_RELAXED);
+      t_in_profile = 0;
+      return;
+   }
+   __atomic_fetch_add(&s_stacks[idx].alloc_count, 1, __ATOMIC_RELAXED);
+   __atomic_fetch_add(&s_stacks[idx].alloc_bytes, size, __ATOMIC_RELAXED);
+
+   /* Remember the block, so its release is taken from the live bytes */
+   mi_profile_live((uintptr_t)ptr, idx, size);
+   t_in_profile = 0;
+} /* mi_profile_alloc */
+
+/* ------------------------------------------------------------------------- *
+ * mi_profile_free -- take the released block from live bytes if it was
+ *                    sampled. Blocks which are not found end the lookup,
+ *                    unless the entries were moved during it.
+ * parameters: released block, the removed live entry.
+ * returns: 1 if the block was sampled, 0 otherwise.
+ * ------------------------------------------------------------------------- */
+static int mi_profile_free(void* ptr, mi_live_t* removed)
+{
+   const unsigned seq = __atomic_load_n(&s_live_seq, __ATOMIC_ACQUIRE);
+   int idx;
+
+   if (0 == (seq & 1) && mi_live_find(__atomic_load_n(&s_live, __ATOMIC_ACQUIRE), (uintptr_t)ptr) < 0)
+   {
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&s_live_seq, __ATOMIC_RELAXED) == seq)
+         return 0;
+   }
+
+   pthread_mutex_lock(&s_live_lock);
+   idx = mi_live_find(s_live, (uintptr_t)ptr);
+   if (idx >= 0)
+   {
+      *removed = s_live->entries[idx];
+      __atomic_fetch_sub(&s_stacks[removed->stack].live_count, 1, __ATOMIC_RELAXED);
+      __atomic_fetch_sub(&s_stacks[removed->stack].live_bytes, removed->size, __ATOMIC_RELAXED);
+      mi_live_remove(s_live, idx);
+   }
+   pthread_mutex_unlock(&s_live_lock);
+   return idx >= 0;
+} /* mi_profile_free */
+
+/* ------------------------------------------------------------------------- *
+ * mi_profile_dump -- write the heap profile in pprof legacy heap format,
+ *                    followed by the process memory mappings.
+ * parameters: none.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_profile_dump(void)
+{
+   char     path[sizeof(s_path)];
+   char     buf[32 * MI_LINE_MAX];
+   size_t   size;
+   unsigned long long live_count = 0, live_bytes = 0, alloc_count = 0, alloc_bytes = 0;
+   unsigned idx;
+   ssize_t  len;
+   int      fd, maps;
+
+   snprintf(path, sizeof(path), TOOL_PROFILE, getenv("HOME"), s_pid, s_profile_seq++);
+   fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+   if (fd < 0)
+      return;
+
+   for (idx = 0; idx < MI_STACKS; idx++)
+   {
+      const mi_stack_t* stack = &s_stacks[idx];
+
+      if ( !__atomic_load_n(&stack->ready, __ATOMIC_ACQUIRE) )
+         continue;
+      live_count  += __atomic_load_n(&stack->live_count, __ATOMIC_RELAXED);
+      live_bytes  += __atomic_load_n(&stack->live_bytes, __ATOMIC_RELAXED);
+      alloc_count += __atomic_load_n(&stack->alloc_count, __ATOMIC_RELAXED);
+      alloc_bytes += __atomic_load_n(&stack->alloc_bytes, __ATOMIC_RELAXED);
+   }
+   size = snprintf(buf, sizeof(buf), "heap profile: %llu: %llu [%llu: %llu] @ heap_v2/%zu\n",
+            live_count, live_bytes, alloc_count, alloc_bytes, s_profile);
+
+   for (idx = 0; idx < MI_STACKS; idx++)
+   {
+      const mi_stack_t* stack = &s_stacks[idx];
+      int i;
+
+      if ( !__atomic_load_n(&stack->ready, __ATOMIC_ACQUIRE) )
+         continue;
+      if (size + MI_LINE_MAX + MI_STACK_DEPTH * 19 > sizeof(buf))
+      {
+         mi_write(fd, buf, size);
+         size = 0;
+      }
+      size += snprintf(buf + size, sizeof(buf) - size, "%llu: %llu [%llu: %llu] @",
+               __atomic_load_n(&stack->live_count, __ATOMIC_RELAXED),
+               __atomic_load_n(&stack->live_bytes, __ATOMIC_RELAXED),
+               __atomic_load_n(&stack->alloc_count, __ATOMIC_RELAXED),
+               __atomic_load_n(&stack->alloc_bytes, __ATOMIC_RELAXED));
+      for (i = 0; i < stack->depth; i++)
+         size += snprintf(buf + size, sizeof(buf) - size, " %p", stack->frames[i]);
+      buf[size++] = '\n';
+   }
+   size += snprintf(buf + size, sizeof(buf) - size, "\nMAPPED_LIBRARIES:\n");
+   mi_write(fd, buf, size);
+
+   /* pprof needs the mappings to symbolize the addresses */
+   maps = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+   if (maps >= 0)
+   {
+      while ((len = read(maps, buf, sizeof(buf))) > 0)
+         mi_write(fd, buf, len);
+      close(maps);
+   }
+   close(fd);
+} /* mi_profile_dump */
+
+/* ------------------------------------------------------------------------- *
+ * mi_request -- signal handler for on-demand reports. Only wakes up the
+ *               sampler, as nothing else here is async-signal-safe.
+ * parameters: signal number.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_request(int signo)
+{
+   const int      saved = errno;
+   const uint64_t one = 1;
+
+   (void)signo;
+   if (s_wakeup >= 0 && write(s_wakeup, &one, sizeof(one)) < 0)
+   {
+      /* Counter is full, so the wakeup is pending anyway */
+   }
+   errno = saved;
+} /* mi_request */
+
+/* ------------------------------------------------------------------------- *
+ * mi_thread -- sampling thread, waits for timer expiration or wakeup.
+ * parameters: not used.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void* mi_thread(void* arg)
+{
+   struct pollfd fds[2];
+   uint64_t      count;
+
+   (void)arg;
+   fds[0].fd = s_wakeup;
+   fds[0].events = POLLIN;
+   fds[1].fd = s_timer;
+   fds[1].events = POLLIN;
+
+   /* We should report first line if periodic reports are switched on */
+   if ( s_period )
+      mi_report();
+
+   while ( !__atomic_load_n(&s_quit, __ATOMIC_ACQUIRE) )
+   {
+      if (poll(fds, s_timer >= 0 ? 2 : 1, -1) < 0)
+         continue;
+
+      if ((fds[1].revents & POLLIN) && read(s_timer, &count, sizeof(count)) > 0)
+      {
+         mi_report();
+         if (s_tail - s_head >= s_batch)
+            mi_flush();
+      }
+
+      if ((fds[0].revents & POLLIN) && read(s_wakeup, &count, sizeof(count)) > 0)
+      {
+         /* Requested reports are written immediately */
+         if ( !__atomic_load_n(&s_quit, __ATOMIC_ACQUIRE) )
+         {
+            mi_report();
+            if ( s_profile )
+               mi_profile_dump();
+         }
+         mi_flush();
+      }
+   }
+
+   /* We should report the last line if periodic reports are used */
+   if ( s_period )
+      mi_report();
+   mi_flush();
+   if ( s_profile )
+      mi_profile_dump();
+   return NULL;
+} /* mi_thread */
+
+/* ------------------------------------------------------------------------- *
+ * mi_forked -- the sampler is not copied into forked child, so tracing is
+ *              switched off there instead of writing into parent's file.
+ * parameters: none.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_forked(void)
+{
+   s_running = 0;
+   s_wakeup = -1;
+   /* Only the forking thread is copied, slots of the others are released */
+   if ( s_counting )
+   {
+      unsigned slot;
+
+      pthread_mutex_init(&s_counters_lock, NULL);
+      for (slot = 0; slot < MI_THREADS_MAX; slot++)
+      {
+         if (s_counters[slot].owned && &s_counters[slot] != t_counters)
+            mi_retire_counters(&s_counters[slot]);
+      }
+   }
+   /* Threads holding the locks are not copied */
+   pthread_mutex_init(&s_live_lock, NULL);
+   /* Child records into a file of its own */
+   if (t_trace_state > 0)
+   {
+      s_munmap(t_trace_map, MI_TRACE_WINDOW);
+      close(t_trace_fd);
+   }
+   t_trace_state = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * mi_start -- open the report and start the sampling thread.
+ * parameters: none.
+ * returns: 0 on success, -errno on failure.
+ * ------------------------------------------------------------------------- */
+static int mi_start(void)
+{
+   sigset_t all, old;
+   int      rc;
+
+   s_output = open(s_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+   if (s_output < 0)
+      s_output = STDERR_FILENO;
+   /* Dump header: check the file is opened correctly and it is not new */
+   if (STDERR_FILENO == s_output || 0 == lseek(s_output, 0, SEEK_END))
+   {
+      if ( s_counting )
+         mi_counters_header();
+      else
+         mi_write(s_output, MI_HEADER, sizeof(MI_HEADER) - 1);
+   }
+
+   if ( s_arenas )
+   {
+      char path[sizeof(s_path)];
+
+      /* The stream is unusable before its buffer is set */
+      s_info_file = fmemopen(s_info, MI_INFO_SIZE, "w");
+      if (NULL == s_info_file)
+         return -errno;
+      setvbuf(s_info_file, s_info_buf, _IOFBF, sizeof(s_info_buf));
+
+      snprintf(path, sizeof(path), TOOL_ARENAS, getenv("HOME"), getpid());
+      s_arenas_output = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+      if (s_arenas_output < 0)
+         return -errno;
+      if (0 == lseek(s_arenas_output, 0, SEEK_END))
+         mi_arenas_header();
+   }
+
+   s_wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+   if (s_wakeup < 0)
+      return -errno;
+
+   if ( s_period )
+   {
+      struct itimerspec its;
+
+      s_timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+      if (s_timer < 0)
+         return -errno;
+      memset(&its, 0, sizeof(its));
+      its.it_value.tv_sec = its.it_interval.tv_sec = s_period;
+      if (timerfd_settime(s_timer, 0, &its, NULL) < 0)
+         return -errno;
+   }
+
+   /* The sampler shall not receive any application signals */
+   sigfillset(&all);
+   pthread_sigmask(SIG_SETMASK, &all, &old);
+   rc = pthread_create(&s_thread, NULL, mi_thread, NULL);
+   pthread_sigmask(SIG_SETMASK, &old, NULL);
+   if (rc)
+      return -rc;
+
+   s_pid = getpid();
+   s_running = 1;
+   pthread_atfork(NULL, NULL, mi_forked);
+   return 0;
+} /* mi_start */
+
+/* ========================================================================= *
+ * Allocation interposition.
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * mi_counters -- get the counters of the calling thread.
+ * parameters: none.
+ * returns: the counters, the shared ones if all the slots are taken.
+ * ------------------------------------------------------------------------- */
+static mi_counters_t* mi_counters(void)
+{
+   mi_counters_t* counters = t_counters;
+
+   if (NULL == counters)
+   {
+      unsigned slot;
+
+      counters = &s_counters[MI_THREADS_MAX];
+      for (slot = 0; slot < MI_THREADS_MAX; slot++)
+      {
+         int unowned = 0;
+
+         if ( __atomic_compare_exchange_n(&s_counters[slot].owned, &unowned, 1, 0,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) )
+         {
+            counters = &s_counters[slot];
+            break;
+         }
+      }
+      /* Set first: setting the key may allocate and come back here */
+      t_counters = counters;
+      if ( !counters->shared )
+         pthread_setspecific(s_counters_key, counters);
+   }
+   return counters;
+} /* mi_counters */
+
+/* ------------------------------------------------------------------------- *
+ * mi_thread_exit -- release the counter slot of exiting thread. Allocations
+ *                   made after that are counted in the shared slot.
+ * parameters: counters of the thread.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_thread_exit(void* counters)
+{
+   t_counters = &s_counters[MI_THREADS_MAX];
+   pthread_mutex_lock(&s_counters_lock);
+   mi_retire_counters(counters);
+   pthread_mutex_unlock(&s_counters_lock);
+} /* mi_thread_exit */
+
+/* ------------------------------------------------------------------------- *
+ * mi_add -- increase the counter. Own counters are updated without locked
+ *           instruction, sampler may only see the previous value.
+ * parameters: counters, the counter, value to add.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static inline void mi_add(const mi_counters_t* counters, unsigned long long* counter, unsigned long long value)
+{
+   if ( counters->shared )
+      __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+   else
+      __atomic_store_n(counter, *counter + value, __ATOMIC_RELAXED);
+} /* mi_add */
+
+/* ------------------------------------------------------------------------- *
+ * mi_count_alloc -- count an allocation if counting is enabled.
+ * parameters: requested size.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static inline void mi_count_alloc(size_t size)
+{
+   if ( __atomic_load_n(&s_counting, __ATOMIC_RELAXED) )
+   {
+      mi_counters_t* counters = mi_counters();
+
+      mi_add(counters, &counters->counts.allocs, 1);
+      mi_add(counters, &counters->counts.bytes, size);
+      mi_add(counters, &counters->counts.sizes[mi_size_class(size)], 1);
+   }
+} /* mi_count_alloc */
+
+/* ------------------------------------------------------------------------- *
+ * mi_count_free -- count a release if counting is enabled.
+ * parameters: none.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static inline void mi_count_free(void)
+{
+   if ( __atomic_load_n(&s_counting, __ATOMIC_RELAXED) )
+   {
+      mi_counters_t* counters = mi_counters();
+      mi_add(counters, &counters->counts.frees, 1);
+   }
+} /* mi_count_free */
+
+/* ------------------------------------------------------------------------- *
+ * mi_sample_alloc -- sample the allocation when its bytes are due.
+ * parameters: allocated block, its size.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static inline __attribute__((always_inline)) void mi_sample_alloc(void* ptr, size_t size)
+{
+   if (ptr && __atomic_load_n(&s_profile, __ATOMIC_RELAXED) && (t_bytes_left -= size) <= 0)
+      mi_profile_alloc(ptr, size);
+} /* mi_sample_alloc */
+
+/* ------------------------------------------------------------------------- *
+ * mi_sample_free -- look up the released block if anything was sampled.
+ * parameters: released block, the removed live entry.
+ * returns: 1 if the block was sampled, 0 otherwise.
+ * ------------------------------------------------------------------------- */
+static inline int mi_sample_free(void* ptr, mi_live_t* removed)
+{
+   if (ptr && __atomic_load_n(&s_live_used, __ATOMIC_RELAXED))
+      return mi_profile_free(ptr, removed);
+   return 0;
+} /* mi_sample_free */
+
+/* ------------------------------------------------------------------------- *
+ * mi_trace_map -- map the trace window at the given file offset, growing the
+ *                 file to cover it.
+ * parameters: file offset of the window.
+ * returns: 0 on success, -1 on failure.
+ * ------------------------------------------------------------------------- */
+static int mi_trace_map(off_t offset)
+{
+   void* map;
+
+   if (ftruncate(t_trace_fd, offset + MI_TRACE_WINDOW) < 0)
+      return -1;
+   map = s_mmap(NULL, MI_TRACE_WINDOW, PROT_READ | PROT_WRITE, MAP_SHARED, t_trace_fd, offset);
+   if (MAP_FAILED == map)
+      return -1;
+   t_trace_map = map;
+   t_trace_offset = offset;
+   t_trace_pos = 0;
+   return 0;
+} /* mi_trace_map */
+
+/* ------------------------------------------------------------------------- *
+ * mi_trace_open -- create the trace file of the calling thread.
+ * parameters: none.
+ * returns: 0 on success, -1 on failure.
+ * ------------------------------------------------------------------------- */
+static int mi_trace_open(void)
+{
+   char                  path[sizeof(s_path)];
+   alloc_trace_header_t* header;
+   const pid_t           tid = (pid_t)syscall(SYS_gettid);
+   unsigned              seq;
+
+   t_trace_state = -1;
+   /* Thread identifier of exited thread is reused, its trace is kept */
+   for (seq = 0; ; seq++)
+   {
+      if ( seq )
+         snprintf(path, sizeof(path), TOOL_TRACE_REUSED, getenv("HOME"), getpid(), tid, seq);
+      else
+         snprintf(path, sizeof(path), TOOL_TRACE, getenv("HOME"), getpid(), tid);
+      t_trace_fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+      if (t_trace_fd >= 0 || EEXIST != errno)
+         break;
+   }
+   if (t_trace_fd < 0)
+      return -1;
+   if (mi_trace_map(0) < 0)
+   {
+      close(t_trace_fd);
+      return -1;
+   }
+
+   header = (alloc_trace_header_t*)t_trace_map;
+   memcpy(header->magic, ALLOC_TRACE_MAGIC, sizeof(header->magic));
+   header->version = ALLOC_TRACE_VERSION;
+   header->pid     = getpid();
+   header->tid     = tid;
+   header->start   = s_trace_start;
+   t_trace_pos = sizeof(*header);
+   t_trace_state = 1;
+   pthread_setspecific(s_trace_key, header);
+   __atomic_fetch_add(&s_trace_files, 1, __ATOMIC_RELAXED);
+   return 0;
+} /* mi_trace_open */
+
+/* ------------------------------------------------------------------------- *
+ * mi_trace_close -- end the trace of exiting thread and release its window.
+ *                   Events of the thread after that are lost.
+ * parameters: trace header, only tells the trace was opened.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_trace_close(void* header)
+{
+   (void)header;
+   if (t_trace_state > 0)
+   {
+      /* The window is zero filled, but written to make the end explicit */
+      if (t_trace_pos + sizeof(alloc_trace_event_t) <= MI_TRACE_WINDOW)
+         memset(t_trace_map + t_trace_pos, ALLOC_TRACE_END, sizeof(alloc_trace_event_t));
+      s_munmap(t_trace_map, MI_TRACE_WINDOW);
+      close(t_trace_fd);
+   }
+   t_trace_state = -1;
+} /* mi_trace_close */
+
+/* ------------------------------------------------------------------------- *
+ * mi_trace_write -- append the event into the trace of the calling thread.
+ * parameters: event type, event time, block address, reallocated block or
+ *             alignment, requested size.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static void mi_trace_write(unsigned type, uint64_t now, const void* ptr, uint64_t arg, size_t size)
+{
+   alloc_trace_event_t* event;
+
+   /* The trace setup must not record itself */
+   t_in_trace = 1;
+   if (t_trace_state <= 0 && (t_trace_state < 0 || mi_trace_open() < 0))
+      goto lost;
+   if (t_trace_pos + sizeof(*event) > MI_TRACE_WINDOW)
+   {
+      /* The full window is left to the page cache */
+      s_munmap(t_trace_map, MI_TRACE_WINDOW);
+      if (mi_trace_map(t_trace_offset + MI_TRACE_WINDOW) < 0)
+      {
+         close(t_trace_fd);
+         t_trace_state = -1;
+         goto lost;
+      }
+   }
+
+   event = (alloc_trace_event_t*)(t_trace_map + t_trace_pos);
+   event->ptr  = (uintptr_t)ptr;
+   event->arg  = arg;
+   event->size = size;
+   event->time_type = ALLOC_TRACE_PACK(now - s_trace_start, type);
+   t_trace_pos += sizeof(*event);
+   t_in_trace = 0;
+   return;
+
+lost:
+   __atomic_fetch_add(&s_trace_lost, 1, __ATOMIC_RELAXED);
+   t_in_trace = 0;
+} /* mi_trace_write */
+
+/* ------------------------------------------------------------------------- *
+ * mi_trace -- record the allocation event if recording is enabled.
+ * parameters: event type, block address, reallocated block or alignment,
+ *             requested size.
+ * returns: none.
+ * ------------------------------------------------------------------------- */
+static inline void mi_trace(unsigned type, const void* ptr, uint64_t arg, size_t size)
+{
+   if (__atomic_load_n(&s_recording, __ATOMIC_RELAXED) && !t_in_trace)
+      mi_trace_write(type, mi_clock(), ptr, arg, size);
+} /* mi_trace */
+
+/* ------------------------------------------------------------------------- *
+ * mi_trace_clock -- take the event time if recording is enabled.
+ * parameters: none.
+ * returns: CLOCK_MONOTONIC nanoseconds or 0 if nothing is recorded.
+ * ------------------------------------------------------------------------- */
+static inline uint64_t mi_trace_clock(void)
+{
+   return (__atomic_load_n(&s_recording, __ATOMIC_RELAXED) && !t_in_trace ? mi_clock() : 0);
+} /* mi_trace_clock */
+
+void* malloc(size_t size)
+{
+   void* ptr;
+
+   mi_count_alloc(size);
+   ptr = __libc_malloc(size);
+   mi_sample_alloc(ptr, size);
+   if (ptr)
+      mi_trace(ALLOC_TRACE_MALLOC, ptr, 0, size);
+   return ptr;
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+   void* ptr;
+
+   mi_count_alloc(nmemb * size);
+   ptr = __libc_calloc(nmemb, size);
+   mi_sample_alloc(ptr, nmemb * size);
+   if (ptr)
+      mi_trace(ALLOC_TRACE_CALLOC, ptr, 0, nmemb * size);
+   return ptr;
+}
+
+void* realloc(void* ptr, size_t size)
+{
+   /* Timed before the old address can be reused by another thread */
+   const uint64_t now = mi_trace_clock();
+   mi_live_t      live;
+   int            sampled;
+   void*          block;
+
+   /* Moving or resizing the block is both allocation and release */
+   if (ptr)
+      mi_count_free();
+   if (size || !ptr)
+      mi_count_alloc(size);
+   /* Sampled block is released before, as the same address may be
+    * reused by another thread right after realloc has moved it */
+   sampled = mi_sample_free(ptr, &live);
+   block = __libc_realloc(ptr, size);
+   /* Failed realloc leaves the block as it was, so it is still live */
+   if (sampled && !block && size)
+      mi_profile_live(live.ptr, live.stack, live.size);
+   mi_sample_alloc(block, size);
+   if (now && (block || !size))
+      mi_trace_write(ALLOC_TRACE_REALLOC, now, block, (uintptr_t)ptr, size);
+   return block;
+}
+
+void free(void* ptr)
+{
+   mi_live_t live;
+
+   if (ptr)
+   {
+      mi_count_free();
+      /* Recorded before the address can be reused by another thread */
+      mi_trace(ALLOC_TRACE_FREE, ptr, 0, 0);
+   }
+   mi_sample_free(ptr, &live);
+   __libc_free(ptr);
+}
+
+int posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+   int rc;
+
+   if (NULL == s_posix_memalign)
+      s_posix_memalign = (int (*)(void**, size_t, size_t))dlsym(RTLD_NEXT, "posix_memalign");
+   mi_count_alloc(size);
+   rc = s_posix_memalign(memptr, alignment, size);
+   if (0 == rc)
+   {
+      mi_sample_alloc(*memptr, size);
+      mi_trace(ALLOC_TRACE_MEMALIGN, *memptr, alignment, size);
+   }
+   return rc;
+}
+
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+   if (NULL == s_mmap)
+      s_mmap = (void* (*)(void*, size_t, int, int, int, off_t))dlsym(RTLD_NEXT, "mmap");
+   if ( __atomic_load_n(&s_counting, __ATOMIC_RELAXED) )
+   {
+      mi_counters_t* counters = mi_counters();
+
+      mi_add(counters, &counters->counts.mmaps, 1);
+      mi_add(counters, &counters->counts.mmap_bytes, length);
+   }
+   return s_mmap(addr, length, prot, flags, fd, offset);
+}
+
+int munmap(void* addr, size_t length)
+{
+   if (NULL == s_munmap)
+      s_munmap = (int (*)(void*, size_t))dlsym(RTLD_NEXT, "munmap");
+   if ( __atomic_load_n(&s_counting, __ATOMIC_RELAXED) )
+   {
+      mi_counters_t* counters = mi_counters();
+      mi_add(counters, &counters->counts.munmaps, 1);
+   }
+   return s_munmap(addr, length);
+}
 
 /* ========================================================================= *
  * initializer and finalizer that allowed static linking.
@@ -191,17 +1729,24 @@ static void mi_init(void)
       /* Variables for storing signal and period */
       const unsigned signum = mi_get(value, "signal", 0);
       const unsigned period = mi_get(value, "period", 0);
+      const unsigned batch  = mi_get(value, "batch", TOOL_BATCH);
+      const unsigned arenas = mi_get(value, "arenas", 0);
+      const unsigned counters = mi_get(value, "counters", 0);
+      const unsigned profile = mi_get(value, "profile", 0);
+      const unsigned record = mi_get(value, "record", 0);
+      int rc;
 
       /* Initialize all variables first */
-      s_epoch = time(NULL);
+      s_epoch = mi_uptime();
+      s_start = mi_clock();
       snprintf(s_path, sizeof(s_path), TOOL_FILE, getenv("HOME"), getpid());
 
       /* Setting the working values according to passed */
       if ( period )
       {
-         /* The period is set -> should be used the default signal */
+         /* The period is set -> timer driven reporting */
          s_period = period;
-         s_signal = TOOL_SIGNAL;
+         s_signal = 0;
       }
       else if ( signum )
       {
@@ -213,7 +1758,17 @@ static void mi_init(void)
       {
          /* No period or signal set but variable is exists -> using defaults */
          s_period = TOOL_PERIOD;
-         s_signal = TOOL_SIGNAL;
+         s_signal = 0;
+      }
+      s_batch = (batch < 1 ? 1 : batch > MI_RING_SIZE ? MI_RING_SIZE : batch);
+      s_arenas = (arenas != 0);
+      if ( counters )
+      {
+         /* Rates of the first report are counted from the launch */
+         s_last.clock = s_start;
+         s_counters[MI_THREADS_MAX].shared = 1;
+         if (0 == pthread_key_create(&s_counters_key, mi_thread_exit))
+            __atomic_store_n(&s_counting, 1, __ATOMIC_RELEASE);
       }
 
 #if TOOL_LOGO
@@ -221,15 +1776,53 @@ static void mi_init(void)
       fprintf(stderr, "(c) 2005 Nokia\n\n");
 
       fprintf(stderr, "detected variable %s with value '%s'\n", TOOL_VAR, value);
-      fprintf(stderr, "signal %d (%s) is used for reporting\n", s_signal, strsignal(s_signal));
-      fprintf(stderr, "report will be created every %u seconds\n", (unsigned)s_period);
+      if ( s_signal )
+         fprintf(stderr, "signal %d (%s) is used for reporting\n", s_signal, strsignal(s_signal));
+      else
+         fprintf(stderr, "report will be created every %u seconds, written every %u reports\n",
+                  (unsigned)s_period, s_batch);
       fprintf(stderr, "report file %s\n", s_path);
+      if ( s_arenas )
+         fprintf(stderr, "per-arena report file " TOOL_ARENAS "\n", getenv("HOME"), getpid());
+      if ( s_counting )
+         fprintf(stderr, "allocation calls are counted\n");
+      if ( profile )
+         fprintf(stderr, "heap profile sampled every %u bytes, written to " TOOL_PROFILE "\n",
+                  profile, getenv("HOME"), getpid(), 0);
+      if ( record )
+         fprintf(stderr, "allocation events are recorded to %s/mallinfo-%d.TID.alloc\n", getenv("HOME"), getpid());
 #endif
 
-      signal(s_signal, mi_dump);
-      /* We should report first line if periodic reports are switched on */
-      if ( s_period )
-         mi_dump(s_signal);
+      if ( (rc = mi_start()) < 0 )
+      {
+         fprintf(stderr, "%s: unable to start sampling thread (%s)\n", TOOL_NAME, strerror(-rc));
+         return;
+      }
+      if ( s_signal )
+         signal(s_signal, mi_request);
+      if ( profile || record )
+      {
+         /* The live table and the trace window must not be mapped through
+          * the interposed functions */
+         if (NULL == s_mmap)
+            s_mmap = (void* (*)(void*, size_t, int, int, int, off_t))dlsym(RTLD_NEXT, "mmap");
+         if (NULL == s_munmap)
+            s_munmap = (int (*)(void*, size_t))dlsym(RTLD_NEXT, "munmap");
+      }
+      if (profile && NULL != (s_live = mi_live_create(MI_LIVE)))
+      {
+         void* frames[MI_STACK_DEPTH];
+
+         /* First backtrace() loads the unwinder, which allocates memory */
+         backtrace(frames, MI_STACK_DEPTH);
+         __atomic_store_n(&s_profile, profile, __ATOMIC_RELEASE);
+      }
+      if ( record )
+      {
+         s_trace_start = mi_clock();
+         if (0 == pthread_key_create(&s_trace_key, mi_trace_close))
+            __atomic_store_n(&s_recording, 1, __ATOMIC_RELEASE);
+      }
    }
 } /* mi_init */
 
@@ -241,12 +1834,22 @@ static void mi_init(void)
 
 static void mi_fini(void)
 {
-   /* We should report the last line if periodic reports are used */
-   if ( s_period )
-      mi_dump(0);
+   const uint64_t one = 1;
+
+   if ( !s_running || getpid() != s_pid )
+      return;
+
+   /* Sampler writes the last line and the pending batch before exiting */
+   __atomic_store_n(&s_quit, 1, __ATOMIC_RELEASE);
+   if (write(s_wakeup, &one, sizeof(one)) > 0)
+      pthread_join(s_thread, NULL);
+   s_running = 0;
+
 #if TOOL_LOGO
-   if ( s_period || s_signal )
-      fprintf(stderr, "\n%s finalization completed\n", TOOL_NAME);
+   if ( s_recording )
+      fprintf(stderr, "\nallocation events recorded to %u files, %llu events lost\n",
+               s_trace_files, s_trace_lost);
+   fprintf(stderr, "\n%s finalization completed\n", TOOL_NAME);
 #endif
 } /* mi_fini */
 
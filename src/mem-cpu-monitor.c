@@ -57,6 +57,7 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -72,11 +73,23 @@
 #include <math.h>
 #include <dirent.h>
 #include <sys/wait.h>
-#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
 
 #include <sp_measure.h>
 
 #include "sp_report.h"
+#include "sample_timer.h"
+#include "proc_events.h"
+#include "proc_table.h"
+#include "name_match.h"
+#include "proc_smaps.h"
+#include "worker_pool.h"
+#include "top_view.h"
+#include "flight_recorder.h"
+#include "sample_log.h"
+#include "output_queue.h"
+#include "self_profile.h"
 
 
 static const char progname[] = "mem-cpu-monitor";
@@ -91,6 +104,100 @@ static bool 			do_print_report_default = true;
 
 static bool 			do_full_process_scan = false;
 
+static bool 			do_print_overrun_marker = false;
+
+static bool 			do_use_proc_events = false;
+
+static bool 			do_match_cmdline = false;
+
+/* process resource usage collectors */
+enum {
+	COLLECTOR_SPMEASURE,
+	COLLECTOR_SMAPS,
+};
+
+static int 				collector = COLLECTOR_SPMEASURE;
+
+/* number of parallel process snapshot jobs */
+static int 				jobs = 1;
+
+/* output formats */
+enum {
+	OUTPUT_FORMAT_TEXT,
+	OUTPUT_FORMAT_CSV,
+	OUTPUT_FORMAT_JSONL,
+	OUTPUT_FORMAT_LOG,
+};
+
+static int 				output_format = OUTPUT_FORMAT_TEXT;
+
+/* full screen view process sort orders */
+enum {
+	TOP_SORT_DIRTY_CHANGE,
+	TOP_SORT_CPU,
+	TOP_SORT_DIRTY,
+	TOP_SORT_PID,
+	TOP_SORT_NAME,
+};
+
+static bool 			top = false;
+static int 				top_sort = TOP_SORT_DIRTY_CHANGE;
+
+/* number of samples kept by the flight recorder, 0 if not used */
+static int 				flight_recorder_samples = 0;
+static const char* 		dump_path = "mem-cpu-monitor.dump";
+/* flight recorder dump triggers, 0 if not used */
+static int 				trigger_dirty = 0;
+static float 			trigger_psi = 0.0f;
+
+/* the compact log to replay and the replayed time range in microseconds
+ * since the epoch, 0 if not limited */
+static const char* 		replay_path = NULL;
+static int64_t 			replay_from = 0;
+static int64_t 			replay_to = 0;
+
+/* number of output queue entries, 0 if the output is written by the
+ * sampling thread, and the output flush policy */
+static int 				output_queue_size = 0;
+static int 				flush_policy = OUTPUT_QUEUE_FLUSH_ENTRY;
+
+static bool 			do_self_profile = false;
+
+/* the adaptive sampling interval range in microseconds, 0 if the
+ * interval is fixed */
+static unsigned long 	adaptive_interval_min = 0;
+static unsigned long 	adaptive_interval_max = 0;
+
+/* the process memory usage sampling interval in microseconds, 0 if the
+ * memory usage is sampled at every interval */
+static unsigned long 	memory_interval = 0;
+
+/* the self profile phases */
+enum {
+	PROFILE_TICK,
+	PROFILE_TICK_CPU,
+	PROFILE_SCAN,
+	PROFILE_SYSTEM,
+	PROFILE_CGROUPS,
+	PROFILE_PROCESSES,
+	PROFILE_PROCESS,
+	PROFILE_RENDER,
+	PROFILE_FLUSH,
+	PROFILE_MAX,
+};
+
+static const char* const profile_phase_names[PROFILE_MAX] = {
+	[PROFILE_TICK] = "tick",
+	[PROFILE_TICK_CPU] = "tick-cpu",
+	[PROFILE_SCAN] = "scan",
+	[PROFILE_SYSTEM] = "system",
+	[PROFILE_CGROUPS] = "cgroups",
+	[PROFILE_PROCESSES] = "processes",
+	[PROFILE_PROCESS] = "process",
+	[PROFILE_RENDER] = "render",
+	[PROFILE_FLUSH] = "flush",
+};
+
 
 // Flags should have values of powers of 2
 enum OPTION_VALUE_FLAGS {
@@ -124,13 +231,65 @@ static bool colors = true;
 
 #define HEADER_TITLE_TIMESTAMP   "time:"
 
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+
+/* maximum number of events handled per epoll_wait() call */
+#define MAX_WAIT_EVENTS 64
+
+/* the full screen view to release at exit */
+static top_view_t* top_view_active = NULL;
+
+/* the last warning, shown in the full screen view instead of stderr */
+static char top_warning[256];
+
 // Die gracefully when we get interrupted with Ctrl-C. Makes it easier to see
 // memory leaks with Valgrind.
 static volatile sig_atomic_t quit = 0;
-static void quit_app(int sig) { (void)sig; if (quit++) _exit(1); }
+static void quit_app(int sig)
+{
+	(void)sig;
+	if (quit++) {
+		/* the second signal exits without the atexit handlers */
+		if (top_view_active) top_view_restore(top_view_active);
+		_exit(1);
+	}
+}
+
+/**
+ * Prints a warning to stderr, or into the full screen view status line
+ * where stderr output would mess up the screen.
+ *
+ * @param[in] format  the printf style format.
+ */
+static void __attribute__((format(printf, 1, 2)))
+print_warning(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	if (top_view_active) {
+		vsnprintf(top_warning, sizeof(top_warning), format, args);
+		char* end = strchr(top_warning, '\n');
+		if (end) *end = '\0';
+	}
+	else {
+		vfprintf(stderr, format, args);
+	}
+	va_end(args);
+}
 
-/* a mark to print for process data when process is not available */
-#define NO_DATA    "n/a"
+/* the terminal was resized, the full screen view must be redrawn */
+static volatile sig_atomic_t is_resized = 0;
+static void resize_app(int sig) { (void)sig; is_resized = 1; }
+
+/* the flight recorder samples must be dumped */
+static volatile sig_atomic_t is_dump_requested = 0;
+static void request_dump(int sig) { (void)sig; is_dump_requested = 1; }
+
+/* set by SIGUSR2 to print the self profile */
+static volatile sig_atomic_t is_profile_requested = 0;
+static void request_profile(int sig) { (void)sig; is_profile_requested = 1; }
 
 /**
  * Structure for storing ANSI escape coded color highlighting.
@@ -180,6 +339,32 @@ usage()
 		"     -h, --help            Display this help.\n"
 		"     -x, --exec=CMD        Executes and starts monitoring the CMD command line.\n"
 		"     -G, --cgroup=NAME     Monitors memory.memsw.usage_in_bytes for root or pointed cgroup e.g. applications.\n"
+		"         --overrun-marker  Output a marker line when sampling falls behind the interval.\n"
+		"         --proc-events     Use kernel process events instead of /proc scanning for -n/-N.\n"
+		"         --name-regex=REGEX    Monitor processes with name matching extended regular expression REGEX.\n"
+		"         --name-created-regex=REGEX   Monitor processes created with name matching REGEX.\n"
+		"         --match-cmdline   Match -n/-N names and regular expressions against the full command line.\n"
+		"         --collector=NAME  Process memory usage collector: spmeasure (default) or smaps.\n"
+		"     -j, --jobs=N          Take process snapshots in N parallel jobs (smaps collector only).\n"
+		"         --format=FORMAT   Output format: text (default), csv, jsonl or log (compact binary log).\n"
+		"         --top             Show processes as rows in a full screen view updated in place.\n"
+		"         --flight-recorder=N   Keep the last N samples in memory and write them to the dump\n"
+		"                           file only when triggered, by SIGUSR1 or at exit.\n"
+		"         --dump-file=FILE  Append flight recorder dumps to FILE (default mem-cpu-monitor.dump).\n"
+		"         --trigger-dirty=KB    Dump when process private dirty memory grows by KB since the last trigger.\n"
+		"         --trigger-psi=PERCENT Dump when memory pressure (some avg10) reaches PERCENT.\n"
+		"         --replay=FILE     Print the samples of compact log or flight recorder dump FILE\n"
+		"                           in the output format.\n"
+		"         --from=TIME       Replay the samples from TIME, seconds since the epoch.\n"
+		"         --to=TIME         Replay the samples until TIME, seconds since the epoch.\n"
+		"         --queue=N         Write the output in a separate thread through a queue of N samples.\n"
+		"         --flush=POLICY    Queued output flush policy: sample (default), idle or interval in ms.\n"
+		"         --self-profile    Time the monitor's own work phases and print the histograms\n"
+		"                           to stderr at exit and on SIGUSR2.\n"
+		"         --adaptive=MIN,MAX    Sample at MIN interval while the -m, -c, -M or -C changes are\n"
+		"                           seen and stretch the interval up to MAX when idle.\n"
+		"         --memory-interval=INTERVAL   Sample the process private memory usage only every\n"
+		"                           INTERVAL, CPU usage and RSS at every interval.\n"
 		"\n"
 		"Examples:\n"
 		"\n"
@@ -211,18 +396,30 @@ static const struct option long_opts[] = {
 	{"name-created", 1, 0, 'N'},
 	{"exec", 1, 0, 'x'},
 	{"cgroup", 1, 0, 'G'},
+	{"overrun-marker", 0, 0, 1003},
+	{"proc-events", 0, 0, 1004},
+	{"name-regex", 1, 0, 1005},
+	{"name-created-regex", 1, 0, 1006},
+	{"match-cmdline", 0, 0, 1007},
+	{"collector", 1, 0, 1008},
+	{"jobs", 1, 0, 'j'},
+	{"format", 1, 0, 1009},
+	{"top", 0, 0, 1010},
+	{"flight-recorder", 1, 0, 1011},
+	{"dump-file", 1, 0, 1012},
+	{"trigger-dirty", 1, 0, 1013},
+	{"trigger-psi", 1, 0, 1014},
+	{"replay", 1, 0, 1015},
+	{"from", 1, 0, 1016},
+	{"to", 1, 0, 1017},
+	{"queue", 1, 0, 1018},
+	{"flush", 1, 0, 1019},
+	{"self-profile", 0, 0, 1020},
+	{"adaptive", 1, 0, 1021},
+	{"memory-interval", 1, 0, 1022},
 	{0,0,0,0}
 };
 
-/**
- * Structure to store monitored process name.
- */
-typedef struct proc_name_t {
-	char* name;
-	size_t size;
-} proc_name_t;
-
-
 /**
  * Process data structure.
  *
@@ -240,15 +437,46 @@ typedef struct proc_data_t {
 	sp_measure_proc_data_t* data1;
 	sp_measure_proc_data_t* data2;
 
+	/* process resource usage samples, swapped together with the snapshots */
+	proc_sample_t sample[2];
+	proc_sample_t* sample1;
+	proc_sample_t* sample2;
+	/* the sample of the last reported change, see app_data_t sys_reported */
+	proc_sample_t reported;
+
+	/* with --memory-interval the last memory usage sample, carried
+	 * forward to the samples between the memory usage reads, and its
+	 * monotonic time */
+	proc_sample_t memory;
+	struct timespec memory_clock;
+	/* the memory usage is read by the next snapshot */
+	bool is_memory_due;
+
+	/* the smaps collector files */
+	proc_smaps_t smaps;
+
+	/* results of app_data_collect_proc() */
+	bool is_cmdline_changed;
+	int snapshot_rc;
+	/* the snapshot duration in nanoseconds with --self-profile */
+	uint64_t snapshot_duration;
+
 	bool has_data;
 
 	int resource_flags;
 
+	/* process file descriptor used for exit notification, -1 if not available */
+	int pidfd;
+
+	/* process start time, identifies the process together with pid */
+	unsigned long long start_time;
+
+	/* the process was found by the full /proc rescan */
+	bool is_seen;
+
 	sp_report_header_t* header;
 
 	struct app_data_t* app_data;
-
-	struct proc_data_t* next;
 } proc_data_t;
 
 
@@ -266,6 +494,22 @@ typedef struct cgroup_data_t {
 	struct cgroup_data_t* next;
 } cgroup_data_t;
 
+/**
+ * Process row of the full screen view.
+ *
+ * The values are copied when the report is printed, so the view can be
+ * redrawn with another sort order or scroll position until the next
+ * sample.
+ */
+typedef struct top_row_t {
+	int pid;
+	char name[64];
+	sp_report_value_t clean;
+	sp_report_value_t dirty;
+	sp_report_value_t change;
+	sp_report_value_t cpu;
+} top_row_t;
+
 /**
  * Application data structure.
  *
@@ -278,19 +522,22 @@ typedef struct cgroup_data_t {
 typedef struct app_data_t {
 	int resource_flags;
 
-	sp_measure_sys_data_t sys_data[2];
+	sp_measure_sys_data_t sys_data[3];
 	sp_measure_sys_data_t* sys_data1;
 	sp_measure_sys_data_t* sys_data2;
+	/* the snapshot of the last reported sample, the change-only options
+	 * compare against it. It's sys_data1 unless the flight recorder swaps
+	 * the snapshots without reporting, the third snapshot is used then. */
+	sp_measure_sys_data_t* sys_reported;
 
-	proc_data_t* proc_list;
-	int proc_count;
+	/* monitored processes in the column order */
+	proc_table_t procs;
 
 	sp_report_header_t root_header;
 	sp_report_header_t* watermark_header;
 
 	/* process monitoring by name */
-	proc_name_t name_list[32];
-	int name_index;
+	name_match_t names;
 	
 	unsigned long sleep_interval;
 	bool timestamp_print_msecs;
@@ -300,6 +547,56 @@ typedef struct app_data_t {
 
 	/* cgroup data */
 	cgroup_data_t* cgroups;
+
+	/* process snapshot collection workers */
+	worker_pool_t workers;
+
+	/* process event listener, the fd is -1 when /proc is scanned instead */
+	proc_events_t proc_events;
+	/* all processes must be scanned on the next update */
+	bool do_rescan_processes;
+	/* monitored process list was changed by process events */
+	bool is_proc_list_changed;
+
+	/* event set for the sampling timer and process exit notifications */
+	int epoll_fd;
+	/* the last snapshots were taken, but not printed */
+	bool is_report_pending;
+	/* the wall clock time of the last system snapshot */
+	struct timespec snapshot_time;
+	/* the monotonic times of the last system snapshot and of the
+	 * snapshot the changes are calculated from */
+	struct timespec snapshot_clock;
+	struct timespec base_clock;
+
+	/* the full screen view, its process rows and system summary */
+	top_view_t top_view;
+	top_row_t* top_rows;
+	int top_row_count;
+	int top_row_capacity;
+	int top_scroll;
+	char top_summary[256];
+
+	/* the flight recorder, the number of samples to record before
+	 * the triggered dump (0 if not triggered) and the dump reason */
+	flight_recorder_t recorder;
+	int recorder_countdown;
+	const char* recorder_reason;
+
+	/* the compact log writer */
+	sample_log_writer_t log_writer;
+
+	/* the output queue of the writer thread */
+	output_queue_t output_queue;
+
+	/* without --queue the sample is rendered into memory and written
+	 * to the output at once when the output ends */
+	FILE* render_stream;
+	char* render_data;
+	size_t render_size;
+
+	/* the work phase durations with --self-profile */
+	self_profile_t profile;
 } app_data_t;
 
 /* function declarations */
@@ -367,6 +664,12 @@ static void cgroup_swap(cgroup_data_t* self)
  * Writer functions used to output the system/process statistics.
  */
 
+/* the value formats */
+static const sp_report_format_t format_change = {.sign = true};
+static const sp_report_format_t format_percent = {.precision = 1, .suffix = "%"};
+static const sp_report_format_t format_seconds = {.precision = 3, .suffix = "s"};
+static const sp_report_format_t format_age = {.precision = 1, .suffix = "s"};
+
 /**
  * Writes system timestamp.
  */
@@ -374,6 +677,12 @@ int
 write_sys_timestamp(char* buffer, int size, void* args)
 {
 	app_data_t* data = (app_data_t*)args;
+	/* the time of day wraps over at midnight, so machine readable
+	 * formats use the wall clock time of the snapshot instead */
+	if (output_format != OUTPUT_FORMAT_TEXT) {
+		return snprintf(buffer, size + 1, "%ld.%03ld", (long)data->snapshot_time.tv_sec,
+				data->snapshot_time.tv_nsec / 1000000);
+	}
 	int timestamp = FIELD_SYS_TIMESTAMP(data->sys_data2);
 	int hours = timestamp / (60 * 60 * 1000);
 	timestamp %= 60 * 60 * 1000;
@@ -387,6 +696,31 @@ write_sys_timestamp(char* buffer, int size, void* args)
 	return snprintf(buffer, size + 1, "%02d:%02d:%02d", hours, minutes, seconds);
 }
 
+/**
+ * Calculates the time between two monotonic clock readings.
+ *
+ * @param[in] ts1   the earlier time.
+ * @param[in] ts2   the later time.
+ * @return          the time in seconds.
+ */
+static double
+timespec_diff(const struct timespec* ts1, const struct timespec* ts2)
+{
+	return (ts2->tv_sec - ts1->tv_sec) + (ts2->tv_nsec - ts1->tv_nsec) / 1e9;
+}
+
+/**
+ * Writes the time elapsed since the snapshot the changes are calculated
+ * from.
+ */
+void
+write_sys_interval(sp_report_value_t* value, void* args)
+{
+	app_data_t* data = (app_data_t*)args;
+	value->type = SP_REPORT_VALUE_DOUBLE;
+	value->d = timespec_diff(&data->base_clock, &data->snapshot_clock);
+}
+
 /**
  * Writes memory watermark information.
  *
@@ -419,156 +753,206 @@ write_sys_mem_watermark(char* buffer, int size __attribute((unused)), void* args
 /**
  * Writes used system memory information.
  */
-int
-write_sys_mem_used(char* buffer, int size, void* args)
+void
+write_sys_mem_used(sp_report_value_t* value, void* args)
 {
 	app_data_t* data = (app_data_t*)args;
-	if (FIELD_SYS_MEM_USED(data->sys_data2) == ESPMEASURE_UNDEFINED) {
-		strcpy(buffer, NO_DATA);
-		return sizeof(NO_DATA) - 1;
+	if (FIELD_SYS_MEM_USED(data->sys_data2) != ESPMEASURE_UNDEFINED) {
+		value->type = SP_REPORT_VALUE_INT;
+		value->i = FIELD_SYS_MEM_USED(data->sys_data2);
 	}
-	return snprintf(buffer, size + 1, "%8d", FIELD_SYS_MEM_USED(data->sys_data2));
 }
 
 /**
  * Writes used system memory change.
  */
-int
-write_sys_mem_change(char* buffer, int size, void* args)
+void
+write_sys_mem_change(sp_report_value_t* value, void* args)
 {
 	app_data_t* data = (app_data_t*)args;
-	int value;
-	if (sp_measure_diff_sys_mem_used(data->sys_data1, data->sys_data2, &value) == 0) {
-		return snprintf(buffer, size + 1, "%+6d", value);
+	int change;
+	if (sp_measure_diff_sys_mem_used(data->sys_data1, data->sys_data2, &change) == 0) {
+		value->type = SP_REPORT_VALUE_INT;
+		value->i = change;
 	}
-	strcpy(buffer, NO_DATA);
-	return sizeof(NO_DATA) - 1;
 }
 
 /**
  * Writes used system memory cgroup information.
  */
-int
-write_sys_mem_cgroup_used(char* buffer, int size, void* args)
+void
+write_sys_mem_cgroup_used(sp_report_value_t* value, void* args)
 {
 	cgroup_data_t* data = (cgroup_data_t*)args;
-	if (FIELD_SYS_MEM_CGROUP(data->data2) == ESPMEASURE_UNDEFINED) {
-		strcpy(buffer, NO_DATA);
-		return sizeof(NO_DATA) - 1;
+	if (FIELD_SYS_MEM_CGROUP(data->data2) != ESPMEASURE_UNDEFINED) {
+		value->type = SP_REPORT_VALUE_INT;
+		value->i = FIELD_SYS_MEM_CGROUP(data->data2);
 	}
-	return snprintf(buffer, size + 1, "%8d", FIELD_SYS_MEM_CGROUP(data->data2));
 }
 
 /**
  * Writes used system memory cgroup change.
  */
-int
-write_sys_mem_cgroup_change(char* buffer, int size, void* args)
+void
+write_sys_mem_cgroup_change(sp_report_value_t* value, void* args)
 {
 	cgroup_data_t* data = (cgroup_data_t*)args;
-	int value;
-	if (sp_measure_diff_sys_mem_cgroup(data->data1, data->data2, &value) == 0) {
-		return snprintf(buffer, size + 1, "%+6d", value);
+	int change;
+	if (sp_measure_diff_sys_mem_cgroup(data->data1, data->data2, &change) == 0) {
+		value->type = SP_REPORT_VALUE_INT;
+		value->i = change;
 	}
-	strcpy(buffer, NO_DATA);
-	return sizeof(NO_DATA) - 1;
 }
 
 
 /**
  * Writes system cpu usage data.
  */
-int
-write_sys_cpu_usage(char* buffer, int size, void* args)
+void
+write_sys_cpu_usage(sp_report_value_t* value, void* args)
 {
 	app_data_t* data = (app_data_t*)args;
-	int value;
-	if (sp_measure_diff_sys_cpu_usage(data->sys_data1, data->sys_data2, &value) == 0) {
-		return snprintf(buffer, size + 1, "%5.1f%%", (float)value / 100);
+	int usage;
+	if (sp_measure_diff_sys_cpu_usage(data->sys_data1, data->sys_data2, &usage) == 0) {
+		value->type = SP_REPORT_VALUE_DOUBLE;
+		value->d = (double)usage / 100;
 	}
-	strcpy(buffer, NO_DATA);
-	return sizeof(NO_DATA) - 1;
 }
 
 /**
  * Writes average cpu frequency data/
  */
-int
-write_sys_cpu_freq(char* buffer, int size, void* args)
+void
+write_sys_cpu_freq(sp_report_value_t* value, void* args)
 {
 	static int last_cpu_freq = 0;
 	app_data_t* data = (app_data_t*)args;
-	int value;
-	if (sp_measure_diff_sys_cpu_avg_freq(data->sys_data1, data->sys_data2, &value) == 0) {
-		if (value) {
-			last_cpu_freq = value;
+	int freq;
+	if (sp_measure_diff_sys_cpu_avg_freq(data->sys_data1, data->sys_data2, &freq) == 0) {
+		if (freq) {
+			last_cpu_freq = freq;
 		}
 		else {
-			value = last_cpu_freq;
+			freq = last_cpu_freq;
 		}
-		return snprintf(buffer, size + 1, "%4d", value / 1000);
+		value->type = SP_REPORT_VALUE_INT;
+		value->i = freq / 1000;
+	}
+}
+
+/**
+ * Calculates process private dirty + swap memory size change (Kb).
+ *
+ * @param[in] sample1   the first sample.
+ * @param[in] sample2   the second sample.
+ * @param[out] value    the change.
+ * @return              0 for success, -1 if the data is not available.
+ */
+static int
+proc_sample_diff_dirty(const proc_sample_t* sample1, const proc_sample_t* sample2, int* value)
+{
+	if (sample1->dirty == -1 || sample1->swap == -1 || sample2->dirty == -1 || sample2->swap == -1) return -1;
+	*value = (sample2->dirty + sample2->swap) - (sample1->dirty + sample1->swap);
+	return 0;
+}
+
+/**
+ * Calculates process CPU ticks between two samples.
+ *
+ * @param[in] sample1   the first sample.
+ * @param[in] sample2   the second sample.
+ * @param[out] value    the CPU ticks.
+ * @return              0 for success, -1 if the data is not available.
+ */
+static int
+proc_sample_diff_cpu_ticks(const proc_sample_t* sample1, const proc_sample_t* sample2, int* value)
+{
+	if (sample1->cpu_ticks == -1 || sample2->cpu_ticks == -1) return -1;
+	*value = sample2->cpu_ticks - sample1->cpu_ticks;
+	return 0;
+}
+
+/**
+ * Writes process resident set size (Kb).
+ */
+void
+write_proc_mem_rss(sp_report_value_t* value, void* args)
+{
+	proc_data_t* proc = (proc_data_t*)args;
+	if (proc->has_data && proc->sample2->rss != -1) {
+		value->type = SP_REPORT_VALUE_INT;
+		value->i = proc->sample2->rss;
+	}
+}
+
+/**
+ * Writes the age of the process memory usage values, 0 when read by the
+ * last snapshot.
+ */
+void
+write_proc_mem_age(sp_report_value_t* value, void* args)
+{
+	proc_data_t* proc = (proc_data_t*)args;
+	if (proc->has_data) {
+		value->type = SP_REPORT_VALUE_DOUBLE;
+		value->d = timespec_diff(&proc->memory_clock, &proc->app_data->snapshot_clock);
+		if (value->d < 0) value->d = 0;
 	}
-	strcpy(buffer, NO_DATA);
-	return sizeof(NO_DATA) - 1;
 }
 
 /**
  * Writes process private clean memory size (Kb).
  */
-int
-write_proc_mem_clean(char* buffer, int size, void* args)
+void
+write_proc_mem_clean(sp_report_value_t* value, void* args)
 {
 	proc_data_t* proc = (proc_data_t*)args;
-	if (!proc->has_data || FIELD_PROC_MEM_PRIVATE_CLEAN(proc->data2) == -1) {
-		strcpy(buffer, NO_DATA);
-		return sizeof(NO_DATA) - 1;
+	if (proc->has_data && proc->sample2->clean != -1) {
+		value->type = SP_REPORT_VALUE_INT;
+		value->i = proc->sample2->clean;
 	}
-	return snprintf(buffer, size + 1, "%8d", FIELD_PROC_MEM_PRIVATE_CLEAN(proc->data2));
 }
 
 /**
  * Writes process private dirty + swap memory size (Kb).
  */
-int
-write_proc_mem_dirty(char* buffer, int size, void* args)
+void
+write_proc_mem_dirty(sp_report_value_t* value, void* args)
 {
 	proc_data_t* proc = (proc_data_t*)args;
-	if (!proc->has_data || FIELD_PROC_MEM_SWAP(proc->data2) == -1 || FIELD_PROC_MEM_PRIVATE_DIRTY(proc->data2) == -1) {
-		strcpy(buffer, NO_DATA);
-		return sizeof(NO_DATA) - 1;
+	if (proc->has_data && proc->sample2->swap != -1 && proc->sample2->dirty != -1) {
+		value->type = SP_REPORT_VALUE_INT;
+		value->i = proc->sample2->dirty + proc->sample2->swap;
 	}
-	return snprintf(buffer, size + 1, "%8d", FIELD_PROC_MEM_PRIV_DIRTY_SUM(proc->data2));
 }
 
 /**
  * Writes process private dirty + swap memory size change (Kb)
  */
-int
-write_proc_mem_change(char* buffer, int size, void* args)
+void
+write_proc_mem_change(sp_report_value_t* value, void* args)
 {
 	proc_data_t* proc = (proc_data_t*)args;
-	int value;
-	if (!proc->has_data || sp_measure_diff_proc_mem_private_dirty(proc->data1, proc->data2, &value) != 0) {
-		strcpy(buffer, NO_DATA);
-		return sizeof(NO_DATA) - 1;
+	int change;
+	if (proc->has_data && proc_sample_diff_dirty(proc->sample1, proc->sample2, &change) == 0) {
+		value->type = SP_REPORT_VALUE_INT;
+		value->i = change;
 	}
-	return snprintf(buffer, size + 1, "%+7d", value);
 }
 
 /**
  * Writes process cpu usage.
  */
-int
-write_proc_cpu_usage(char* buffer, int size, void* args)
+void
+write_proc_cpu_usage(sp_report_value_t* value, void* args)
 {
 	proc_data_t* proc = (proc_data_t*)args;
 	int total_ticks, proc_ticks;
-	if (!proc->has_data || sp_measure_diff_sys_cpu_ticks(proc->app_data->sys_data1, proc->app_data->sys_data2, &total_ticks) != 0 ||
-			                                              sp_measure_diff_proc_cpu_ticks(proc->data1, proc->data2, &proc_ticks) != 0) {
-		strcpy(buffer, NO_DATA);
-		return sizeof(NO_DATA) - 1;
+	if (proc->has_data && sp_measure_diff_sys_cpu_ticks(proc->app_data->sys_data1, proc->app_data->sys_data2, &total_ticks) == 0 &&
+			                                             proc_sample_diff_cpu_ticks(proc->sample1, proc->sample2, &proc_ticks) == 0) {
+		value->type = SP_REPORT_VALUE_DOUBLE;
+		value->d = total_ticks ? (double)proc_ticks * 100 / total_ticks : 0;
 	}
-	return snprintf(buffer, size + 1, "%5.1f%%", total_ticks ? (float)proc_ticks * 100 / total_ticks : 0);
 }
 
 /*
@@ -586,7 +970,7 @@ write_proc_cpu_usage(char* buffer, int size, void* args)
 		exit(-1);\
 	}\
 	if (__rc > 0) { \
-		fprintf(stderr, "Warning: " text " Some data might be absent.\n", __VA_ARGS__);\
+		print_warning("Warning: " text " Some data might be absent.\n", __VA_ARGS__);\
 	}\
 }
 
@@ -607,6 +991,9 @@ app_data_init_sys_snapshots(app_data_t* self)
 	CHECK_SNAPSHOT_RC(sp_measure_init_sys_data(&self->sys_data[1], 0, &self->sys_data[0]),
 			"system /proc/ data snapshot initialization returned (%x).", rc |= __rc);
 
+	CHECK_SNAPSHOT_RC(sp_measure_init_sys_data(&self->sys_data[2], 0, &self->sys_data[0]),
+			"system /proc/ data snapshot initialization returned (%x).", rc |= __rc);
+
 	/* initialize cgroups */
 	cgroup_data_t* cgroup = self->cgroups;
 	while (cgroup) {
@@ -623,9 +1010,11 @@ app_data_init_sys_snapshots(app_data_t* self)
 	}
 
 	self->resource_flags &= (~rc);
+	clock_gettime(CLOCK_MONOTONIC, &self->base_clock);
 
 	self->sys_data1 = &self->sys_data[0];
 	self->sys_data2 = &self->sys_data[1];
+	self->sys_reported = self->sys_data1;
 
 	return rc;
 }
@@ -641,19 +1030,26 @@ app_data_create_header(app_data_t* self)
 {
 	memset(&self->root_header, 0, sizeof(sp_report_header_t));
 	/* timestamp header */
-	if (sp_report_header_add_child(&self->root_header, HEADER_TITLE_TIMESTAMP, 12, SP_REPORT_ALIGN_CENTER, write_sys_timestamp, (void*)self) == NULL) return -ENOMEM;
+	sp_report_header_t* header = sp_report_header_add_child(&self->root_header, HEADER_TITLE_TIMESTAMP, 12, SP_REPORT_ALIGN_CENTER, write_sys_timestamp, (void*)self);
+	if (header == NULL || sp_report_header_set_key(header, "time") != 0) return -ENOMEM;
+
+	/* with adaptive interval the actual interval of every sample */
+	if (adaptive_interval_min) {
+		header = sp_report_header_add_value_child(&self->root_header, "interval:", 9, SP_REPORT_ALIGN_RIGHT, write_sys_interval, &format_seconds, (void*)self);
+		if (header == NULL || sp_report_header_set_key(header, "interval") != 0) return -ENOMEM;
+	}
 
 	/* watermarks header if necessary */
 	if (self->resource_flags & SNAPSHOT_SYS_MEM_WATERMARK) {
 		self->watermark_header = sp_report_header_add_child(&self->root_header, "BL", 2, SP_REPORT_ALIGN_CENTER, write_sys_mem_watermark, (void*)self);
-		if (self->watermark_header == NULL) return -ENOMEM;
+		if (self->watermark_header == NULL || sp_report_header_set_key(self->watermark_header, "watermark") != 0) return -ENOMEM;
 	}
 
 	/* memory header containing used system memory and it's change from the previous snapshot columns */
 	sp_report_header_t* mem_header = sp_report_header_add_child(&self->root_header, "system memory", 0, SP_REPORT_ALIGN_LEFT, NULL, NULL);
-	if (mem_header == NULL) return -ENOMEM;
-	if (sp_report_header_add_child(mem_header, "used:", 10, SP_REPORT_ALIGN_RIGHT, write_sys_mem_used, (void*)self) == NULL) return -ENOMEM;
-	if (sp_report_header_add_child(mem_header, "change:", 8, SP_REPORT_ALIGN_RIGHT, write_sys_mem_change, (void*)self) == NULL) return -ENOMEM;
+	if (mem_header == NULL || sp_report_header_set_key(mem_header, "mem") != 0) return -ENOMEM;
+	if (sp_report_header_add_value_child(mem_header, "used:", 10, SP_REPORT_ALIGN_RIGHT, write_sys_mem_used, NULL, (void*)self) == NULL) return -ENOMEM;
+	if (sp_report_header_add_value_child(mem_header, "change:", 8, SP_REPORT_ALIGN_RIGHT, write_sys_mem_change, &format_change, (void*)self) == NULL) return -ENOMEM;
 
 	/* cgroups headers */
 	cgroup_data_t* cgroup = self->cgroups;
@@ -663,28 +1059,32 @@ app_data_create_header(app_data_t* self)
 		snprintf(group_title, sizeof(group_title), "[%s]", strrchr(cgroup->path, '/') + 1);
 		sp_report_header_t* cgroup_header = sp_report_header_add_child(&self->root_header, group_title, 0, SP_REPORT_ALIGN_CENTER, NULL, NULL);
 		if (cgroup_header == NULL) return -ENOMEM;
+		snprintf(group_title, sizeof(group_title), "cgroup_%s", strrchr(cgroup->path, '/') + 1);
+		if (sp_report_header_set_key(cgroup_header, group_title) != 0) return -ENOMEM;
 		if (colors) {
 			hlight_t* hlight = &hlight_cgroup[(index++) & 1];
 			sp_report_header_set_color(cgroup_header, hlight->set, hlight->clear);
 		}
-	    if (sp_report_header_add_child(cgroup_header, "used:", 10, SP_REPORT_ALIGN_RIGHT, write_sys_mem_cgroup_used, (void*)cgroup) == NULL) return -ENOMEM;
-	    if (sp_report_header_add_child(cgroup_header, "change:", 8, SP_REPORT_ALIGN_RIGHT, write_sys_mem_cgroup_change, (void*)cgroup) == NULL) return -ENOMEM;
+	    if (sp_report_header_add_value_child(cgroup_header, "used:", 10, SP_REPORT_ALIGN_RIGHT, write_sys_mem_cgroup_used, NULL, (void*)cgroup) == NULL) return -ENOMEM;
+	    if (sp_report_header_add_value_child(cgroup_header, "change:", 8, SP_REPORT_ALIGN_RIGHT, write_sys_mem_cgroup_change, &format_change, (void*)cgroup) == NULL) return -ENOMEM;
 		cgroup = cgroup->next;
 	}
 
 	/* cpu header containing cpu usage and average frequency columns */
 	sp_report_header_t* cpu_header = sp_report_header_add_child(&self->root_header, "system CPU", 0, SP_REPORT_ALIGN_LEFT, NULL, NULL);
-	if (cpu_header == NULL) return -ENOMEM;
-	if (sp_report_header_add_child(cpu_header, "%:", 6, SP_REPORT_ALIGN_RIGHT, write_sys_cpu_usage, (void*)self) == NULL) return -ENOMEM;
-	if (sp_report_header_add_child(cpu_header, "MHz:", 5, SP_REPORT_ALIGN_RIGHT, write_sys_cpu_freq, (void*)self) == NULL) return -ENOMEM;
+	if (cpu_header == NULL || sp_report_header_set_key(cpu_header, "cpu") != 0) return -ENOMEM;
+	header = sp_report_header_add_value_child(cpu_header, "%:", 6, SP_REPORT_ALIGN_RIGHT, write_sys_cpu_usage, &format_percent, (void*)self);
+	if (header == NULL || sp_report_header_set_key(header, "usage") != 0) return -ENOMEM;
+	header = sp_report_header_add_value_child(cpu_header, "MHz:", 5, SP_REPORT_ALIGN_RIGHT, write_sys_cpu_freq, NULL, (void*)self);
+	if (header == NULL || sp_report_header_set_key(header, "freq") != 0) return -ENOMEM;
 
 
 	/* create headers for monitored processes */
-	proc_data_t* proc = self->proc_list;
+	proc_data_t* proc;
+	int i;
 	index = 0;
-	while (proc) {
+	PROC_TABLE_FOREACH(&self->procs, i, proc) {
 		proc_data_create_header(proc, self, index++);
-		proc = proc->next;
 	}
 
 	return 0;
@@ -719,7 +1119,7 @@ app_data_init(app_data_t* self)
 static int
 app_data_init_timestamps(app_data_t* self)
 {
-	self->timestamp_print_msecs = self->sleep_interval % 1000000;
+	self->timestamp_print_msecs = (adaptive_interval_min ? adaptive_interval_min : self->sleep_interval) % 1000000;
 	if (!self->timestamp_print_msecs) {
 		sp_report_header_set_title(self->root_header.child, HEADER_TITLE_TIMESTAMP, 8, SP_REPORT_ALIGN_RIGHT);
 	}
@@ -737,15 +1137,16 @@ app_data_release(app_data_t* self)
 {
 	sp_measure_free_sys_data(&self->sys_data[0]);
 	sp_measure_free_sys_data(&self->sys_data[1]);
+	sp_measure_free_sys_data(&self->sys_data[2]);
 
-	sp_report_header_free(self->root_header.child);
-	self->root_header.child = NULL;
+	sp_report_free(&self->root_header);
+	free(self->top_rows);
+	flight_recorder_free(&self->recorder);
+	if (self->render_stream) fclose(self->render_stream);
+	free(self->render_data);
 
 	/* free monitored process names */
-	int i;
-	for (i = 0; i < self->name_index; i++) {
-		free(self->name_list[i].name);
-	}
+	name_match_free(&self->names);
 
 	/* free cgroup data */
 	cgroup_data_t* cgroup = self->cgroups;
@@ -775,6 +1176,131 @@ proc_data_format_title(const proc_data_t* proc, char* buffer, int size)
 	return snprintf(buffer, size, "PID %d %s", FIELD_PROC_PID(proc->data1), PROCESS_NAME(proc->data1));
 }
 
+/**
+ * Reads process start time.
+ *
+ * @param[in] pid   the process identifier.
+ * @return          the process start time in clock ticks after boot or 0
+ *                  if the process does not exist.
+ */
+static unsigned long long
+read_proc_start_time(int pid)
+{
+	char buffer[1024];
+	unsigned long long start_time = 0;
+	snprintf(buffer, sizeof(buffer), "/proc/%d/stat", pid);
+	int fd = open(buffer, O_RDONLY);
+	if (fd != -1) {
+		int len = read(fd, buffer, sizeof(buffer) - 1);
+		close(fd);
+		if (len > 0) {
+			buffer[len] = '\0';
+			/* the process name can contain spaces and parentheses, so
+			 * start counting the fields from the last ')' */
+			char* ptr = strrchr(buffer, ')');
+			int field = 2;
+			while (ptr && *ptr && field < 22) {
+				if (*ptr++ == ' ') field++;
+			}
+			if (ptr && field == 22) start_time = strtoull(ptr, NULL, 10);
+		}
+	}
+	return start_time;
+}
+
+/**
+ * Reads process resident set size.
+ *
+ * @param[in] pid   the process identifier.
+ * @return          the resident set size in kilobytes or -1 if not
+ *                  available.
+ */
+static int
+read_proc_rss(int pid)
+{
+	char buffer[256];
+	long rss = -1;
+	snprintf(buffer, sizeof(buffer), "/proc/%d/statm", pid);
+	int fd = open(buffer, O_RDONLY);
+	if (fd != -1) {
+		int len = read(fd, buffer, sizeof(buffer) - 1);
+		close(fd);
+		if (len > 0) {
+			buffer[len] = '\0';
+			/* the resident pages follow the total program size */
+			if (sscanf(buffer, "%*u %ld", &rss) == 1) rss *= sysconf(_SC_PAGESIZE) / 1024;
+			else rss = -1;
+		}
+	}
+	return rss;
+}
+
+/**
+ * Takes process resource usage snapshot with the selected collector.
+ *
+ * With --memory-interval the memory usage is read by the base snapshot
+ * and by the last snapshot only when it is due, otherwise the last read
+ * memory usage is carried forward.
+ * @param[in] proc    the process data.
+ * @param[in] last    true to take the last snapshot (data2/sample2),
+ *                    false to take the base snapshot (data1/sample1).
+ * @return            <0 - failure, 0 - success,
+ *                    >0 - flags of the resources that were not available.
+ */
+static int
+proc_data_snapshot(proc_data_t* proc, bool last)
+{
+	proc_sample_t* sample = last ? proc->sample2 : proc->sample1;
+	sp_measure_proc_data_t* data = last ? proc->data2 : proc->data1;
+	bool do_read_memory = !memory_interval || !last || proc->is_memory_due;
+	int rc, ticks;
+
+	if (collector == COLLECTOR_SMAPS) {
+		/* the files are opened on the first use, as the processes given
+		 * before --collector option are created with the default collector */
+		if (proc->smaps.fd == -1 &&
+				(rc = proc_smaps_open(&proc->smaps, FIELD_PROC_PID(proc->data1))) != 0) return rc;
+		if (do_read_memory) rc = proc_smaps_read(&proc->smaps, sample);
+		else rc = proc_smaps_read_stat(&proc->smaps, sample);
+		if (rc != 0) return rc;
+	}
+	else {
+		int flags = do_read_memory ? proc->resource_flags : proc->resource_flags & ~SNAPSHOT_PROC_MEM_USAGE;
+		if ( (rc = sp_measure_get_proc_data(data, flags, NULL)) < 0) return rc;
+		sample->clean = FIELD_PROC_MEM_PRIVATE_CLEAN(data);
+		sample->dirty = FIELD_PROC_MEM_PRIVATE_DIRTY(data);
+		sample->swap = FIELD_PROC_MEM_SWAP(data);
+		/* libspmeasure doesn't provide the resident set size */
+		sample->rss = memory_interval ? read_proc_rss(FIELD_PROC_PID(data)) : -1;
+		/* libspmeasure provides only CPU tick differences, so accumulate them
+		 * starting from the base snapshot */
+		if (!last) {
+			sample->cpu_ticks = 0;
+		}
+		else if (proc->sample1->cpu_ticks != -1 &&
+				sp_measure_diff_proc_cpu_ticks(proc->data1, proc->data2, &ticks) == 0) {
+			sample->cpu_ticks = proc->sample1->cpu_ticks + ticks;
+		}
+		else {
+			sample->cpu_ticks = -1;
+		}
+	}
+
+	if (memory_interval) {
+		if (do_read_memory) {
+			proc->memory = *sample;
+			if (last) proc->memory_clock = proc->app_data->snapshot_clock;
+			else clock_gettime(CLOCK_MONOTONIC, &proc->memory_clock);
+		}
+		else {
+			sample->clean = proc->memory.clean;
+			sample->dirty = proc->memory.dirty;
+			sample->swap = proc->memory.swap;
+		}
+	}
+	return rc;
+}
+
 /**
  * Creates process data structure.
  *
@@ -794,7 +1320,9 @@ proc_data_create(proc_data_t** pproc, int pid, app_data_t* app_data)
 	if (proc == NULL) return -ENOMEM;
 
 	proc->header = NULL;
-	proc->next = NULL;
+	proc->pidfd = -1;
+	proc->smaps.fd = proc->smaps.stat_fd = -1;
+	proc->start_time = read_proc_start_time(pid);
 	proc->app_data = app_data;
 	proc->resource_flags = SNAPSHOT_PROC;
 	*proc->cmdline = '\0';
@@ -808,10 +1336,28 @@ proc_data_create(proc_data_t** pproc, int pid, app_data_t* app_data)
 
 	proc->data1 = &proc->data[0];
 	proc->data2 = &proc->data[1];
-
-	CHECK_SNAPSHOT_RC(sp_measure_get_proc_data(proc->data1, proc->resource_flags, NULL),
-			"proc /proc/<pid>/ data snapshot returned (%d).", rc |= __rc);
+	proc->sample1 = &proc->sample[0];
+	proc->sample2 = &proc->sample[1];
+
+	/* the process can exit before the first snapshot when processes
+	 * are created and terminated frequently, the smaps collector reports
+	 * it with -ESRCH and libspmeasure with -ENOENT */
+	rc = proc_data_snapshot(proc, false);
+	if (rc == -ESRCH || rc == -ENOENT) return rc;
+	CHECK_SNAPSHOT_RC(rc, "proc /proc/<pid>/ data snapshot returned (%d).", __rc);
 	proc->resource_flags &= (~rc);
+	proc->reported = *proc->sample1;
+
+	/* watch for the process termination, /proc is checked instead if
+	 * pidfds are not supported */
+	proc->pidfd = syscall(__NR_pidfd_open, pid, 0);
+	if (proc->pidfd != -1) {
+		struct epoll_event event = {.events = EPOLLIN, .data.ptr = proc};
+		if (epoll_ctl(app_data->epoll_fd, EPOLL_CTL_ADD, proc->pidfd, &event) == -1) {
+			close(proc->pidfd);
+			proc->pidfd = -1;
+		}
+	}
 
 	return rc;
 }
@@ -830,10 +1376,19 @@ proc_data_create_header(proc_data_t* proc, app_data_t* app_data, int index)
 	proc_data_format_title(proc, buffer, sizeof(buffer));
 	proc->header = sp_report_header_add_child(&app_data->root_header, buffer, 30, SP_REPORT_ALIGN_LEFT, NULL, NULL);
 	if (proc->header == NULL) return -ENOMEM;
-	if (sp_report_header_add_child(proc->header, "clean:", 8, SP_REPORT_ALIGN_RIGHT, write_proc_mem_clean, (void*)proc) == NULL) return -ENOMEM;
-	if (sp_report_header_add_child(proc->header, "dirty:", 8, SP_REPORT_ALIGN_RIGHT, write_proc_mem_dirty, (void*)proc) == NULL) return -ENOMEM;
-	if (sp_report_header_add_child(proc->header, "change:", 8, SP_REPORT_ALIGN_RIGHT, write_proc_mem_change, (void*)proc) == NULL) return -ENOMEM;
-	if (sp_report_header_add_child(proc->header, "CPU-%:", 7, SP_REPORT_ALIGN_RIGHT, write_proc_cpu_usage, (void*)proc) == NULL) return -ENOMEM;
+	snprintf(buffer, sizeof(buffer), "pid%d", FIELD_PROC_PID(proc->data1));
+	if (sp_report_header_set_key(proc->header, buffer) != 0) return -ENOMEM;
+	if (sp_report_header_add_value_child(proc->header, "clean:", 8, SP_REPORT_ALIGN_RIGHT, write_proc_mem_clean, NULL, (void*)proc) == NULL) return -ENOMEM;
+	if (sp_report_header_add_value_child(proc->header, "dirty:", 8, SP_REPORT_ALIGN_RIGHT, write_proc_mem_dirty, NULL, (void*)proc) == NULL) return -ENOMEM;
+	if (sp_report_header_add_value_child(proc->header, "change:", 8, SP_REPORT_ALIGN_RIGHT, write_proc_mem_change, &format_change, (void*)proc) == NULL) return -ENOMEM;
+	sp_report_header_t* header = sp_report_header_add_value_child(proc->header, "CPU-%:", 7, SP_REPORT_ALIGN_RIGHT, write_proc_cpu_usage, &format_percent, (void*)proc);
+	if (header == NULL || sp_report_header_set_key(header, "cpu") != 0) return -ENOMEM;
+	/* with --memory-interval the resident set size is sampled together
+	 * with the CPU usage and the age marks the carried forward values */
+	if (memory_interval) {
+		if (sp_report_header_add_value_child(proc->header, "RSS:", 8, SP_REPORT_ALIGN_RIGHT, write_proc_mem_rss, NULL, (void*)proc) == NULL) return -ENOMEM;
+		if (sp_report_header_add_value_child(proc->header, "age:", 6, SP_REPORT_ALIGN_RIGHT, write_proc_mem_age, &format_age, (void*)proc) == NULL) return -ENOMEM;
+	}
 
 	/* set process column color if necessary */
 	if (colors && !(index & 1)) {
@@ -859,9 +1414,15 @@ proc_data_free(proc_data_t* proc)
 	if (proc) {
 		sp_measure_free_proc_data(&proc->data[0]);
 		sp_measure_free_proc_data(&proc->data[1]);
+		proc_smaps_close(&proc->smaps);
 
-		sp_report_header_remove(&proc->app_data->root_header, proc->header);
-		sp_report_header_free(proc->header);
+		/* closing the descriptor removes it also from the epoll set */
+		if (proc->pidfd != -1) close(proc->pidfd);
+
+		if (proc->header) {
+			sp_report_header_remove(&proc->app_data->root_header, proc->header);
+			sp_report_header_free(proc->header);
+		}
 
 		free(proc);
 	}
@@ -917,19 +1478,11 @@ app_data_add_proc(app_data_t* self, int pid)
 		proc_data_free(proc);
 		return NULL;
 	}
-	/* the first process to be monitored, set as the start of process list*/
-	if (self->proc_list == NULL) {
-		self->proc_list = proc;
-	}
-	else {
-		/* add at the end of process list */
-		proc_data_t* next = self->proc_list;
-		while (next->next != NULL) {
-			next = next->next;
-		}
-		next->next = proc;
+	/* add at the end of process list */
+	if (proc_table_add(&self->procs, pid, proc->start_time, proc) != 0) {
+		proc_data_free(proc);
+		return NULL;
 	}
-	self->proc_count++;
 	return proc;
 }
 
@@ -937,35 +1490,38 @@ app_data_add_proc(app_data_t* self, int pid)
  * Removes process from monitored process list.
  *
  * The process will be removed and all associated resources freed.
+ * Removal is safe while iterating the process list, the list is
+ * compacted later by app_data_compact_procs().
  * @param self[in]  the application data.
- * @param pid[in]   the process identifier.
+ * @param proc[in]  the process data.
  * @return          0 for success.
  */
 static int
-app_data_remove_proc(app_data_t* self, int pid)
+app_data_remove_proc(app_data_t* self, proc_data_t* proc)
 {
-	proc_data_t** pproc = &self->proc_list;
-	while (*pproc && FIELD_PROC_PID(&(*pproc)->data[0]) != pid) {
-		pproc = &(*pproc)->next;
-	}
-	if (*pproc) {
-		proc_data_t* free_proc = *pproc;
-		*pproc = (*pproc)->next;
-		proc_data_free(free_proc);
-		self->proc_count--;
+	if (proc_table_remove(&self->procs, FIELD_PROC_PID(&proc->data[0]), proc->start_time)) {
+		proc_data_free(proc);
 	}
+	return 0;
+}
+
+/**
+ * Compacts monitored process list after process removal.
+ *
+ * @param self[in]  the application data.
+ */
+static void
+app_data_compact_procs(app_data_t* self)
+{
+	int index = proc_table_compact(&self->procs);
 	/* reset color ordering which could get broken with column removal */
-	if (colors) {
-		int index = 0;
-		proc_data_t* proc = self->proc_list;
-		while (proc) {
-			hlight_t* hlight = &hlight_proc[(index++) & 1];
+	if (colors && index != -1) {
+		for (; index < self->procs.size; index++) {
+			proc_data_t* proc = (proc_data_t*)self->procs.entries[index].item;
+			hlight_t* hlight = &hlight_proc[(index & 1) ^ 1];
 			sp_report_header_set_color(proc->header, hlight->set, hlight->clear);
-			index ^= 1;
-			proc = proc->next;
 		}
 	}
-	return 0;
 }
 
 
@@ -992,8 +1548,15 @@ app_data_add_cgroup(app_data_t* self, const char* name)
 	return 0;
 }
 
+/**
+ * Parses interval in seconds with up to millisecond precision.
+ *
+ * @param[in] interval   the interval text.
+ * @param[out] value     the interval in microseconds.
+ * @return               0 for success.
+ */
 static int
-app_data_set_sleep_interval(app_data_t* self, const char* interval)
+parse_interval(const char* interval, unsigned long* value)
 {
 	char buffer[256] = {0};
 	int secs = 0, msecs = 0;
@@ -1015,7 +1578,14 @@ app_data_set_sleep_interval(app_data_t* self, const char* interval)
 			return -1;
 		}
 	}
-	self->sleep_interval = secs * 1000000 + msecs * 1000;
+	*value = secs * 1000000 + msecs * 1000;
+	return 0;
+}
+
+static int
+app_data_set_sleep_interval(app_data_t* self, const char* interval)
+{
+	if (parse_interval(interval, &self->sleep_interval) != 0) return -1;
 	ADD_OPTION_VALUE_FLAG(self->option_flags, OF_INTERVAL_OPTION_SET);
 	return 0;
 }
@@ -1023,136 +1593,914 @@ app_data_set_sleep_interval(app_data_t* self, const char* interval)
 /**
  * Queues process name for monitoring.
  *
- * @param[in] name   name of the process to monitor.
+ * @param[in] name   name prefix or regular expression of the process to monitor.
+ * @param[in] regex  true if the name is a regular expression.
  * @return           0 for success.
  */
 static int
-app_data_monitor_process_name(app_data_t* self, const char* name)
+app_data_monitor_process_name(app_data_t* self, const char* name, bool regex)
 {
 	if (!name) return -1;
-	if (self->name_index == sizeof(self->name_list) / sizeof(self->name_list[0])) {
-		return -1;
+	if (regex) {
+		char error[256];
+		if (name_match_add_regex(&self->names, name, error, sizeof(error)) != 0) {
+			fprintf(stderr, "ERROR: invalid regular expression '%s': %s\n", name, error);
+			return -1;
+		}
+		return 0;
+	}
+	return name_match_add_prefix(&self->names, name);
+}
+
+
+/**
+ * Reads the process command line with arguments separated by spaces.
+ *
+ * @param[in] pid      the process identifier.
+ * @param[out] buffer  the output buffer.
+ * @param[in] size     the output buffer size.
+ * @return             0 for success.
+ */
+static int
+read_proc_cmdline(int pid, char* buffer, size_t size)
+{
+	char path[64];
+	int fd, i;
+	ssize_t len;
+
+	sprintf(path, "/proc/%d/cmdline", pid);
+	if ( (fd = open(path, O_RDONLY)) == -1) return -1;
+	len = read(fd, buffer, size - 1);
+	close(fd);
+	/* kernel threads have empty command line */
+	if (len <= 0) return -1;
+	/* strip the terminating zero of the last argument */
+	if (!buffer[len - 1]) len--;
+	for (i = 0; i < len; i++) {
+		if (!buffer[i]) buffer[i] = ' ';
 	}
-	proc_name_t* proc = &self->name_list[self->name_index++];
-	proc->name = strdup(name);
-	proc->size = strlen(name);
-	return proc->name != NULL ? 0 : -ENOMEM;
+	buffer[len] = '\0';
+	return 0;
 }
 
 
 /**
  * Checks if the process is being monitored.
  *
- * @param[in]   the process name.
- * @return      true if the process is being monitored.
+ * @param[in] pid   the process identifier.
+ * @param[in] name  the process name.
+ * @return          true if the process is being monitored.
  */
 static bool
-app_data_is_process_monitored(app_data_t* self, const char* name)
+app_data_is_process_monitored(app_data_t* self, int pid, const char* name)
 {
-	proc_name_t* proc = self->name_list;
-	while (proc - self->name_list < self->name_index) {
-		if (!strncmp(name, proc->name, proc->size)) {
-			return true;
-		}
-		proc++;
+	if (do_match_cmdline) {
+		char cmdline[4096];
+		if (read_proc_cmdline(pid, cmdline, sizeof(cmdline)) != 0) return false;
+		return name_match_test(&self->names, cmdline);
 	}
-	return false;
+	return name && name_match_test(&self->names, name);
 }
 
 
 /**
  * Checks whether process exists on monitored process list.
  *
- * @param self[in]   the application data.
- * @param pid[in]    the process identifier.
- * @return           true if process exists
+ * @param self[in]         the application data.
+ * @param pid[in]          the process identifier.
+ * @param start_time[in]   the process start time, 0 for any.
+ * @return                 the process data or NULL.
  */
-static bool
-app_data_proc_exists(app_data_t* self, int pid)
+static proc_data_t*
+app_data_find_proc(app_data_t* self, int pid, unsigned long long start_time)
 {
-	proc_data_t* proc = self->proc_list;
-	while (proc) {
-		if (FIELD_PROC_PID(&proc->data[0]) == pid)
-            return true;
-        proc = proc->next;
-    }
-    return false;
+	return (proc_data_t*)proc_table_find(&self->procs, pid, start_time);
 }
 
 
 /**
- * Scans running processes and updates monitored process list
+ * Starts monitoring the process if its name matches the monitored names.
  *
  * @param[in] self    the application data.
- * @return            -1 - failure, 0 - monitored process list was not changed,
- *                    1 - a process was added or removed to the list.
+ * @param[in] pid     the process identifier.
+ * @return            0 - the process is not monitored,
+ *                    1 - the process was added to the list.
  */
 static int
-app_data_scan_processes(app_data_t* self)
+app_data_check_process(app_data_t* self, int pid)
 {
 	int rc = 0;
-	if (self->name_index) {
-		static time_t last_timestamp = 0;
-		time_t current_timestamp = time(NULL);
-		char buffer[512];
+	sp_measure_proc_data_t data;
+
+	/* the command line is matched before reading the process data */
+	if (do_match_cmdline) {
+		if (!app_data_is_process_monitored(self, pid, NULL) ||
+				app_data_find_proc(self, pid, read_proc_start_time(pid))) return 0;
+		proc_data_t* proc = app_data_add_proc(self, pid);
+		if (!proc) return 0;
+		proc_data_create_header(proc, self, self->procs.count - 1);
+		return 1;
+	}
+	if (sp_measure_init_proc_data(&data, pid, 0, NULL) == 0 &&
+			app_data_is_process_monitored(self, pid, data.common->name) &&
+			!app_data_find_proc(self, pid, read_proc_start_time(pid)) ) {
+		proc_data_t* proc = app_data_add_proc(self, pid);
+		if (proc) proc_data_create_header(proc, self, self->procs.count - 1);
+		rc = 1;
+	}
+	sp_measure_free_proc_data(&data);
+	return rc;
+}
 
-		/* first check for a new processes */
-		DIR* procDir = opendir("/proc");
-		if (procDir) {
-			struct dirent* item;
-			while ( (item = readdir(procDir)) ) {
-				int pid = atoi(item->d_name);
-				if (pid != 0) {
-					bool check = do_full_process_scan;
-					if (!check) {
-						struct stat fs;
-						sprintf(buffer, "/proc/%s", item->d_name);
-						if (stat(buffer, &fs) == 0) check = last_timestamp < fs.st_mtime;
-					}
-					if (check) {
-						sp_measure_proc_data_t data;
-						if (sp_measure_init_proc_data(&data, pid, 0, NULL) == 0 && data.common->name &&
-								app_data_is_process_monitored(self, data.common->name) &&
-								!app_data_proc_exists(self, pid) ) {
-							proc_data_t* proc = app_data_add_proc(self, pid);
-							if (proc) proc_data_create_header(proc, self, self->proc_count - 1);
-							rc = 1;
-						}
-						sp_measure_free_proc_data(&data);
-					}
-				}
-			}
-			closedir(procDir);
+/**
+ * Scans /proc for processes to monitor.
+ *
+ * @param[in] self    the application data.
+ * @return            0 - monitored process list was not changed,
+ *                    1 - a process was added to or removed from the list.
+ */
+static int
+app_data_scan_all_processes(app_data_t* self)
+{
+	static time_t last_timestamp = 0;
+	time_t current_timestamp = time(NULL);
+	char buffer[512];
+	int rc = 0, i;
+	proc_data_t* proc;
+
+	/* the rescan after lost process events removes also the processes
+	 * whose exit events were lost */
+	bool do_sweep = self->do_rescan_processes && self->proc_events.fd != -1;
+	if (do_sweep) {
+		PROC_TABLE_FOREACH(&self->procs, i, proc) {
+			proc->is_seen = false;
 		}
-		last_timestamp = current_timestamp;
+	}
 
-		/* check for terminated processes */
-		proc_data_t* proc = self->proc_list;
-		while (proc) {
-			proc_data_t* proc_free = NULL;
-			int pid = proc->data[0].common->pid;
-			sprintf(buffer, "/proc/%d", pid);
-			if (access(buffer, F_OK) != 0) {
-				proc_free = proc;
+	DIR* procDir = opendir("/proc");
+	if (procDir) {
+		struct dirent* item;
+		while ( (item = readdir(procDir)) ) {
+			int pid = atoi(item->d_name);
+			if (pid != 0) {
+				if (do_sweep && app_data_find_proc(self, pid, 0)) {
+					unsigned long long start_time = read_proc_start_time(pid);
+					if (start_time && (proc = app_data_find_proc(self, pid, start_time))) proc->is_seen = true;
+				}
+				bool check = do_full_process_scan || self->do_rescan_processes;
+				if (!check) {
+					struct stat fs;
+					sprintf(buffer, "/proc/%s", item->d_name);
+					if (stat(buffer, &fs) == 0) check = last_timestamp < fs.st_mtime;
+				}
+				if (check && app_data_check_process(self, pid)) {
+					rc = 1;
+				}
 			}
-			proc = proc->next;
-			if (proc_free) {
-				app_data_remove_proc(self, pid);
+		}
+		closedir(procDir);
+
+		if (do_sweep) {
+			PROC_TABLE_FOREACH(&self->procs, i, proc) {
+				if (proc->is_seen) continue;
+				/* the processes added by this scan are not marked */
+				unsigned long long start_time = read_proc_start_time(FIELD_PROC_PID(&proc->data[0]));
+				if (start_time && start_time == proc->start_time) continue;
+				app_data_remove_proc(self, proc);
 				rc = 1;
 			}
 		}
 	}
+	last_timestamp = current_timestamp;
+	self->do_rescan_processes = false;
 	return rc;
 }
 
+/**
+ * Process event handler.
+ *
+ * Adds new processes matching the monitored names and removes
+ * terminated processes.
+ */
+static void
+app_data_handle_proc_event(proc_events_type_t type, int pid, void* arg)
+{
+	app_data_t* self = (app_data_t*)arg;
+	switch (type) {
+	case PROC_EVENTS_COMM:
+		/* name changes are followed only by --name */
+		if (!do_full_process_scan) break;
+		/* fall through */
+	case PROC_EVENTS_FORK:
+	case PROC_EVENTS_EXEC:
+		if (app_data_check_process(self, pid)) self->is_proc_list_changed = true;
+		break;
+	case PROC_EVENTS_EXIT: {
+		proc_data_t* proc = app_data_find_proc(self, pid, 0);
+		if (proc) {
+			app_data_remove_proc(self, proc);
+			self->is_proc_list_changed = true;
+		}
+		break;
+	}
+	case PROC_EVENTS_OVERFLOW:
+		self->do_rescan_processes = true;
+		break;
+	}
+}
 
 /**
- * Execute the specified application and start monitoring it.
+ * Initializes process discovery for the monitored process names.
+ *
+ * Process events are used if requested and permitted, otherwise
+ * /proc is scanned on every update.
+ * @param[in] self    the application data.
  */
-static int
-execute_application(app_data_t* self, const char* cmd)
+static void
+app_data_init_process_discovery(app_data_t* self)
 {
-	int pid = fork();
+	int rc;
+	self->proc_events.fd = -1;
+	if (!self->names.count || !do_use_proc_events) return;
+	if ( (rc = proc_events_open(&self->proc_events)) != 0) {
+		print_warning("Warning: process events are not available (%s), scanning /proc instead.\n",
+				strerror(-rc));
+		return;
+	}
+	/* find the already running processes */
+	self->do_rescan_processes = true;
+}
+
+/**
+ * Scans running processes and updates monitored process list
+ *
+ * @param[in] self    the application data.
+ * @return            -1 - failure, 0 - monitored process list was not changed,
+ *                    1 - a process was added or removed to the list.
+ */
+static int
+app_data_scan_processes(app_data_t* self)
+{
+	int rc = 0;
+	if (self->names.count) {
+		char buffer[512];
+
+		if (self->proc_events.fd != -1) {
+			if (proc_events_read(&self->proc_events, app_data_handle_proc_event, self) < 0) {
+				print_warning("Warning: failed to read process events, scanning /proc instead.\n");
+				proc_events_close(&self->proc_events);
+				self->do_rescan_processes = true;
+			}
+			else {
+				/* the processes matching the names were found when rescanning, the
+				 * rest are added/removed by process events */
+				if (self->do_rescan_processes) rc = app_data_scan_all_processes(self);
+				return rc;
+			}
+		}
+
+		/* first check for a new processes */
+		rc = app_data_scan_all_processes(self);
+
+		/* check for terminated processes not watched with pidfd */
+		proc_data_t* proc;
+		int i;
+		PROC_TABLE_FOREACH(&self->procs, i, proc) {
+			if (proc->pidfd != -1) continue;
+			sprintf(buffer, "/proc/%d", FIELD_PROC_PID(&proc->data[0]));
+			if (access(buffer, F_OK) != 0) {
+				app_data_remove_proc(self, proc);
+				rc = 1;
+			}
+		}
+	}
+	return rc;
+}
+
+
+/**
+ * Takes the last snapshot of a monitored process.
+ *
+ * This is the worker pool task, so it must access only the data of
+ * the process itself. The results are stored into the process data and
+ * handled after all processes have been sampled.
+ * @param[in] index   the process table entry index.
+ * @param[in] arg     the application data.
+ */
+static void
+app_data_collect_proc(int index, void* arg)
+{
+	app_data_t* self = (app_data_t*)arg;
+	proc_data_t* proc = (proc_data_t*)self->procs.entries[index].item;
+	if (!proc) return;
+	uint64_t start = do_self_profile ? self_profile_now() : 0;
+	/* the memory usage is due when less than half of the sampling
+	 * interval is left until the memory interval has elapsed */
+	if (memory_interval) {
+		proc->is_memory_due = timespec_diff(&proc->memory_clock, &self->snapshot_clock) * 1000000 +
+				self->sleep_interval / 2 >= memory_interval;
+	}
+	proc->is_cmdline_changed = proc_data_check_cmdline(proc) != 0;
+	proc->snapshot_rc = proc_data_snapshot(proc, true);
+	if (do_self_profile) proc->snapshot_duration = self_profile_now() - start;
+}
+
+/**
+ * Formats typed value for the full screen view.
+ *
+ * @param[out] buffer   the output buffer.
+ * @param[in] size      the output buffer size.
+ * @param[in] value     the value.
+ * @param[in] format    the value format, NULL for plain numbers.
+ * @return              the formatted value.
+ */
+static const char*
+top_format_value(char* buffer, int size, const sp_report_value_t* value, const sp_report_format_t* format)
+{
+	switch (value->type) {
+	case SP_REPORT_VALUE_INT:
+		snprintf(buffer, size, format && format->sign ? "%+lld" : "%lld", (long long)value->i);
+		break;
+	case SP_REPORT_VALUE_DOUBLE:
+		snprintf(buffer, size, "%.*f%s", format ? format->precision : 0, value->d,
+				format && format->suffix ? format->suffix : "");
+		break;
+	case SP_REPORT_VALUE_STRING:
+		snprintf(buffer, size, "%s", value->s);
+		break;
+	default:
+		snprintf(buffer, size, "n/a");
+	}
+	return buffer;
+}
+
+/**
+ * Returns the numeric value used for sorting, unavailable values are
+ * sorted last.
+ */
+static double
+top_value_number(const sp_report_value_t* value)
+{
+	if (value->type == SP_REPORT_VALUE_INT) return value->i;
+	if (value->type == SP_REPORT_VALUE_DOUBLE) return value->d;
+	return -INFINITY;
+}
+
+/**
+ * Compares the full screen view rows in the selected sort order.
+ */
+static int
+top_compare_rows(const void* p1, const void* p2)
+{
+	const top_row_t* row1 = (const top_row_t*)p1;
+	const top_row_t* row2 = (const top_row_t*)p2;
+	double value1, value2;
+
+	switch (top_sort) {
+	case TOP_SORT_PID:
+		return row1->pid - row2->pid;
+	case TOP_SORT_NAME: {
+		int rc = strcmp(row1->name, row2->name);
+		return rc ? rc : row1->pid - row2->pid;
+	}
+	case TOP_SORT_CPU:
+		value1 = top_value_number(&row1->cpu);
+		value2 = top_value_number(&row2->cpu);
+		break;
+	case TOP_SORT_DIRTY:
+		value1 = top_value_number(&row1->dirty);
+		value2 = top_value_number(&row2->dirty);
+		break;
+	default:
+		value1 = top_value_number(&row1->change);
+		value2 = top_value_number(&row2->change);
+	}
+	/* the largest values first */
+	if (value1 != value2) return value1 < value2 ? 1 : -1;
+	return row1->pid - row2->pid;
+}
+
+/**
+ * Copies the last snapshot values into the full screen view rows.
+ *
+ * @param[in] self    the application data.
+ */
+static void
+app_data_collect_top(app_data_t* self)
+{
+	proc_data_t* proc;
+	sp_report_value_t value;
+	char used[32], change[32], cpu[32], freq[32];
+	int i, len;
+
+	if (self->procs.count > self->top_row_capacity) {
+		top_row_t* rows = (top_row_t*)realloc(self->top_rows, self->procs.count * sizeof(top_row_t));
+		if (!rows) return;
+		self->top_rows = rows;
+		self->top_row_capacity = self->procs.count;
+	}
+	self->top_row_count = 0;
+	PROC_TABLE_FOREACH(&self->procs, i, proc) {
+		top_row_t* row = &self->top_rows[self->top_row_count++];
+		row->pid = proc->data2->common->pid;
+		snprintf(row->name, sizeof(row->name), "%s", PROCESS_NAME(proc->data2));
+		row->clean.type = row->dirty.type = row->change.type = row->cpu.type = SP_REPORT_VALUE_NA;
+		write_proc_mem_clean(&row->clean, proc);
+		write_proc_mem_dirty(&row->dirty, proc);
+		write_proc_mem_change(&row->change, proc);
+		write_proc_cpu_usage(&row->cpu, proc);
+	}
+
+	/* the system summary */
+	value.type = SP_REPORT_VALUE_NA;
+	write_sys_mem_used(&value, self);
+	top_format_value(used, sizeof(used), &value, NULL);
+	value.type = SP_REPORT_VALUE_NA;
+	write_sys_mem_change(&value, self);
+	top_format_value(change, sizeof(change), &value, &format_change);
+	value.type = SP_REPORT_VALUE_NA;
+	write_sys_cpu_usage(&value, self);
+	top_format_value(cpu, sizeof(cpu), &value, &format_percent);
+	value.type = SP_REPORT_VALUE_NA;
+	write_sys_cpu_freq(&value, self);
+	top_format_value(freq, sizeof(freq), &value, NULL);
+	len = snprintf(self->top_summary, sizeof(self->top_summary),
+			"memory used: %s kB (%s)  CPU: %s  %s MHz", used, change, cpu, freq);
+
+	cgroup_data_t* cgroup;
+	for (cgroup = self->cgroups; cgroup && len < (int)sizeof(self->top_summary); cgroup = cgroup->next) {
+		value.type = SP_REPORT_VALUE_NA;
+		write_sys_mem_cgroup_used(&value, cgroup);
+		top_format_value(used, sizeof(used), &value, NULL);
+		value.type = SP_REPORT_VALUE_NA;
+		write_sys_mem_cgroup_change(&value, cgroup);
+		top_format_value(change, sizeof(change), &value, &format_change);
+		len += snprintf(self->top_summary + len, sizeof(self->top_summary) - len,
+				"  cgroup %s: %s kB (%s)", cgroup->name, used, change);
+	}
+}
+
+/* rows above the process list in the full screen view */
+#define TOP_HEADER_ROWS   5
+
+/**
+ * Draws the full screen view from the collected rows.
+ *
+ * @param[in] self    the application data.
+ */
+static void
+app_data_draw_top(app_data_t* self)
+{
+	static const char* sort_names[] = {"dirty change", "CPU", "dirty", "PID", "name"};
+	top_view_t* view = &self->top_view;
+	char timestamp[32], clean[32], dirty[32], change[32], cpu[32];
+	int visible = view->rows - TOP_HEADER_ROWS;
+	int i;
+
+	if (visible < 0) visible = 0;
+	qsort(self->top_rows, self->top_row_count, sizeof(top_row_t), top_compare_rows);
+	if (self->top_scroll > self->top_row_count - visible) self->top_scroll = self->top_row_count - visible;
+	if (self->top_scroll < 0) self->top_scroll = 0;
+
+	top_view_clear(view);
+	write_sys_timestamp(timestamp, sizeof(timestamp) - 1, self);
+	top_view_printf(view, 0, 0, "%s - %s  processes: %d  CPU: %u MHz max  RAM: %u kB  swap: %u kB",
+			progname, timestamp, self->top_row_count, FIELD_SYS_CPU_MAX_FREQ(self->sys_data1) / 1000,
+			FIELD_SYS_MEM_TOTAL(self->sys_data1), FIELD_SYS_MEM_SWAP(self->sys_data1));
+	top_view_printf(view, 1, 0, "%s", self->top_summary);
+	top_view_printf(view, 2, 0, "sort: %-12s  keys: d/c/m/p/n sort, up/down/PgUp/PgDn scroll, l redraw, q quit",
+			sort_names[top_sort]);
+	if (*top_warning) top_view_printf(view, 3, 0, "%s", top_warning);
+	top_view_printf(view, 4, 0, "%7s %-24s %9s %9s %8s %6s", "PID", "NAME", "CLEAN", "DIRTY", "CHANGE", "CPU-%");
+	top_view_highlight(view, 4);
+
+	for (i = 0; i < visible && self->top_scroll + i < self->top_row_count; i++) {
+		const top_row_t* row = &self->top_rows[self->top_scroll + i];
+		top_view_printf(view, TOP_HEADER_ROWS + i, 0, "%7d %-24.24s %9s %9s %8s %6s", row->pid, row->name,
+				top_format_value(clean, sizeof(clean), &row->clean, NULL),
+				top_format_value(dirty, sizeof(dirty), &row->dirty, NULL),
+				top_format_value(change, sizeof(change), &row->change, &format_change),
+				top_format_value(cpu, sizeof(cpu), &row->cpu, &format_percent));
+	}
+	top_view_flush(view);
+}
+
+/**
+ * Handles the full screen view key presses.
+ *
+ * @param[in] self    the application data.
+ */
+static void
+app_data_handle_top_keys(app_data_t* self)
+{
+	int key, page = self->top_view.rows - TOP_HEADER_ROWS - 1;
+
+	if (page < 1) page = 1;
+	while ( (key = top_view_read_key(&self->top_view)) != TOP_VIEW_NO_KEY) {
+		switch (key) {
+		case 'd': top_sort = TOP_SORT_DIRTY_CHANGE; break;
+		case 'c': top_sort = TOP_SORT_CPU; break;
+		case 'm': top_sort = TOP_SORT_DIRTY; break;
+		case 'p': top_sort = TOP_SORT_PID; break;
+		case 'n': top_sort = TOP_SORT_NAME; break;
+		case TOP_VIEW_KEY_UP: self->top_scroll--; break;
+		case TOP_VIEW_KEY_DOWN: self->top_scroll++; break;
+		case TOP_VIEW_KEY_PAGE_UP: self->top_scroll -= page; break;
+		case TOP_VIEW_KEY_PAGE_DOWN: self->top_scroll += page; break;
+		/* warnings written to stderr can mess up the screen */
+		case 'l':
+		case 'L' & 0x1f: self->top_view.is_invalid = true; break;
+		case 'q': quit = 1; return;
+		}
+	}
+	app_data_draw_top(self);
+}
+
+/**
+ * Swaps the snapshot references.
+ *
+ * The last snapshots become the base for the next snapshot changes.
+ * @param[in] self    the application data.
+ */
+static void
+app_data_swap_snapshots(app_data_t* self)
+{
+	/* swap snapshot references so last snapshot is again in app_data.sys_data1 and
+	 * the next snapshot will be stored into app_data.sys_data2 */
+	sp_measure_sys_data_t* sys_data_swap = self->sys_data1;
+	self->sys_data1 = self->sys_data2;
+	self->sys_data2 = sys_data_swap;
+	/* the reported snapshot is not overwritten, take the spare one */
+	if (self->sys_data2 == self->sys_reported) {
+		self->sys_data2 = &self->sys_data[3 - (self->sys_data1 - self->sys_data) - (self->sys_reported - self->sys_data)];
+	}
+	self->base_clock = self->snapshot_clock;
+	/* do the same for project snapshots */
+	proc_data_t* proc;
+	int i;
+	PROC_TABLE_FOREACH(&self->procs, i, proc) {
+		sp_measure_proc_data_t* proc_data_swap = proc->data1;
+		proc->data1 = proc->data2;
+		proc->data2 = proc_data_swap;
+		proc_sample_t* proc_sample_swap = proc->sample1;
+		proc->sample1 = proc->sample2;
+		proc->sample2 = proc_sample_swap;
+	}
+
+	/* swap cgroups data snapshots */
+	cgroup_data_t* cgroup = self->cgroups;
+	while (cgroup) {
+		cgroup_swap(cgroup);
+		cgroup = cgroup->next;
+	}
+}
+
+/**
+ * Makes the last snapshots the baseline of the change-only options.
+ *
+ * @param[in] self    the application data.
+ */
+static void
+app_data_mark_reported(app_data_t* self)
+{
+	proc_data_t* proc;
+	int i;
+	self->sys_reported = self->sys_data2;
+	PROC_TABLE_FOREACH(&self->procs, i, proc) {
+		proc->reported = *proc->sample2;
+	}
+}
+
+/**
+ * Retrieves the work phase start time for the self profile.
+ *
+ * @return   the start time or 0 if --self-profile is not used.
+ */
+static uint64_t
+profile_start(void)
+{
+	return do_self_profile ? self_profile_now() : 0;
+}
+
+/**
+ * Adds the work phase duration to the self profile.
+ *
+ * @param[in] self    the application data.
+ * @param[in] phase   the phase.
+ * @param[in] start   the phase start time from profile_start().
+ */
+static void
+app_data_profile(app_data_t* self, int phase, uint64_t start)
+{
+	if (do_self_profile) self_profile_add(&self->profile, phase, self_profile_now() - start);
+}
+
+/**
+ * Starts the report output.
+ *
+ * The output is rendered into memory, so the rendering and the output
+ * I/O are profiled separately. With --queue it's rendered into an output
+ * queue entry, which is written by the writer thread. The entries dropped
+ * before it are marked when --overrun-marker is used.
+ * @param[in] self    the application data.
+ * @return            the output stream or NULL if the queue is full and
+ *                    the output is dropped.
+ */
+static FILE*
+app_data_begin_output(app_data_t* self)
+{
+	unsigned dropped;
+	if (!output_queue_size) {
+		/* fall back to the direct output if the memory stream can't be created */
+		if (!self->render_stream &&
+				(self->render_stream = open_memstream(&self->render_data, &self->render_size)) == NULL) return output;
+		rewind(self->render_stream);
+		return self->render_stream;
+	}
+
+	FILE* fp = output_queue_begin(&self->output_queue, &dropped);
+	if (fp && dropped && do_print_overrun_marker && output_format != OUTPUT_FORMAT_LOG) {
+		if (output_format == OUTPUT_FORMAT_JSONL) fprintf(fp, "{\"dropped\":%u}\n", dropped);
+		else fprintf(fp, "# dropped: %u sample(s)\n", dropped);
+	}
+	return fp;
+}
+
+/**
+ * Ends the report output started with app_data_begin_output().
+ *
+ * The output is written and flushed or queued to the writer thread.
+ * @param[in] self    the application data.
+ */
+static void
+app_data_end_output(app_data_t* self)
+{
+	int rc;
+	if (!output_queue_size) {
+		off_t size = self->render_stream ? ftello(self->render_stream) : 0;
+		if (size > 0 && fflush(self->render_stream) == 0) fwrite(self->render_data, 1, size, output);
+		fflush(output);
+	}
+	else if ( (rc = output_queue_commit(&self->output_queue)) != 0) {
+		print_warning("Warning: failed to queue the output (%s).\n", strerror(-rc));
+	}
+}
+
+/**
+ * Prints the last snapshots and swaps the snapshot references.
+ *
+ * After printing the last snapshots become the base for the next
+ * snapshot changes.
+ * @param[in] self             the application data.
+ * @param[in] do_print_header  print the report header first.
+ * @return                     false if the output queue was full and
+ *                             the snapshots were not printed.
+ */
+static bool
+app_data_print_report(app_data_t* self, bool do_print_header)
+{
+	FILE* fp = NULL;
+	uint64_t start = profile_start();
+	int rc;
+
+	if (top) {
+		app_data_collect_top(self);
+		app_data_draw_top(self);
+		app_data_profile(self, PROFILE_RENDER, start);
+	}
+	else if ( (fp = app_data_begin_output(self)) != NULL) {
+		if (do_print_header) {
+			if (output_format == OUTPUT_FORMAT_CSV) rc = sp_report_print_header_csv(fp, &self->root_header);
+			else rc = sp_report_print_header(fp, &self->root_header);
+			if (rc != 0) {
+				fprintf(stderr, "ERROR: failed to print report header (%d).\n", rc);
+				exit(-1);
+			}
+		}
+		switch (output_format) {
+		case OUTPUT_FORMAT_CSV:
+			sp_report_print_data_csv(fp, &self->root_header);
+			break;
+		case OUTPUT_FORMAT_JSONL:
+			sp_report_print_data_jsonl(fp, &self->root_header);
+			break;
+		case OUTPUT_FORMAT_LOG:
+			/* the log records are written into the queue entry */
+			self->log_writer.fp = fp;
+			if ( (rc = sample_log_writer_add(&self->log_writer, &self->root_header, &self->snapshot_time)) != 0) {
+				print_warning("Warning: failed to write the log sample (%s).\n", strerror(-rc));
+			}
+			break;
+		default:
+			sp_report_print_data(fp, &self->root_header);
+		}
+		app_data_profile(self, PROFILE_RENDER, start);
+		start = profile_start();
+		app_data_end_output(self);
+		app_data_profile(self, PROFILE_FLUSH, start);
+	}
+
+	app_data_mark_reported(self);
+	app_data_swap_snapshots(self);
+	self->is_report_pending = false;
+	return top || fp;
+}
+
+/**
+ * Writes the flight recorder samples into the dump file.
+ *
+ * @param[in] self    the application data.
+ * @param[in] reason  the dump reason.
+ */
+static void
+app_data_dump_recorder(app_data_t* self, const char* reason)
+{
+	int rc;
+	self->recorder_countdown = 0;
+	FILE* fp = fopen(dump_path, "a");
+	if (!fp) {
+		fprintf(stderr, "ERROR: failed to open dump file %s (%s).\n", dump_path, strerror(errno));
+		return;
+	}
+	rc = flight_recorder_dump(&self->recorder, fp, reason);
+	fclose(fp);
+	if (rc < 0) {
+		fprintf(stderr, "ERROR: failed to write dump file %s (%s).\n", dump_path, strerror(-rc));
+		return;
+	}
+	if (output_format == OUTPUT_FORMAT_LOG) {
+		fprintf(stderr, "# flight recorder: %d sample(s) dumped to %s (%s)\n", rc, dump_path, reason);
+	}
+	else if ( (fp = app_data_begin_output(self)) != NULL) {
+		if (output_format == OUTPUT_FORMAT_JSONL) fprintf(fp, "{\"dump\":%d}\n", rc);
+		else fprintf(fp, "# flight recorder: %d sample(s) dumped to %s (%s)\n", rc, dump_path, reason);
+		app_data_end_output(self);
+	}
+}
+
+/**
+ * Triggers the flight recorder dump.
+ *
+ * Half of the ring is recorded after the trigger, so the dump shows
+ * both what led to the incident and what followed it. Triggers are
+ * ignored until the pending dump has been written.
+ * @param[in] self    the application data.
+ * @param[in] reason  the dump reason.
+ */
+static void
+app_data_trigger_recorder(app_data_t* self, const char* reason)
+{
+	if (self->recorder_countdown) return;
+	self->recorder_reason = reason;
+	self->recorder_countdown = self->recorder.capacity / 2 + 1;
+}
+
+/**
+ * Records the last snapshots and swaps the snapshot references.
+ *
+ * The triggered or requested dump is written when due.
+ * @param[in] self    the application data.
+ */
+static void
+app_data_record(app_data_t* self)
+{
+	int rc;
+	if ( (rc = flight_recorder_add(&self->recorder, &self->root_header, &self->snapshot_time)) != 0) {
+		print_warning("Warning: failed to record the sample (%s).\n", strerror(-rc));
+	}
+	app_data_swap_snapshots(self);
+
+	if (is_dump_requested) {
+		is_dump_requested = 0;
+		app_data_dump_recorder(self, "signal");
+	}
+	else if (self->recorder_countdown && --self->recorder_countdown == 0) {
+		app_data_dump_recorder(self, self->recorder_reason);
+	}
+}
+
+/**
+ * Reads the memory pressure stall information.
+ *
+ * @return   the percentage of time some tasks were stalled on memory
+ *           during the last 10 seconds or -1 if not available.
+ */
+static float
+read_memory_pressure(void)
+{
+	float value = -1;
+	FILE* fp = fopen("/proc/pressure/memory", "r");
+	if (fp) {
+		if (fscanf(fp, "some avg10=%f", &value) != 1) value = -1;
+		fclose(fp);
+	}
+	return value;
+}
+
+/**
+ * Stops monitoring a terminated process.
+ *
+ * If the last snapshot of the process was not printed because of the
+ * change-only output options, it is printed before the column is removed.
+ * @param[in] self    the application data.
+ * @param[in] proc    the terminated process.
+ */
+static void
+app_data_handle_proc_exit(app_data_t* self, proc_data_t* proc)
+{
+	if (self->is_report_pending) {
+		app_data_print_report(self, false);
+	}
+	app_data_remove_proc(self, proc);
+	self->is_proc_list_changed = true;
+}
+
+/**
+ * Creates the event set used for waiting the next sampling deadline.
+ *
+ * @param[in] self    the application data.
+ * @return            0 for success.
+ */
+static int
+app_data_init_events(app_data_t* self)
+{
+	self->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	return self->epoll_fd == -1 ? -errno : 0;
+}
+
+/**
+ * Waits for the next sampling deadline.
+ *
+ * Monitored processes are removed as soon as they terminate while waiting.
+ * @param[in] self    the application data.
+ * @param[in] timer   the sampling timer, registered in the event set.
+ * @return            the number of missed sampling deadlines or -1 in the
+ *                    case of failure (errno is EINTR if interrupted by
+ *                    a signal).
+ */
+static int
+app_data_wait(app_data_t* self, sample_timer_t* timer)
+{
+	struct epoll_event events[MAX_WAIT_EVENTS];
+	while (true) {
+		bool is_timer_expired = false;
+		int i, count = epoll_wait(self->epoll_fd, events, MAX_WAIT_EVENTS, -1);
+		if (count == -1) return -1;
+
+		/* handle process terminations first, so the removed processes
+		 * won't be sampled anymore */
+		for (i = 0; i < count; i++) {
+			if (events[i].data.ptr == &self->top_view) {
+				app_data_handle_top_keys(self);
+			}
+			else if (events[i].data.ptr) {
+				app_data_handle_proc_exit(self, (proc_data_t*)events[i].data.ptr);
+			}
+			else {
+				is_timer_expired = true;
+			}
+		}
+		if (quit) {
+			errno = EINTR;
+			return -1;
+		}
+		if (is_timer_expired) {
+			return sample_timer_wait(timer);
+		}
+	}
+}
+
+/**
+ * Adapts the sampling interval to the observed changes.
+ *
+ * The interval drops to the minimum as soon as a change is seen and is
+ * doubled, up to the maximum, after every sample without changes.
+ * @param[in] self        the application data.
+ * @param[in] timer       the sampling timer.
+ * @param[in] is_changed  a change was seen in the last sample.
+ */
+static void
+app_data_adapt_interval(app_data_t* self, sample_timer_t* timer, bool is_changed)
+{
+	unsigned long interval = adaptive_interval_min;
+	int rc;
+	if (!is_changed) {
+		interval = timer->interval * 2;
+		if (interval > adaptive_interval_max) interval = adaptive_interval_max;
+	}
+	if (interval != timer->interval && (rc = sample_timer_set_interval(timer, interval)) != 0) {
+		print_warning("Warning: failed to change the sampling interval (%s).\n", strerror(-rc));
+	}
+	self->sleep_interval = interval;
+}
+
+/**
+ * Execute the specified application and start monitoring it.
+ */
+static int
+execute_application(app_data_t* self, const char* cmd)
+{
+	int pid = fork();
 	if (pid == 0) {
 		char* argv[100];
 		char buffer[512];
@@ -1222,7 +2570,7 @@ parse_cmdline(int argc, char** argv, app_data_t* self)
 {
 	int opt;
 	char* output_path = NULL;
-	while ((opt = getopt_long(argc, argv, "p:hf:mcM:C:i:n:x:N:G:", long_opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "p:hf:mcM:C:i:n:x:N:G:j:", long_opts, NULL)) != -1) {
 		/* getopt allows -<char><arg> which gives confusing results
 		 * when one writes --name foobar as -name.  Complain about it.
 		 */
@@ -1240,6 +2588,12 @@ parse_cmdline(int argc, char** argv, app_data_t* self)
 		case 1001:
 			colors = false;
 			break;
+		case 1003:
+			do_print_overrun_marker = true;
+			break;
+		case 1004:
+			do_use_proc_events = true;
+			break;
 		case 1002:
 			if ( app_data_add_proc(self, getpid()) == NULL) {
 				fprintf(stderr, "Error during process %d monitoring initialization!\n",
@@ -1281,13 +2635,124 @@ parse_cmdline(int argc, char** argv, app_data_t* self)
 			}
 			break;
 		case 'n':
+		case 1005:
 			do_full_process_scan = true;
 		case 'N':
-			if (app_data_monitor_process_name(self, optarg) != 0) {
+		case 1006:
+			if (app_data_monitor_process_name(self, optarg, opt == 1005 || opt == 1006) != 0) {
 				fprintf(stderr, "ERROR: failed to monitor process %s\n", optarg);
 				exit(1);
 			}
 			break;
+		case 1007:
+			do_match_cmdline = true;
+			break;
+		case 1008:
+			if (!strcmp(optarg, "spmeasure")) collector = COLLECTOR_SPMEASURE;
+			else if (!strcmp(optarg, "smaps")) collector = COLLECTOR_SMAPS;
+			else {
+				fprintf(stderr, "ERROR: unknown collector %s\n", optarg);
+				exit(1);
+			}
+			break;
+		case 'j':
+			if ( (jobs = atoi(optarg)) < 1) {
+				fprintf(stderr, "ERROR: invalid number of jobs %s\n", optarg);
+				exit(1);
+			}
+			break;
+		case 1010:
+			top = true;
+			break;
+		case 1011:
+			if ( (flight_recorder_samples = atoi(optarg)) < 1) {
+				fprintf(stderr, "ERROR: invalid number of flight recorder samples %s\n", optarg);
+				exit(1);
+			}
+			break;
+		case 1012:
+			dump_path = optarg;
+			break;
+		case 1013:
+			if ( (trigger_dirty = atoi(optarg)) < 1) {
+				fprintf(stderr, "ERROR: invalid dirty memory growth trigger %s\n", optarg);
+				exit(1);
+			}
+			break;
+		case 1014:
+			if (sscanf(optarg, "%f", &trigger_psi) != 1 || trigger_psi <= 0) {
+				fprintf(stderr, "ERROR: invalid memory pressure trigger %s\n", optarg);
+				exit(1);
+			}
+			break;
+		case 1015:
+			replay_path = optarg;
+			break;
+		case 1016:
+		case 1017: {
+			char* end;
+			double time = strtod(optarg, &end);
+			if (*end || time <= 0) {
+				fprintf(stderr, "ERROR: invalid replay time %s\n", optarg);
+				exit(1);
+			}
+			*(opt == 1016 ? &replay_from : &replay_to) = llround(time * 1000000);
+			break;
+		}
+		case 1018:
+			output_queue_size = atoi(optarg);
+			if (output_queue_size < 1) {
+				fprintf(stderr, "ERROR: invalid output queue size %s\n", optarg);
+				exit(1);
+			}
+			break;
+		case 1019:
+			if (!strcmp(optarg, "sample")) flush_policy = OUTPUT_QUEUE_FLUSH_ENTRY;
+			else if (!strcmp(optarg, "idle")) flush_policy = OUTPUT_QUEUE_FLUSH_IDLE;
+			else if ( (flush_policy = atoi(optarg)) < 1) {
+				fprintf(stderr, "ERROR: invalid flush policy %s\n", optarg);
+				exit(1);
+			}
+			break;
+		case 1020:
+			do_self_profile = true;
+			break;
+		case 1022:
+			if (parse_interval(optarg, &memory_interval) != 0) exit(1);
+			if (!memory_interval) {
+				fprintf(stderr, "ERROR: invalid memory interval %s\n", optarg);
+				exit(1);
+			}
+			break;
+		case 1021: {
+			char min[256];
+			const char* max = strchr(optarg, ',');
+			if (!max || max - optarg >= (int)sizeof(min)) {
+				fprintf(stderr, "ERROR: invalid adaptive interval range %s\n", optarg);
+				exit(1);
+			}
+			memcpy(min, optarg, max - optarg);
+			min[max - optarg] = '\0';
+			if (parse_interval(min, &adaptive_interval_min) != 0 ||
+					parse_interval(max + 1, &adaptive_interval_max) != 0) exit(1);
+			if (!adaptive_interval_min || adaptive_interval_max < adaptive_interval_min) {
+				fprintf(stderr, "ERROR: invalid adaptive interval range %s\n", optarg);
+				exit(1);
+			}
+			break;
+		}
+		case 1009:
+			if (!strcmp(optarg, "text")) output_format = OUTPUT_FORMAT_TEXT;
+			else if (!strcmp(optarg, "csv")) output_format = OUTPUT_FORMAT_CSV;
+			else if (!strcmp(optarg, "jsonl")) output_format = OUTPUT_FORMAT_JSONL;
+			else if (!strcmp(optarg, "log")) output_format = OUTPUT_FORMAT_LOG;
+			else {
+				fprintf(stderr, "ERROR: unknown output format %s\n", optarg);
+				exit(1);
+			}
+			/* no colors in machine readable formats */
+			if (output_format != OUTPUT_FORMAT_TEXT) colors = false;
+			break;
 		case 'x':
 			if (execute_application(self, optarg) != 0) {
 				fprintf(stderr, "ERROR: failed to execute command %s\n", optarg);
@@ -1328,12 +2793,24 @@ parse_cmdline(int argc, char** argv, app_data_t* self)
 		++optind;
 	}
 	// determine if no printing needs to be done by default
-	if (self->proc_list &&
+	if (self->procs.count &&
 		(IS_OPTION_VALUE_FLAG_SET(self->option_flags, OF_PROC_MEM_CHANGES_ONLY) ||
 		 IS_OPTION_VALUE_FLAG_SET(self->option_flags, OF_PROC_CPU_CHANGES_ONLY) ) ) {
 
 		do_print_report_default = false;
 	}
+	// with adaptive interval the change-only options control the
+	// sampling rate instead of the output
+	if (adaptive_interval_min) {
+		if (!(self->option_flags & (OF_PROC_MEM_CHANGES_ONLY | OF_PROC_CPU_CHANGES_ONLY |
+				OF_SYS_MEM_CHANGES_ONLY | OF_SYS_CPU_CHANGES_ONLY))) {
+			fprintf(stderr, "ERROR: --adaptive requires -m, -c, -M or -C to detect the changes.\n");
+			exit(1);
+		}
+		do_print_report_default = true;
+		if (self->sleep_interval < adaptive_interval_min) self->sleep_interval = adaptive_interval_min;
+		if (self->sleep_interval > adaptive_interval_max) self->sleep_interval = adaptive_interval_max;
+	}
 }
 
 /* When printing results to console, we want to periodically reprint the
@@ -1353,6 +2830,322 @@ error:
 	return 0;
 }
 
+/**
+ * Restores the terminal from the full screen view, also when exiting
+ * because of an error.
+ */
+static void
+release_top_view(void)
+{
+	if (top_view_active) {
+		top_view_release(top_view_active);
+		top_view_active = NULL;
+	}
+}
+
+/**
+ * The replayed data column.
+ */
+typedef struct replay_column_t {
+	/* the log or the dump reader */
+	sample_log_reader_t* log;
+	flight_recorder_reader_t* dump;
+	int index;
+} replay_column_t;
+
+/**
+ * Retrieves replayed column value.
+ *
+ * @param[in] column   the replayed column.
+ * @param[out] value   the value.
+ * @param[out] buffer  the buffer of SP_REPORT_VALUE_BUFFER_SIZE bytes
+ *                     for string values.
+ */
+static void
+replay_column_get_value(replay_column_t* column, sp_report_value_t* value, char* buffer)
+{
+	if (column->log) sample_log_reader_get_value(column->log, column->index, value, buffer);
+	else *value = column->dump->values[column->index];
+}
+
+/**
+ * Writes replayed text column value.
+ */
+static int
+replay_write_text(char* buffer, int size, void* args)
+{
+	replay_column_t* column = (replay_column_t*)args;
+	char text[SP_REPORT_VALUE_BUFFER_SIZE];
+	sp_report_value_t value;
+	replay_column_get_value(column, &value, text);
+	if (value.type == SP_REPORT_VALUE_NA) {
+		*buffer = '\0';
+		return 0;
+	}
+	return snprintf(buffer, size + 1, "%s", value.s);
+}
+
+/**
+ * Writes replayed timestamp.
+ *
+ * The timestamp is written from the sample time like write_sys_timestamp()
+ * does, as the wall clock time in the machine readable formats and as
+ * the time of day in the formatted table. The milliseconds are printed
+ * only if the recorded column had room for them.
+ */
+static int
+replay_write_timestamp(char* buffer, int size, void* args)
+{
+	replay_column_t* column = (replay_column_t*)args;
+	int64_t time = column->log ? column->log->time : (int64_t)(column->dump->time / 1000);
+	time_t seconds = time / 1000000;
+	int msecs = time % 1000000 / 1000;
+	if (output_format != OUTPUT_FORMAT_TEXT) return snprintf(buffer, size + 1, "%ld.%03d", (long)seconds, msecs);
+	struct tm tm;
+	localtime_r(&seconds, &tm);
+	if (size < 12) return snprintf(buffer, size + 1, "%02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
+	return snprintf(buffer, size + 1, "%02d:%02d:%02d.%03d", tm.tm_hour, tm.tm_min, tm.tm_sec, msecs);
+}
+
+/**
+ * Retrieves replayed typed column value.
+ */
+static void
+replay_get_value(sp_report_value_t* value, void* args)
+{
+	char text[SP_REPORT_VALUE_BUFFER_SIZE];
+	/* typed values don't use the text buffer */
+	replay_column_get_value((replay_column_t*)args, value, text);
+}
+
+/**
+ * Creates the report header structure from the recorded schema.
+ *
+ * @param[in] root       the report root header.
+ * @param[in] schema     the schema.
+ * @param[in] log        the log reader or NULL.
+ * @param[in] dump       the dump reader or NULL.
+ * @param[out] columns   the replayed data columns.
+ * @return               0 for success.
+ */
+static int
+replay_create_header(sp_report_header_t* root, const report_schema_t* schema, sample_log_reader_t* log,
+		flight_recorder_reader_t* dump, replay_column_t** columns)
+{
+	int i, column = 0;
+
+	sp_report_free(root);
+	memset(root, 0, sizeof(sp_report_header_t));
+	free(*columns);
+	if ( (*columns = calloc(schema->column_count + 1, sizeof(replay_column_t))) == NULL) return -ENOMEM;
+	/* the last header at each level, the parents of the next nodes */
+	sp_report_header_t** parents = calloc(schema->node_count + 1, sizeof(sp_report_header_t*));
+	if (!parents) return -ENOMEM;
+
+	for (i = 0; i < schema->node_count; i++) {
+		const report_schema_node_t* node = &schema->nodes[i];
+		sp_report_header_t* parent = node->depth ? parents[node->depth - 1] : root;
+		sp_report_header_t* header;
+
+		if (node->flags & REPORT_SCHEMA_NODE_LEAF) {
+			replay_column_t* data = &(*columns)[column];
+			data->log = log;
+			data->dump = dump;
+			data->index = column++;
+			if (node->flags & REPORT_SCHEMA_NODE_TYPED) {
+				sp_report_format_t format = {
+						.sign = node->flags & REPORT_SCHEMA_NODE_SIGN,
+						.precision = node->precision,
+						.suffix = node->suffix,
+				};
+				header = sp_report_header_add_value_child(parent, node->title, node->size, node->alignment,
+						replay_get_value, &format, data);
+			}
+			else {
+				bool is_timestamp = !node->depth && node->key && !strcmp(node->key, "time");
+				header = sp_report_header_add_child(parent, node->title, node->size, node->alignment,
+						is_timestamp ? replay_write_timestamp : replay_write_text, data);
+			}
+		}
+		else {
+			header = sp_report_header_add_child(parent, node->title, node->size, node->alignment, NULL, NULL);
+		}
+		if (!header || (node->key && sp_report_header_set_key(header, node->key) != 0)) {
+			free(parents);
+			return -ENOMEM;
+		}
+		parents[node->depth] = header;
+	}
+	free(parents);
+	return 0;
+}
+
+/**
+ * Prints the samples of the compact log in the output format.
+ *
+ * @return   0 for success.
+ */
+static int
+replay_log(void)
+{
+	sample_log_reader_t reader;
+	sample_log_writer_t writer;
+	sp_report_header_t root;
+	replay_column_t* columns = NULL;
+	bool do_print_header = false;
+	int rc;
+
+	memset(&root, 0, sizeof(root));
+	if ( (rc = sample_log_reader_open(&reader, replay_path)) != 0) {
+		fprintf(stderr, "ERROR: failed to open log %s (%s).\n", replay_path, strerror(-rc));
+		return -1;
+	}
+	if (replay_from && (rc = sample_log_reader_seek(&reader, replay_from)) != 0) {
+		fprintf(stderr, "ERROR: failed to seek log %s (%s).\n", replay_path, strerror(-rc));
+		sample_log_reader_close(&reader);
+		return -1;
+	}
+	if (output_format == OUTPUT_FORMAT_LOG && (rc = sample_log_writer_init(&writer, output)) != 0) {
+		fprintf(stderr, "ERROR: failed to write log (%s).\n", strerror(-rc));
+		sample_log_reader_close(&reader);
+		return -1;
+	}
+
+	while ( (rc = sample_log_reader_next(&reader)) > 0) {
+		if (rc == SAMPLE_LOG_SCHEMA) {
+			if ( (rc = replay_create_header(&root, &reader.schema, &reader, NULL, &columns)) != 0) break;
+			do_print_header = true;
+			continue;
+		}
+		/* the range is compared in the printed millisecond resolution */
+		if (reader.time / 1000 < replay_from / 1000) continue;
+		if (replay_to && reader.time / 1000 > replay_to / 1000) break;
+
+		if (do_print_header) {
+			if (output_format == OUTPUT_FORMAT_TEXT) sp_report_print_header(output, &root);
+			else if (output_format == OUTPUT_FORMAT_CSV) sp_report_print_header_csv(output, &root);
+			do_print_header = false;
+		}
+		switch (output_format) {
+		case OUTPUT_FORMAT_CSV:
+			sp_report_print_data_csv(output, &root);
+			break;
+		case OUTPUT_FORMAT_JSONL:
+			sp_report_print_data_jsonl(output, &root);
+			break;
+		case OUTPUT_FORMAT_LOG: {
+			struct timespec time = {.tv_sec = reader.time / 1000000, .tv_nsec = reader.time % 1000000 * 1000};
+			rc = sample_log_writer_add(&writer, &root, &time);
+			break;
+		}
+		default:
+			sp_report_print_data(output, &root);
+		}
+		if (rc < 0) break;
+	}
+	if (rc < 0) fprintf(stderr, "ERROR: failed to replay log %s (%s).\n", replay_path, strerror(-rc));
+
+	if (output_format == OUTPUT_FORMAT_LOG) sample_log_writer_close(&writer);
+	fflush(output);
+	sample_log_reader_close(&reader);
+	sp_report_free(&root);
+	free(columns);
+	return rc < 0 ? -1 : 0;
+}
+
+/**
+ * Prints the samples of the flight recorder dumps in the output format.
+ *
+ * @return   0 for success.
+ */
+static int
+replay_dump(void)
+{
+	flight_recorder_reader_t reader;
+	sp_report_header_t root;
+	replay_column_t* columns = NULL;
+	bool is_schema_changed = false;
+	int rc;
+
+	if (output_format == OUTPUT_FORMAT_LOG) {
+		fprintf(stderr, "ERROR: flight recorder dumps can't be replayed into a log.\n");
+		return -1;
+	}
+	memset(&root, 0, sizeof(root));
+	if ( (rc = flight_recorder_reader_open(&reader, replay_path)) != 0) {
+		fprintf(stderr, "ERROR: failed to open dump file %s (%s).\n", replay_path, strerror(-rc));
+		return -1;
+	}
+
+	while ( (rc = flight_recorder_reader_next(&reader)) > 0) {
+		if (rc == FLIGHT_RECORDER_DUMP) {
+			if (output_format == OUTPUT_FORMAT_JSONL) {
+				fprintf(output, "{\"dump\":%u,\"overwritten\":%u}\n", reader.sample_count, reader.overwritten);
+			}
+			else {
+				time_t seconds = reader.dump_time / 1000000000;
+				struct tm tm;
+				localtime_r(&seconds, &tm);
+				fprintf(output, "# flight recorder dump at %02d:%02d:%02d: %u sample(s), %u overwritten (%s)\n",
+						tm.tm_hour, tm.tm_min, tm.tm_sec, reader.sample_count, reader.overwritten, reader.reason);
+			}
+			continue;
+		}
+		if (rc == FLIGHT_RECORDER_RECORD_SCHEMA) {
+			/* the header is printed before the first sample in the range */
+			is_schema_changed = true;
+			continue;
+		}
+		/* the range is compared in the printed millisecond resolution */
+		int64_t time = reader.time / 1000;
+		if (time / 1000 < replay_from / 1000) continue;
+		if (replay_to && time / 1000 > replay_to / 1000) continue;
+
+		if (is_schema_changed) {
+			if ( (rc = replay_create_header(&root, &reader.schema, NULL, &reader, &columns)) != 0) break;
+			if (output_format == OUTPUT_FORMAT_TEXT) sp_report_print_header(output, &root);
+			else if (output_format == OUTPUT_FORMAT_CSV) sp_report_print_header_csv(output, &root);
+			is_schema_changed = false;
+		}
+		switch (output_format) {
+		case OUTPUT_FORMAT_CSV:
+			sp_report_print_data_csv(output, &root);
+			break;
+		case OUTPUT_FORMAT_JSONL:
+			sp_report_print_data_jsonl(output, &root);
+			break;
+		default:
+			sp_report_print_data(output, &root);
+		}
+	}
+	if (rc < 0) fprintf(stderr, "ERROR: failed to replay dump file %s (%s).\n", replay_path, strerror(-rc));
+
+	fflush(output);
+	flight_recorder_reader_close(&reader);
+	sp_report_free(&root);
+	free(columns);
+	return rc < 0 ? -1 : 0;
+}
+
+/**
+ * Checks if the file is a flight recorder dump.
+ *
+ * @param[in] path   the file path.
+ * @return           true if the file starts with the dump magic.
+ */
+static bool
+is_flight_recorder_dump(const char* path)
+{
+	char magic[4];
+	bool is_dump = false;
+	FILE* fp = fopen(path, "r");
+	if (fp) {
+		is_dump = fread(magic, sizeof(magic), 1, fp) == 1 && !memcmp(magic, FLIGHT_RECORDER_MAGIC, sizeof(magic));
+		fclose(fp);
+	}
+	return is_dump;
+}
+
 /**
  * Main function
  */
@@ -1364,16 +3157,30 @@ int main(int argc, char** argv)
 			.resource_flags = SNAPSHOT_SYS,
 			.sleep_interval = DEFAULT_SLEEP_INTERVAL,
 	};
-	int rc = 0, value;
-	sp_measure_proc_data_t* proc_data_swap;
-	sp_measure_sys_data_t* sys_data_swap;
+	int rc = 0, value, i;
 	proc_data_t* proc;
 	bool do_print_header = true;
 	bool do_print_report;
-	struct timeval timestamp = {0, 0};
+	sample_timer_t timer;
+	bool is_overrun_reported = false;
+	bool is_first_sample = true;
+
+	if ( (rc = app_data_init_events(&app_data)) != 0) {
+		fprintf(stderr, "ERROR: failed to create event set (%s).\n", strerror(-rc));
+		exit(-1);
+	}
 
 	parse_cmdline(argc, argv, &app_data);
 
+	if (output_format == OUTPUT_FORMAT_LOG && isatty(fileno(output))) {
+		fprintf(stderr, "ERROR: --format=log requires output to a file or pipe.\n");
+		exit(1);
+	}
+	if (replay_path) {
+		if (is_flight_recorder_dump(replay_path)) return replay_dump() == 0 ? 0 : 1;
+		return replay_log() == 0 ? 0 : 1;
+	}
+
 	if (app_data_init(&app_data) < 0) {
 		fprintf(stderr, "ERROR: program initialization failed.\n");
 		exit(-1);
@@ -1392,56 +3199,170 @@ int main(int argc, char** argv)
 
 	app_data_init_timestamps(&app_data);
 
+	app_data_init_process_discovery(&app_data);
+
+	/* libspmeasure is not known to be thread safe */
+	if (jobs > 1 && collector != COLLECTOR_SMAPS) {
+		fprintf(stderr, "Warning: --jobs requires --collector=smaps, taking the snapshots sequentially.\n");
+		jobs = 1;
+	}
+	if ( (rc = worker_pool_init(&app_data.workers, jobs)) != 0) {
+		fprintf(stderr, "ERROR: failed to create %d worker threads (%s).\n", jobs - 1, strerror(-rc));
+		exit(-1);
+	}
+
 	is_atty = isatty(fileno(output));
 	if (!is_atty) colors = false;
-	fprintf(output, "System: CPU: %u MHz max, total memory: %u kB RAM, %u kB swap\n",
-			FIELD_SYS_CPU_MAX_FREQ(app_data.sys_data1) / 1000,
-			FIELD_SYS_MEM_TOTAL(app_data.sys_data1), FIELD_SYS_MEM_SWAP(app_data.sys_data1));
+	if (flight_recorder_samples) {
+		if (top) {
+			fprintf(stderr, "ERROR: --flight-recorder can't be used with --top.\n");
+			exit(1);
+		}
+		if ( (rc = flight_recorder_init(&app_data.recorder, flight_recorder_samples)) != 0) {
+			fprintf(stderr, "ERROR: failed to create flight recorder (%s).\n", strerror(-rc));
+			exit(-1);
+		}
+		/* the values are recorded without colors */
+		colors = false;
+		if (trigger_psi && read_memory_pressure() < 0) {
+			fprintf(stderr, "Warning: memory pressure information is not available.\n");
+		}
+		sa.sa_handler = request_dump;
+		sigaction(SIGUSR1, &sa, NULL);
+	}
+	else if (trigger_dirty || trigger_psi) {
+		fprintf(stderr, "Warning: dump triggers are used only with --flight-recorder.\n");
+	}
+	if (top) {
+		if (!is_atty || output_format != OUTPUT_FORMAT_TEXT) {
+			fprintf(stderr, "ERROR: --top requires text output to a terminal.\n");
+			exit(1);
+		}
+		/* the view is updated at every interval */
+		do_print_report_default = true;
+		if ( (rc = top_view_init(&app_data.top_view, fileno(output), STDIN_FILENO)) != 0) {
+			fprintf(stderr, "ERROR: failed to initialize the terminal (%s).\n", strerror(-rc));
+			exit(-1);
+		}
+		atexit(release_top_view);
+		top_view_active = &app_data.top_view;
+		if (app_data.top_view.input_fd != -1) {
+			struct epoll_event event = {.events = EPOLLIN, .data.ptr = &app_data.top_view};
+			if (epoll_ctl(app_data.epoll_fd, EPOLL_CTL_ADD, app_data.top_view.input_fd, &event) == -1) {
+				fprintf(stderr, "Warning: failed to watch key presses (%s).\n", strerror(errno));
+			}
+		}
+		sa.sa_handler = resize_app;
+		sigaction(SIGWINCH, &sa, NULL);
+	}
+	else if (output_format == OUTPUT_FORMAT_LOG) {
+		if ( (rc = sample_log_writer_init(&app_data.log_writer, output)) != 0) {
+			fprintf(stderr, "ERROR: failed to write log (%s).\n", strerror(-rc));
+			exit(-1);
+		}
+	}
+	else if (output_format == OUTPUT_FORMAT_JSONL) {
+		fprintf(output, "{\"system.cpu.max_freq\":%u,\"system.mem.total\":%u,\"system.mem.swap\":%u}\n",
+				FIELD_SYS_CPU_MAX_FREQ(app_data.sys_data1) / 1000,
+				FIELD_SYS_MEM_TOTAL(app_data.sys_data1), FIELD_SYS_MEM_SWAP(app_data.sys_data1));
+	}
+	else {
+		fprintf(output, "%sSystem: CPU: %u MHz max, total memory: %u kB RAM, %u kB swap\n",
+				output_format == OUTPUT_FORMAT_CSV ? "# " : "",
+				FIELD_SYS_CPU_MAX_FREQ(app_data.sys_data1) / 1000,
+				FIELD_SYS_MEM_TOTAL(app_data.sys_data1), FIELD_SYS_MEM_SWAP(app_data.sys_data1));
+	}
+	if (output_queue_size) {
+		if (top) {
+			fprintf(stderr, "ERROR: --queue can't be used with --top.\n");
+			exit(1);
+		}
+		/* from now on the output is written only by the writer thread */
+		if ( (rc = output_queue_init(&app_data.output_queue, output, output_queue_size, flush_policy)) != 0) {
+			fprintf(stderr, "ERROR: failed to create output writer thread (%s).\n", strerror(-rc));
+			exit(-1);
+		}
+	}
+	else if (flush_policy != OUTPUT_QUEUE_FLUSH_ENTRY) {
+		fprintf(stderr, "Warning: --flush is used only with --queue.\n");
+	}
 
 	// Disable header reprinting if we're printing to console, or if the
 	// screen seems to be very small.
-	if (is_atty) { rows = win_rows(); if (rows < 10 + app_data.proc_count) rows = 0; }
-	// Install our signal handler, unless someone specifically wanted
-	// SIGINT to be ignored.
+	if (is_atty && !top && !flight_recorder_samples) { rows = win_rows(); if (rows < 10 + app_data.procs.count) rows = 0; }
+	// Install our signal handlers, unless someone specifically wanted
+	// SIGINT/SIGTERM to be ignored.
 	if (sigaction(SIGINT, NULL, &sa) == 0 && sa.sa_handler != SIG_IGN) {
 		sa.sa_handler = quit_app;
 		sigaction(SIGINT, &sa, NULL);
 	}
+	if (sigaction(SIGTERM, NULL, &sa) == 0 && sa.sa_handler != SIG_IGN) {
+		sa.sa_handler = quit_app;
+		sigaction(SIGTERM, &sa, NULL);
+	}
+	if (do_self_profile) {
+		if ( (rc = self_profile_init(&app_data.profile, profile_phase_names, PROFILE_MAX)) != 0) {
+			fprintf(stderr, "ERROR: failed to create self profile (%s).\n", strerror(-rc));
+			exit(-1);
+		}
+		sa.sa_handler = request_profile;
+		sigaction(SIGUSR2, &sa, NULL);
+	}
 
 	/* take initial process snapshots */
-	proc = app_data.proc_list;
-	while (proc) {
-		CHECK_SNAPSHOT_RC(sp_measure_get_proc_data(proc->data1, proc->resource_flags, NULL),
+	PROC_TABLE_FOREACH(&app_data.procs, i, proc) {
+		CHECK_SNAPSHOT_RC(proc_data_snapshot(proc, false),
 				"Process (name=%s, pid=%d) resource usage snapshot returned (%d).",
 				PROCESS_NAME(proc->data2), proc->data2->common->pid, rc = __rc);
 		proc->resource_flags &= (~rc);
-		proc = proc->next;
+		proc->reported = *proc->sample1;
 	}
 
-	gettimeofday(&timestamp, NULL);
+	if ( (rc = sample_timer_init(&timer, app_data.sleep_interval)) != 0) {
+		fprintf(stderr, "ERROR: failed to create sampling timer (%s).\n", strerror(-rc));
+		exit(-1);
+	}
+	struct epoll_event timer_event = {.events = EPOLLIN, .data.ptr = NULL};
+	if (epoll_ctl(app_data.epoll_fd, EPOLL_CTL_ADD, timer.fd, &timer_event) == -1) {
+		fprintf(stderr, "ERROR: failed to watch sampling timer (%s).\n", strerror(errno));
+		exit(-1);
+	}
 
 	do_print_report = true;
 	while (!quit) {
+		uint64_t tick_start = profile_start(), start = tick_start;
+		uint64_t cpu_start = do_self_profile ? self_profile_cpu_time() : 0;
+		/* a change selected by the change-only options was seen */
+		bool is_changed = false;
+		/* a flight recorder dump was triggered by a change */
+		bool is_triggered = false;
+
 		/* scan for processes to monitor */
-		if (app_data_scan_processes(&app_data) == 1) {
+		if (app_data_scan_processes(&app_data) == 1 || app_data.is_proc_list_changed) {
 			do_print_header = true;
+			app_data.is_proc_list_changed = false;
 		}
+		app_data_profile(&app_data, PROFILE_SCAN, start);
 
 		/* take system snapshot */
+		start = profile_start();
 		CHECK_SNAPSHOT_RC(sp_measure_get_sys_data(app_data.sys_data2, app_data.resource_flags, NULL),
 				"System resource usage snapshot returned (%d).", rc = __rc);
+		clock_gettime(CLOCK_REALTIME, &app_data.snapshot_time);
+		clock_gettime(CLOCK_MONOTONIC, &app_data.snapshot_clock);
 		app_data.resource_flags &= (~rc);
+		app_data_profile(&app_data, PROFILE_SYSTEM, start);
 
-		/* check if report should be printed */
-		if (!do_print_report) {
+		/* check if report should be printed or the interval shortened */
+		if (!do_print_report || adaptive_interval_min) {
 			int _sys_ram_change;
 			bool is_data_retrieved = true;
-			if ( (rc = sp_measure_diff_sys_mem_used(app_data.sys_data1, app_data.sys_data2, &_sys_ram_change)) != 0) {
+			if ( (rc = sp_measure_diff_sys_mem_used(app_data.sys_reported, app_data.sys_data2, &_sys_ram_change)) != 0) {
 				fprintf(stderr, "Warning: failed to compare used system memory between two snapshots (%d).\n", rc);
 				is_data_retrieved = false;
 			}
 			int value;
-			if ( (rc = sp_measure_diff_sys_cpu_usage(app_data.sys_data1, app_data.sys_data2, &value)) != 0) {
+			if ( (rc = sp_measure_diff_sys_cpu_usage(app_data.sys_reported, app_data.sys_data2, &value)) != 0) {
 				fprintf(stderr, "Warning: failed to compare cpu usage between two snapshots (%d).\n", rc);
 				is_data_retrieved = false;
 			}
@@ -1451,29 +3372,34 @@ int main(int argc, char** argv)
 				if ( (IS_OPTION_VALUE_FLAG_SET(app_data.option_flags, OF_SYS_MEM_CHANGES_ONLY) && abs(_sys_ram_change) >= sys_mem_change_threshold) ||
 					(IS_OPTION_VALUE_FLAG_SET(app_data.option_flags, OF_SYS_CPU_CHANGES_ONLY) && fabs(_sys_cpu_usage_change) >= sys_cpu_change_threshold) ) {
 
+					is_changed = true;
 					do_print_report = true;
 				}
 			}
 		}
 
 		/* take cgroups data snapshots */
+		start = profile_start();
 		cgroup_data_t* cgroup = app_data.cgroups;
 		while (cgroup) {
 			cgroup_read(cgroup);
 			cgroup = cgroup->next;
 		}
+		if (app_data.cgroups) app_data_profile(&app_data, PROFILE_CGROUPS, start);
 
 
-		/* take process snapshots */
-		proc = app_data.proc_list;
-		while (proc) {
-			proc_data_t* proc_free = NULL;
+		/* take process snapshots, in parallel when --jobs is used */
+		start = profile_start();
+		worker_pool_run(&app_data.workers, app_data.procs.size, app_data_collect_proc, &app_data);
+		app_data_profile(&app_data, PROFILE_PROCESSES, start);
+
+		PROC_TABLE_FOREACH(&app_data.procs, i, proc) {
 			/* Check if process name was retrieved, try to retrieve it if necessary.
 			 * This became necessary when --exec option was added. As the process data
 			 * is read directly after it is forked, the target process might not be
 			 * yet executed and the process name can't be retrieved.
 			 */
-			if (proc_data_check_cmdline(proc) != 0) {
+			if (proc->is_cmdline_changed) {
 				sp_measure_reinit_proc_data(proc->data1);
 				if (FIELD_PROC_NAME(proc->data1)) {
 					char buffer[256];
@@ -1482,33 +3408,43 @@ int main(int argc, char** argv)
 					do_print_header = true;
 				}
 			}
-  			/* take snapshot */
-			if ( (rc = sp_measure_get_proc_data(proc->data2, proc->resource_flags, NULL)) >= 0) {
-				/* check if the report should be printed */
-				if (!do_print_report) {
+			if (do_self_profile) {
+				self_profile_add(&app_data.profile, PROFILE_PROCESS, proc->snapshot_duration);
+			}
+			/* check the snapshot */
+			if ( (rc = proc->snapshot_rc) >= 0) {
+				/* check if the report should be printed or the interval shortened */
+				if (!do_print_report || (adaptive_interval_min && !is_changed)) {
 					if (IS_OPTION_VALUE_FLAG_SET(app_data.option_flags, OF_PROC_MEM_CHANGES_ONLY)) {
-						if ( (rc = sp_measure_diff_proc_mem_private_dirty(proc->data1, proc->data2, &value)) != 0) {
+						if ( (rc = proc_sample_diff_dirty(&proc->reported, proc->sample2, &value)) != 0) {
 							fprintf(stderr, "ERROR: failed to compare process private dirty memory change between\n"
 									"two snapshots (%d) for process(name=%s, pid=%d).\n",
 									rc, PROCESS_NAME(proc->data2), proc->data2->common->pid);
 							exit(-1);
 						}
 						if (value != 0) {
+							is_changed = true;
 							do_print_report = true;
 						}
 					}
 					if (IS_OPTION_VALUE_FLAG_SET(app_data.option_flags, OF_PROC_CPU_CHANGES_ONLY)) {
-						if ( (rc = sp_measure_diff_proc_cpu_ticks(proc->data1, proc->data2, &value)) != 0) {
+						if ( (rc = proc_sample_diff_cpu_ticks(&proc->reported, proc->sample2, &value)) != 0) {
 							fprintf(stderr, "ERROR: failed to compare process cpu usage between\n"
 									"two snapshots (%d) for process(name=%s, pid=%d).\n",
 									rc, PROCESS_NAME(proc->data2), proc->data2->common->pid);
 							exit(-1);
 						}
 						if (value != 0) {
+							is_changed = true;
 							do_print_report = true;
 						}
 					}
 				}
+				if (trigger_dirty && proc_sample_diff_dirty(&proc->reported, proc->sample2, &value) == 0 &&
+						value >= trigger_dirty) {
+					app_data_trigger_recorder(&app_data, "dirty");
+					is_triggered = true;
+				}
 				if (rc > 0) {
 					proc->resource_flags &= (~rc);
 					fprintf(stderr, "Warning: Process resource usage snapshot returned (%d). Some data might be absent.\n", rc);
@@ -1516,71 +3452,99 @@ int main(int argc, char** argv)
 			}
 			else {
 				/* if snapshot retrieval failed, assume that the process has been terminated and stop monitoring it */
-				proc_free = proc;
-			}
-			proc = proc->next;
-			if (proc_free) {
-				app_data_remove_proc(&app_data, FIELD_PROC_PID(proc_free->data2));
+				app_data_remove_proc(&app_data, proc);
 				do_print_header = true;
 			}
 		}
+		app_data_compact_procs(&app_data);
+
+		if (flight_recorder_samples) {
+			/* the change-only options trigger the dump instead of printing */
+			if (is_changed && !is_first_sample) {
+				app_data_trigger_recorder(&app_data, "change");
+				is_triggered = true;
+			}
+			/* the next changes are measured from the triggering sample */
+			if (is_triggered) app_data_mark_reported(&app_data);
+			if (trigger_psi && read_memory_pressure() >= trigger_psi) {
+				app_data_trigger_recorder(&app_data, "psi");
+			}
+		}
+		is_first_sample = false;
 
 		/* reprint header if its the first time or next screen or a process was added/removed */
 		if (do_print_header) {
-			if ( (rc = sp_report_print_header(output, &app_data.root_header)) != 0) {
-				fprintf(stderr, "ERROR: failed to print report header (%d).\n", rc);
-				exit(-1);
-			}
-			do_print_header = false;
+			/* JSON lines and the log are self describing, the full screen
+			 * view has its own header and the flight recorder prints no data */
+			if (output_format == OUTPUT_FORMAT_JSONL || output_format == OUTPUT_FORMAT_LOG ||
+					top || flight_recorder_samples) do_print_header = false;
 			do_print_report = true;
 		}
 
 		/* print data */
-		if (do_print_report) {
-			sp_report_print_data(output, &app_data.root_header);
-			fflush(output);
-
-			/* swap snapshot references so last snapshot is again in app_data.sys_data1 and
-			 * the next snapshot will be stored into app_data.sys_data2 */
-			sys_data_swap = app_data.sys_data1;
-			app_data.sys_data1 = app_data.sys_data2;
-			app_data.sys_data2 = sys_data_swap;
-			/* do the same for project snapshots */
-			for (proc = app_data.proc_list; proc; proc = proc->next) {
-				proc_data_swap = proc->data1;
-				proc->data1 = proc->data2;
-				proc->data2 = proc_data_swap;
-			}
+		if (flight_recorder_samples) {
+			start = profile_start();
+			app_data_record(&app_data);
+			app_data_profile(&app_data, PROFILE_RENDER, start);
+		}
+		else if (do_print_report) {
+			/* the header stays pending if the output was dropped */
+			if (app_data_print_report(&app_data, do_print_header)) do_print_header = false;
+		}
+		else {
+			app_data.is_report_pending = true;
+		}
 
-			/* swap cgroups data snapshots */
-			cgroup_data_t* cgroup = app_data.cgroups;
-			while (cgroup) {
-				cgroup_swap(cgroup);
-				cgroup = cgroup->next;
-			}
+		if (adaptive_interval_min) {
+			app_data_adapt_interval(&app_data, &timer, is_changed);
+		}
+
+		if (do_self_profile) {
+			app_data_profile(&app_data, PROFILE_TICK, tick_start);
+			self_profile_add(&app_data.profile, PROFILE_TICK_CPU, self_profile_cpu_time() - cpu_start);
 		}
 
 		if (quit) break;
 
-		struct timeval tv;
-		gettimeofday(&tv, NULL);
-		int interval  = (tv.tv_sec - timestamp.tv_sec) * 1000000 + tv.tv_usec - timestamp.tv_usec;
-		/* the sleep could be interrupted, force interval to 0 in that case */
-		if (interval < 0) interval = 0;
-		if (interval > (int)app_data.sleep_interval) {
-			fprintf(stderr, "Warning, the specified update interval is too small, please increase it.\n");
-			gettimeofday(&timestamp, NULL);
+		/* wait for the next sampling deadline */
+		while ( (rc = app_data_wait(&app_data, &timer)) < 0) {
+			if (errno != EINTR) {
+				fprintf(stderr, "ERROR: failed to wait for sampling timer (%s).\n", strerror(errno));
+				exit(-1);
+			}
+			if (quit) break;
+			if (is_dump_requested) {
+				is_dump_requested = 0;
+				app_data_dump_recorder(&app_data, "signal");
+			}
+			if (is_profile_requested) {
+				is_profile_requested = 0;
+				self_profile_print(&app_data.profile, stderr);
+			}
+			if (top && is_resized) {
+				is_resized = 0;
+				top_view_resize(&app_data.top_view);
+				app_data_draw_top(&app_data);
+			}
 		}
-		else {
-			usleep(app_data.sleep_interval - interval);
-			timestamp.tv_usec += app_data.sleep_interval;
-			timestamp.tv_sec += timestamp.tv_usec / 1000000;
-			timestamp.tv_usec %= 1000000;
+		if (quit) break;
+		if (rc > 0) {
+			if (!is_overrun_reported) {
+				fprintf(stderr, "Warning, the specified update interval is too small, please increase it.\n");
+				is_overrun_reported = true;
+			}
+			FILE* fp;
+			if (do_print_overrun_marker && !top && output_format != OUTPUT_FORMAT_LOG &&
+					(fp = app_data_begin_output(&app_data)) != NULL) {
+				if (output_format == OUTPUT_FORMAT_JSONL) fprintf(fp, "{\"overrun\":%d}\n", rc);
+				else fprintf(fp, "# overrun: %d sample(s) missed\n", rc);
+				app_data_end_output(&app_data);
+			}
 		}
 
 		/* reprint report header if necessary */
 		if (do_print_report) {
-			if (is_atty && rows) {
+			if (is_atty && rows && output_format == OUTPUT_FORMAT_TEXT) {
 				if (++lines_printed >= rows-1) {
 					do_print_header = true;
 					lines_printed = 3;
@@ -1590,9 +3554,38 @@ int main(int argc, char** argv)
 		do_print_report = do_print_report_default;
 	}
 
-	while (app_data.proc_list) {
-		app_data_remove_proc(&app_data, FIELD_PROC_PID(&app_data.proc_list->data[0]));
+	if (flight_recorder_samples) {
+		app_data_dump_recorder(&app_data, "exit");
+	}
+	/* write the queued output before closing the log */
+	if (output_queue_size) {
+		output_queue_close(&app_data.output_queue);
+	}
+	if (output_format == OUTPUT_FORMAT_LOG) {
+		app_data.log_writer.fp = output;
+		sample_log_writer_close(&app_data.log_writer);
+	}
+
+	/* restore the terminal before printing the summary */
+	release_top_view();
+	sample_timer_print_summary(&timer, stderr);
+	if (output_queue_size) {
+		output_queue_print_summary(&app_data.output_queue, stderr);
+	}
+	if (do_self_profile) {
+		self_profile_print(&app_data.profile, stderr);
+		self_profile_free(&app_data.profile);
+	}
+	sample_timer_release(&timer);
+	worker_pool_free(&app_data.workers);
+
+	proc_events_close(&app_data.proc_events);
+	close(app_data.epoll_fd);
+
+	PROC_TABLE_FOREACH(&app_data.procs, i, proc) {
+		app_data_remove_proc(&app_data, proc);
 	}
+	proc_table_free(&app_data.procs);
 	app_data_release(&app_data);
 
 	return 0;
@@ -21,36 +21,131 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 
 #include "mem-monitor-util.h"
 
-static char line[256];
+/* /proc/meminfo is well below this on all kernels we care about */
+#define MEMINFO_BUFFER_SIZE  8192
+
+/* Open addressing table size, must be a power of 2 and at least twice
+ * MEMINFO_MAX_KEYS to keep the probe sequences short. */
+#define LOOKUP_SIZE          128
+
+static char buffer[MEMINFO_BUFFER_SIZE];
+
+/* Key lookup table, built once for the MEMINFO array it is used with. */
+static struct {
+	const MEMINFO* wanted;             /* array the table was built for */
+	unsigned       size;               /* number of items in the array  */
+	unsigned char  slot[LOOKUP_SIZE];  /* index + 1 into wanted, 0=free */
+} lookup;
+
+/* /proc/meminfo descriptor, kept open between the calls */
+static int meminfo_fd = -1;
+
+/* FNV-1a hash of the key name (without the ':' separator) */
+static unsigned
+key_hash(const char* key, unsigned len)
+{
+	unsigned hash = 2166136261u;
+	while (len--) {
+		hash ^= (unsigned char)*key++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/* Builds the lookup table for @wanted unless it was built already. */
+static int
+lookup_prepare(const MEMINFO* wanted, unsigned size)
+{
+	unsigned idx;
+
+	if (lookup.wanted == wanted && lookup.size == size) return 0;
+	if (size > MEMINFO_MAX_KEYS) return -1;
+
+	memset(lookup.slot, 0, sizeof(lookup.slot));
+	for (idx = 0; idx < size; ++idx) {
+		const char* key = wanted[idx].key;
+		unsigned len = strlen(key);
+		/* keys are given with the ':' separator, hash the name only */
+		if (len && key[len - 1] == ':') len--;
+		unsigned pos = key_hash(key, len) & (LOOKUP_SIZE - 1);
+		while (lookup.slot[pos]) {
+			pos = (pos + 1) & (LOOKUP_SIZE - 1);
+		}
+		lookup.slot[pos] = idx + 1;
+	}
+	lookup.wanted = wanted;
+	lookup.size = size;
+	return 0;
+}
+
+/* Returns index of the @name key in the wanted array or -1 */
+static int
+lookup_find(const MEMINFO* wanted, const char* name, unsigned len)
+{
+	unsigned pos = key_hash(name, len) & (LOOKUP_SIZE - 1);
+	while (lookup.slot[pos]) {
+		const char* key = wanted[lookup.slot[pos] - 1].key;
+		if (!strncmp(key, name, len) && key[len] == ':') {
+			return lookup.slot[pos] - 1;
+		}
+		pos = (pos + 1) & (LOOKUP_SIZE - 1);
+	}
+	return -1;
+}
 
 unsigned
-parse_proc_meminfo(MEMINFO* wanted, unsigned size)
+parse_meminfo_fd(int fd, MEMINFO* wanted, unsigned size)
 {
 	unsigned counter = 0;
-	FILE* meminfo = fopen("/proc/meminfo", "r");
-	if (!meminfo) return 0;
-	while (fgets(line, sizeof(line), meminfo)) {
-		unsigned idx;
-		for (idx=0; idx < size; ++idx) {
-			const char* key = wanted[idx].key;
-			if (line == strstr(line, key)) {
-				/* Parameter has a format SomeName:\tValue, we
-				 * expect that MEMINFO::name contains ":" */
-				wanted[idx].value = (unsigned)
-					strtoul(line+strlen(key)+1, NULL, 0);
-				if (++counter == size) goto done;
-				continue;
+	ssize_t len;
+	const char* ptr;
+	const char* end;
+
+	if (lookup_prepare(wanted, size) != 0) return 0;
+
+	len = pread(fd, buffer, sizeof(buffer), 0);
+	if (len <= 0) return 0;
+	ptr = buffer;
+	end = buffer + len;
+
+	/* Parameters have a format "SomeName:   Value kB\n" */
+	while (ptr < end) {
+		const char* name = ptr;
+		while (ptr < end && *ptr != ':' && *ptr != '\n') ptr++;
+		if (ptr < end && *ptr == ':') {
+			int idx = lookup_find(wanted, name, ptr - name);
+			if (idx >= 0) {
+				unsigned value = 0;
+				ptr++;
+				while (ptr < end && *ptr == ' ') ptr++;
+				while (ptr < end && *ptr >= '0' && *ptr <= '9') {
+					value = value * 10 + (*ptr++ - '0');
+				}
+				wanted[idx].value = value;
+				if (++counter == size) break;
 			}
 		}
+		/* skip to the next line */
+		while (ptr < end && *ptr++ != '\n');
 	}
-done:
-	fclose(meminfo);
 	return counter;
 }
 
+unsigned
+parse_proc_meminfo(MEMINFO* wanted, unsigned size)
+{
+	if (meminfo_fd == -1) {
+		meminfo_fd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+		if (meminfo_fd == -1) return 0;
+	}
+	return parse_meminfo_fd(meminfo_fd, wanted, size);
+}
+
 int check_flag(const char* path)
 {
 	FILE* fp = fopen(path, "r");
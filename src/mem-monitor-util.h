@@ -25,15 +25,27 @@ typedef struct {
 	unsigned    value;  /* loaded value                     */
 } MEMINFO;
 
+/* Maximum number of keys parse_proc_meminfo() can look for at once */
+#define MEMINFO_MAX_KEYS  64
+
 /* Parses /proc/meminfo, looking for values for the keys defined in @wanted.
  *
  *    @wanted       What keys to look for, eg. "MemTotal:", "Cached:".
  *    @wanted_cnt   How many items @wanted contains.
  *
+ * The file is kept open between the calls and re-read with a single
+ * pread(), the key lookup table is built on the first call for the given
+ * @wanted array, so the same array should be passed on every call.
+ *
  * Returns the number of keys that were found.
  */
 unsigned parse_proc_meminfo(MEMINFO* wanted, unsigned wanted_cnt);
 
+/* Same as parse_proc_meminfo(), but reads the meminfo data from
+ * the already opened @fd (from offset 0).
+ */
+unsigned parse_meminfo_fd(int fd, MEMINFO* wanted, unsigned wanted_cnt);
+
 /* Opens specified flag file, and return true if it set on.
  * parameters:
  *    path - path to file to handle.
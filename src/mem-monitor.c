@@ -22,6 +22,11 @@
  *
  * History:
  *
+ * 15-Oct-2026
+ * - Added --pressure mode, which registers /proc/pressure/memory triggers
+ *   and prints a line only when a memory stall threshold fires, plus
+ *   a low-rate heartbeat line.
+ *
  * 01-Jun-2009
  * - Moved some code to mem-monitor-util.{ch}, that is now shared with
  *   mem-monitor and mem-cpu-monitor.  Removed mem-monitor.h.
@@ -58,6 +63,10 @@
 #include <time.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
 
 #include "mem-monitor-util.h"
 
@@ -80,6 +89,26 @@ typedef struct
 /* Correct division of 2 unsigned values */
 #define DIVIDE(a,b)  (((a) + ((b) >> 1)) / (b))
 
+/* Kernel pressure stall information for memory */
+#define PSI_MEMORY        "/proc/pressure/memory"
+
+/* Default trigger: 150ms of partial stall within 2 second window. Without
+ * CAP_SYS_RESOURCE the kernel accepts only windows of whole 2 seconds */
+#define PSI_TRIGGER       "some 150000 2000000"
+
+/* Maximum number of pressure triggers */
+#define PSI_TRIGGERS_MAX  8
+
+/* Heartbeat interval in pressure mode, seconds */
+#define PSI_HEARTBEAT     60
+
+/* Registered pressure trigger */
+typedef struct
+{
+   const char* trigger;   /* trigger specification, e.g. PSI_TRIGGER */
+   int         fd;        /* PSI_MEMORY descriptor the trigger is on */
+} PSITRIGGER;
+
 /* ------------------------------------------------------------------------- *
  * memusage -- returns memory usage for current system in MEMUSAGE structure.
  * parameters:
@@ -126,19 +155,228 @@ static int memusage(MEMUSAGE* usage)
    return -1;
 } /* memusage */
 
-int main(const int argc, const char* argv[])
+/* ------------------------------------------------------------------------- *
+ * print_usage -- prints one line of memory usage information.
+ * parameters:
+ *    status - additional status text to print after watermark flags.
+ * returns:
+ *    0 if values loaded successfuly OR negative error code.
+ * ------------------------------------------------------------------------- */
+static int print_usage(const char* status)
+{
+   MEMUSAGE usage;
+
+   /* Load all values from meminfo file */
+   if (0 == memusage(&usage))
+   {
+      const time_t tv = time(NULL);
+      struct tm*   ts = localtime(&tv);
+      const char*  bg = (check_flag("/sys/kernel/low_watermark") ? "BgKill" : "");
+      const char*  lm = (check_flag("/sys/kernel/high_watermark") ? "LowMem" : "");
+
+      /* The flags share the status column, separated with commas */
+      printf ("%02u:%02u:%02u\t%u\t%u\t%u\t%u\t%s%s%s%s%s\n",
+                 ts->tm_hour, ts->tm_min, ts->tm_sec,
+                 (unsigned)usage.total, (unsigned)usage.free,
+                 (unsigned)usage.used, (unsigned)usage.util,
+                 bg, (*bg && *lm ? "," : ""), lm,
+                 ((*bg || *lm) && *status ? "," : ""), status
+              );
+
+      fflush(stdout);
+      return 0;
+   }
+
+   printf ("unable to load values from /proc/meminfo file\n");
+   return -1;
+} /* print_usage */
+
+/* ------------------------------------------------------------------------- *
+ * psi_register -- registers memory pressure trigger.
+ * parameters:
+ *    psi - trigger to register, the fd field is set on success.
+ * returns:
+ *    0 if trigger registered successfuly OR negative error code.
+ * ------------------------------------------------------------------------- */
+static int psi_register(PSITRIGGER* psi)
+{
+   /* Every trigger needs its own file descriptor */
+   psi->fd = open(PSI_MEMORY, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+   if (psi->fd < 0)
+   {
+      fprintf(stderr, "unable to open %s: %s\n", PSI_MEMORY, strerror(errno));
+      return -1;
+   }
+
+   /* Trigger is registered by writing it including terminating zero */
+   if (write(psi->fd, psi->trigger, strlen(psi->trigger) + 1) < 0)
+   {
+      fprintf(stderr, "unable to set pressure trigger '%s': %s\n",
+               psi->trigger, strerror(errno));
+      if (EINVAL == errno)
+         fprintf(stderr, "without CAP_SYS_RESOURCE the window must be a multiple of 2 seconds\n");
+      close(psi->fd);
+      psi->fd = -1;
+      return -1;
+   }
+
+   return 0;
+} /* psi_register */
+
+/* ------------------------------------------------------------------------- *
+ * monotonic -- returns monotonic clock value in milliseconds.
+ * ------------------------------------------------------------------------- */
+static long long monotonic(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+} /* monotonic */
+
+/* ------------------------------------------------------------------------- *
+ * monitor_pressure -- blocks on pressure triggers and prints a line when
+ * one of them fires or when heartbeat period expires.
+ * parameters:
+ *    psi   - registered triggers.
+ *    count - number of triggers.
+ *    period - heartbeat period in seconds.
+ * returns:
+ *    negative error code.
+ * ------------------------------------------------------------------------- */
+static int monitor_pressure(PSITRIGGER* psi, unsigned count, unsigned period)
+{
+   struct pollfd fds[PSI_TRIGGERS_MAX];
+   long long heartbeat;
+   unsigned idx;
+
+   for (idx = 0; idx < count; idx++)
+   {
+      fds[idx].fd = psi[idx].fd;
+      fds[idx].events = POLLPRI;
+   }
+
+   heartbeat = monotonic() + period * 1000LL;
+   while (1)
+   {
+      long long timeout = heartbeat - monotonic();
+      int rc = poll(fds, count, timeout > 0 ? (int)timeout : 0);
+
+      if (rc < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         perror("poll");
+         return -1;
+      }
+
+      if (rc == 0)
+      {
+         /* Nothing happened, just tell that we are alive */
+         if (print_usage(""))
+            return -1;
+         heartbeat += period * 1000LL;
+         continue;
+      }
+
+      for (idx = 0; idx < count; idx++)
+      {
+         if (fds[idx].revents & POLLERR)
+         {
+            fprintf(stderr, "pressure trigger '%s' is gone\n", psi[idx].trigger);
+            return -1;
+         }
+         if (fds[idx].revents & POLLPRI)
+         {
+            char  status[64];
+            char* ptr;
+
+            /* Trigger fields are separated with colons to keep the
+             * status column free of spaces */
+            snprintf(status, sizeof(status), "Stall[%s]", psi[idx].trigger);
+            for (ptr = status; *ptr; ptr++)
+               if (' ' == *ptr)
+                  *ptr = ':';
+            if (print_usage(status))
+               return -1;
+         }
+      }
+   }
+
+   return 0;
+} /* monitor_pressure */
+
+static void usage(const char* name)
 {
+   fprintf(stderr,
+      "\nusage: %s [-p|--pressure[=TRIGGER]]... [output interval in secs]\n\n"
+      "  -p, --pressure[=TRIGGER]  print a line only when the memory pressure\n"
+      "                            TRIGGER (default '%s') fires.\n"
+      "                            The interval is used as heartbeat period\n"
+      "                            (default %u seconds) in this mode.\n\n",
+      name, PSI_TRIGGER, PSI_HEARTBEAT);
+}
+
+int main(int argc, char* argv[])
+{
+   static const struct option long_opts[] =
+   {
+      {"pressure", 2, 0, 'p'},
+      {"help",     0, 0, 'h'},
+      {0, 0, 0, 0}
+   };
+
    /* Update interval once per 3 seconds by default */
    unsigned period = 3;
-   
-   if (argc > 2 || (argc == 2 && !isdigit(argv[1][0]))) 
+   PSITRIGGER psi[PSI_TRIGGERS_MAX];
+   unsigned psi_count = 0;
+   int opt;
+
+   while ((opt = getopt_long(argc, argv, "p::h", long_opts, NULL)) != -1)
    {
-      fprintf(stderr, "\nusage: %s [output interval in secs]\n\n", *argv);
+      switch (opt)
+      {
+         case 'p':
+            if (psi_count == PSI_TRIGGERS_MAX)
+            {
+               fprintf(stderr, "too many pressure triggers, at most %d supported\n", PSI_TRIGGERS_MAX);
+               exit(1);
+            }
+            psi[psi_count].trigger = (optarg ? optarg : PSI_TRIGGER);
+            psi[psi_count++].fd = -1;
+            period = PSI_HEARTBEAT;
+            break;
+
+         case 'h':
+            usage(*argv);
+            exit(0);
+
+         default:
+            usage(*argv);
+            exit(1);
+      }
+   }
+
+   if (argc - optind > 1 || (argc - optind == 1 && !isdigit(argv[optind][0])))
+   {
+      usage(*argv);
       exit(1);
    }
-   else if (argc == 2)
+   else if (argc - optind == 1)
    {
-      period = strtoul(argv[1], NULL, 0);
+      period = strtoul(argv[optind], NULL, 0);
+   }
+
+   if (psi_count)
+   {
+      unsigned idx;
+
+      for (idx = 0; idx < psi_count; idx++)
+      {
+         if (psi_register(&psi[idx]))
+            exit(1);
+      }
+      if (!period)
+         period = PSI_HEARTBEAT;
    }
 
    /* We must print data always */
@@ -147,33 +385,20 @@ int main(const int argc, const char* argv[])
    }
 
    printf ("time:\t\ttotal:\tavail:\tused:\tuse-%%:\tstatus:\n");
+
+   /* Print the first line so there is a reference for the later ones */
+   if (print_usage(""))
+      return -1;
+
+   if (psi_count)
+      return monitor_pressure(psi, psi_count, period);
+
    while (1)
    {
-       MEMUSAGE usage;
+      sleep(period);
 
-      /* Load all values from meminfo file */
-      if (0 == memusage(&usage))
-      {
-         const time_t tv = time(NULL);
-         struct tm*   ts = localtime(&tv);
-         const char*  bg = (check_flag("/sys/kernel/low_watermark") ? "BgKill" : "");
-         const char*  lm = (check_flag("/sys/kernel/high_watermark") ? ",LowMem" : "");
-
-          printf ("%02u:%02u:%02u\t%u\t%u\t%u\t%u\t%s%s\n",
-                     ts->tm_hour, ts->tm_min, ts->tm_sec,
-                     usage.total, usage.free, usage.used, usage.util,
-                     bg, lm
-                  );
-
-	  fflush(stdout);
-      }
-      else
-      {
-         printf ("unable to load values from /proc/meminfo file\n");
+      if (print_usage(""))
          return -1;
-      }
-
-      sleep(period);
    }
 
    /* That is all */
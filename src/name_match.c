@@ -0,0 +1,212 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "name_match.h"
+
+/**
+ * Private API
+ */
+
+/**
+ * Allocates a new trie node.
+ *
+ * @param[in] self    the matcher.
+ * @param[in] c       the node character.
+ * @return            the node index or negative error code.
+ */
+static int node_create(
+		name_match_t* self,
+		unsigned char c
+		)
+{
+	if (self->node_count == self->node_capacity) {
+		int capacity = self->node_capacity ? self->node_capacity * 2 : 64;
+		name_match_node_t* nodes = (name_match_node_t*)realloc(self->nodes,
+				capacity * sizeof(name_match_node_t));
+		if (!nodes) return -ENOMEM;
+		self->nodes = nodes;
+		self->node_capacity = capacity;
+	}
+	name_match_node_t* node = &self->nodes[self->node_count];
+	memset(node, 0, sizeof(name_match_node_t));
+	node->c = c;
+	return self->node_count++;
+}
+
+/**
+ * Finds the child node for the character.
+ *
+ * @return            the child node index or 0 if not found.
+ */
+static int node_find_child(
+		const name_match_t* self,
+		int parent,
+		unsigned char c
+		)
+{
+	int child;
+	for (child = self->nodes[parent].child; child; child = self->nodes[child].sibling) {
+		if (self->nodes[child].c == c) break;
+	}
+	return child;
+}
+
+/**
+ * Checks if the regular expression contains backreferences.
+ *
+ * @param[in] regex   the regular expression.
+ * @return            true if the expression contains \1 - \9.
+ */
+static bool regex_has_backref(
+		const char* regex
+		)
+{
+	for (; *regex; regex++) {
+		if (*regex != '\\') continue;
+		if (!*++regex) break;
+		if (*regex >= '1' && *regex <= '9') return true;
+	}
+	return false;
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int name_match_add_prefix(
+		name_match_t* self,
+		const char* prefix
+		)
+{
+	int node = 0;
+	if (!self->node_count && node_create(self, 0) < 0) return -ENOMEM;
+
+	for (; *prefix; prefix++) {
+		int child = node_find_child(self, node, *prefix);
+		if (!child) {
+			if ( (child = node_create(self, *prefix)) < 0) return child;
+			self->nodes[child].sibling = self->nodes[node].child;
+			self->nodes[node].child = child;
+		}
+		node = child;
+	}
+	self->nodes[node].terminal = true;
+	self->count++;
+	return 0;
+}
+
+
+int name_match_add_regex(
+		name_match_t* self,
+		const char* regex,
+		char* error,
+		int size
+		)
+{
+	regex_t test, combined;
+	int rc;
+	char* source;
+
+	/* check the expression alone to report errors in it */
+	if ( (rc = regcomp(&test, regex, REG_EXTENDED | REG_NOSUB)) != 0) {
+		regerror(rc, &test, error, size);
+		regfree(&test);
+		return -EINVAL;
+	}
+
+	/* the group numbers would change in the alternation, keep it separate */
+	if (regex_has_backref(regex)) {
+		regex_t* regexes = (regex_t*)realloc(self->regexes,
+				(self->regex_count + 1) * sizeof(regex_t));
+		if (!regexes) {
+			regfree(&test);
+			return -ENOMEM;
+		}
+		self->regexes = regexes;
+		self->regexes[self->regex_count++] = test;
+		self->count++;
+		return 0;
+	}
+	regfree(&test);
+
+	if (self->regex_source) {
+		rc = asprintf(&source, "%s|(%s)", self->regex_source, regex);
+	}
+	else {
+		rc = asprintf(&source, "(%s)", regex);
+	}
+	if (rc == -1) return -ENOMEM;
+
+	if ( (rc = regcomp(&combined, source, REG_EXTENDED | REG_NOSUB)) != 0) {
+		regerror(rc, &combined, error, size);
+		regfree(&combined);
+		free(source);
+		return -EINVAL;
+	}
+	if (self->has_regex) regfree(&self->regex);
+	self->regex = combined;
+	free(self->regex_source);
+	self->regex_source = source;
+	self->has_regex = true;
+	self->count++;
+	return 0;
+}
+
+
+bool name_match_test(
+		const name_match_t* self,
+		const char* name
+		)
+{
+	if (self->node_count) {
+		int node = 0;
+		const char* ptr = name;
+		while (true) {
+			if (self->nodes[node].terminal) return true;
+			if (!*ptr || !(node = node_find_child(self, node, *ptr++))) break;
+		}
+	}
+	if (self->has_regex && regexec(&self->regex, name, 0, NULL, 0) == 0) return true;
+
+	int i;
+	for (i = 0; i < self->regex_count; i++) {
+		if (regexec(&self->regexes[i], name, 0, NULL, 0) == 0) return true;
+	}
+	return false;
+}
+
+
+void name_match_free(
+		name_match_t* self
+		)
+{
+	free(self->nodes);
+	free(self->regex_source);
+	if (self->has_regex) regfree(&self->regex);
+	int i;
+	for (i = 0; i < self->regex_count; i++) regfree(&self->regexes[i]);
+	free(self->regexes);
+	memset(self, 0, sizeof(name_match_t));
+}
@@ -0,0 +1,119 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file name_match.h
+ * Process name matcher.
+ *
+ * Any number of name prefixes and regular expressions can be added to
+ * the matcher. The prefixes are compiled into a trie and the regular
+ * expressions into a single alternation, so a name is checked against
+ * all patterns in one pass over the name. The expressions containing
+ * backreferences are compiled separately, as the alternation would
+ * renumber their groups.
+ */
+#ifndef NAME_MATCH_H
+#define NAME_MATCH_H
+
+#include <stdbool.h>
+#include <regex.h>
+
+/**
+ * The prefix trie node.
+ */
+typedef struct name_match_node_t {
+	/* index of the first child node, 0 if none */
+	int child;
+	/* index of the next sibling node, 0 if none */
+	int sibling;
+	/* the character leading to this node */
+	unsigned char c;
+	/* a prefix ends at this node */
+	bool terminal;
+} name_match_node_t;
+
+/**
+ * The name matcher.
+ *
+ * A zero initialized structure is an empty matcher.
+ */
+typedef struct name_match_t {
+	/* prefix trie nodes, the first node is the root */
+	name_match_node_t* nodes;
+	int node_count;
+	int node_capacity;
+
+	/* the combined regular expression source */
+	char* regex_source;
+	/* the compiled combined regular expression */
+	regex_t regex;
+	bool has_regex;
+
+	/* the separately compiled regular expressions */
+	regex_t* regexes;
+	int regex_count;
+
+	/* number of added patterns */
+	int count;
+} name_match_t;
+
+/**
+ * Adds a name prefix pattern.
+ *
+ * @param[in] self    the matcher.
+ * @param[in] prefix  the name prefix.
+ * @return            0 for success.
+ */
+int name_match_add_prefix(
+		name_match_t* self,
+		const char* prefix
+		);
+
+/**
+ * Adds a POSIX extended regular expression pattern.
+ *
+ * @param[in] self    the matcher.
+ * @param[in] regex   the regular expression.
+ * @param[out] error  the error message buffer.
+ * @param[in] size    the error message buffer size.
+ * @return            0 for success.
+ */
+int name_match_add_regex(
+		name_match_t* self,
+		const char* regex,
+		char* error,
+		int size
+		);
+
+/**
+ * Checks if the name matches any of the patterns.
+ *
+ * @param[in] self    the matcher.
+ * @param[in] name    the name to check.
+ * @return            true if the name matches.
+ */
+bool name_match_test(
+		const name_match_t* self,
+		const char* name
+		);
+
+/**
+ * Frees the matcher resources.
+ *
+ * @param[in] self    the matcher.
+ */
+void name_match_free(
+		name_match_t* self
+		);
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include "output_queue.h"
+
+/**
+ * Private API
+ */
+
+/**
+ * Flushes the output file.
+ *
+ * @param[in] self   the output queue.
+ */
+static void flush_output(
+		output_queue_t* self
+		)
+{
+	if (fflush(self->output) != 0) {
+		self->write_errors++;
+		clearerr(self->output);
+	}
+	self->flushes++;
+}
+
+/**
+ * The writer thread.
+ *
+ * Writes the queued entries until the close is posted with no entries
+ * left in the queue.
+ */
+static void* writer_thread(
+		void* arg
+		)
+{
+	output_queue_t* self = (output_queue_t*)arg;
+	struct timespec deadline = {0};
+	bool is_dirty = false;
+
+	while (true) {
+		unsigned head = self->head;
+		if (is_dirty && self->flush_policy > 0) {
+			if (sem_timedwait(&self->entries, &deadline) != 0) {
+				if (errno == ETIMEDOUT) {
+					flush_output(self);
+					is_dirty = false;
+				}
+				continue;
+			}
+		}
+		else {
+			if (is_dirty && self->flush_policy == OUTPUT_QUEUE_FLUSH_IDLE &&
+					head == __atomic_load_n(&self->tail, __ATOMIC_ACQUIRE)) {
+				flush_output(self);
+				is_dirty = false;
+			}
+			if (sem_wait(&self->entries) != 0) continue;
+		}
+		/* every entry is posted after it has been queued, so a post
+		 * without entry is the close */
+		if (head == __atomic_load_n(&self->tail, __ATOMIC_ACQUIRE)) break;
+
+		output_queue_slot_t* slot = &self->slots[head & (self->capacity - 1)];
+		if (fwrite(slot->data, 1, slot->size, self->output) != slot->size) {
+			self->write_errors++;
+			clearerr(self->output);
+		}
+		__atomic_store_n(&self->head, head + 1, __ATOMIC_RELEASE);
+
+		if (self->flush_policy == OUTPUT_QUEUE_FLUSH_ENTRY) {
+			flush_output(self);
+		}
+		else if (!is_dirty) {
+			is_dirty = true;
+			if (self->flush_policy > 0) {
+				clock_gettime(CLOCK_REALTIME, &deadline);
+				deadline.tv_sec += self->flush_policy / 1000;
+				deadline.tv_nsec += self->flush_policy % 1000 * 1000000;
+				if (deadline.tv_nsec >= 1000000000) {
+					deadline.tv_sec++;
+					deadline.tv_nsec -= 1000000000;
+				}
+			}
+		}
+	}
+	flush_output(self);
+	return NULL;
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int output_queue_init(
+		output_queue_t* self,
+		FILE* output,
+		int capacity,
+		int flush_policy
+		)
+{
+	sigset_t all, old;
+	int rc;
+
+	memset(self, 0, sizeof(*self));
+	if (capacity < 1) return -EINVAL;
+	self->output = output;
+	self->flush_policy = flush_policy;
+	/* the free running head and tail indices are masked into slot
+	 * indices, which works across the index wrap around only with
+	 * power of two capacity */
+	self->capacity = 1;
+	while (self->capacity < (unsigned)capacity) self->capacity <<= 1;
+
+	if ( (self->slots = calloc(self->capacity, sizeof(output_queue_slot_t))) == NULL) return -ENOMEM;
+	if ( (self->stream = open_memstream(&self->stream_data, &self->stream_size)) == NULL) {
+		rc = -errno;
+		free(self->slots);
+		return rc;
+	}
+	sem_init(&self->entries, 0, 0);
+
+	/* the writer thread inherits the signal mask */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	rc = -pthread_create(&self->thread, NULL, writer_thread, self);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (rc != 0) {
+		sem_destroy(&self->entries);
+		fclose(self->stream);
+		free(self->stream_data);
+		free(self->slots);
+		return rc;
+	}
+	return 0;
+}
+
+
+FILE* output_queue_begin(
+		output_queue_t* self,
+		unsigned* dropped
+		)
+{
+	unsigned depth = self->tail - __atomic_load_n(&self->head, __ATOMIC_ACQUIRE);
+	if (depth == self->capacity) {
+		self->dropped++;
+		self->dropped_pending++;
+		return NULL;
+	}
+	*dropped = self->dropped_pending;
+	rewind(self->stream);
+	return self->stream;
+}
+
+
+int output_queue_commit(
+		output_queue_t* self
+		)
+{
+	off_t size = ftello(self->stream);
+	if (size <= 0 || fflush(self->stream) != 0) return size < 0 ? -errno : 0;
+
+	/* the slot at tail is not accessed by the writer thread until the
+	 * tail has been advanced past it */
+	output_queue_slot_t* slot = &self->slots[self->tail & (self->capacity - 1)];
+	if ((size_t)size > slot->capacity) {
+		char* data = realloc(slot->data, size);
+		if (!data) return -ENOMEM;
+		slot->data = data;
+		slot->capacity = size;
+	}
+	memcpy(slot->data, self->stream_data, size);
+	slot->size = size;
+	__atomic_store_n(&self->tail, self->tail + 1, __ATOMIC_RELEASE);
+	sem_post(&self->entries);
+
+	unsigned depth = self->tail - __atomic_load_n(&self->head, __ATOMIC_ACQUIRE);
+	if (depth > self->max_depth) self->max_depth = depth;
+	self->queued++;
+	self->dropped_pending = 0;
+	return 0;
+}
+
+
+void output_queue_close(
+		output_queue_t* self
+		)
+{
+	if (!self->slots) return;
+	sem_post(&self->entries);
+	pthread_join(self->thread, NULL);
+	sem_destroy(&self->entries);
+	fclose(self->stream);
+	free(self->stream_data);
+
+	unsigned i;
+	for (i = 0; i < self->capacity; i++) {
+		free(self->slots[i].data);
+	}
+	free(self->slots);
+	self->slots = NULL;
+	self->stream = NULL;
+	self->stream_data = NULL;
+}
+
+
+void output_queue_print_summary(
+		const output_queue_t* self,
+		FILE* fp
+		)
+{
+	fprintf(fp, "Output queue: %llu entries written, %llu dropped, max depth %u of %u, %llu flushes, %llu write errors\n",
+			self->queued, self->dropped, self->max_depth, self->capacity, self->flushes, self->write_errors);
+}
@@ -0,0 +1,155 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file output_queue.h
+ * Bounded queue of rendered output passed to a writer thread.
+ *
+ * The sampling thread renders the report output into an in-memory
+ * stream and queues it as a single entry. The writer thread writes the
+ * entries into the output file and flushes it according to the flush
+ * policy, so a slow disk or a blocked pipe reader doesn't delay the
+ * sampling. When the queue is full the entry is dropped instead of
+ * waiting for the writer.
+ *
+ * The queue is a single producer, single consumer ring of entry slots
+ * with atomically updated head and tail indices. The slot buffers are
+ * reused, so once they have grown to the entry size no memory is
+ * allocated while queuing.
+ */
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+/* flush policies, positive values are flush intervals in milliseconds */
+#define OUTPUT_QUEUE_FLUSH_ENTRY      0
+#define OUTPUT_QUEUE_FLUSH_IDLE       -1
+
+/**
+ * The queue entry slot.
+ */
+typedef struct output_queue_slot_t {
+	char* data;
+	size_t size;
+	size_t capacity;
+} output_queue_slot_t;
+
+/**
+ * The output queue.
+ */
+typedef struct output_queue_t {
+	FILE* output;
+	int flush_policy;
+
+	output_queue_slot_t* slots;
+	unsigned capacity;
+	/* the next slot to write (consumer) and to fill (producer), only
+	 * incremented and accessed atomically */
+	unsigned head;
+	unsigned tail;
+	/* posted for every queued entry and once more when closing */
+	sem_t entries;
+	pthread_t thread;
+
+	/* the in-memory stream the entry is rendered into */
+	FILE* stream;
+	char* stream_data;
+	size_t stream_size;
+
+	/* the producer statistics */
+	unsigned long long queued;
+	unsigned long long dropped;
+	/* dropped since the last queued entry */
+	unsigned dropped_pending;
+	unsigned max_depth;
+
+	/* the writer statistics */
+	unsigned long long flushes;
+	unsigned long long write_errors;
+} output_queue_t;
+
+
+/**
+ * Initializes the output queue and starts the writer thread.
+ *
+ * The writer thread blocks all signals, so the signals are delivered to
+ * the other threads. The output file must not be accessed by the other
+ * threads until the queue has been closed.
+ * @param[out] self          the output queue.
+ * @param[in] output         the output file.
+ * @param[in] capacity       the number of queue entries, rounded up to
+ *                           a power of two.
+ * @param[in] flush_policy   OUTPUT_QUEUE_FLUSH_ENTRY to flush after every
+ *                           entry, OUTPUT_QUEUE_FLUSH_IDLE to flush when
+ *                           the queue is empty or the flush interval in
+ *                           milliseconds.
+ * @return                   0 for success.
+ */
+int output_queue_init(
+		output_queue_t* self,
+		FILE* output,
+		int capacity,
+		int flush_policy
+		);
+
+/**
+ * Starts rendering a new entry.
+ *
+ * @param[in] self       the output queue.
+ * @param[out] dropped   the number of entries dropped since the last
+ *                       queued entry.
+ * @return               the stream to render the entry into or NULL if
+ *                       the queue is full and the entry is dropped.
+ */
+FILE* output_queue_begin(
+		output_queue_t* self,
+		unsigned* dropped
+		);
+
+/**
+ * Queues the entry rendered since output_queue_begin().
+ *
+ * @param[in] self   the output queue.
+ * @return           0 for success.
+ */
+int output_queue_commit(
+		output_queue_t* self
+		);
+
+/**
+ * Writes the queued entries, stops the writer thread and releases the
+ * queue resources.
+ *
+ * The output file is flushed, but not closed.
+ * @param[in] self   the output queue.
+ */
+void output_queue_close(
+		output_queue_t* self
+		);
+
+/**
+ * Prints the queue statistics.
+ *
+ * @param[in] self   the output queue.
+ * @param[in] fp     the output file.
+ */
+void output_queue_print_summary(
+		const output_queue_t* self,
+		FILE* fp
+		);
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+
+#include "proc_events.h"
+
+/**
+ * Private API
+ */
+
+/* the receive buffer size, fits a few dozens of events */
+#define RECV_BUFFER_SIZE	4096
+
+/**
+ * Sends process connector multicast subscription control message.
+ *
+ * @param[in] self   the event listener.
+ * @param[in] op     PROC_CN_MCAST_LISTEN or PROC_CN_MCAST_IGNORE.
+ * @return           0 for success.
+ */
+static int proc_events_control(
+		proc_events_t* self,
+		enum proc_cn_mcast_op op
+		)
+{
+	struct __attribute__((aligned(NLMSG_ALIGNTO))) {
+		struct nlmsghdr header;
+		struct __attribute__((packed)) {
+			struct cn_msg message;
+			enum proc_cn_mcast_op op;
+		} body;
+	} request;
+
+	memset(&request, 0, sizeof(request));
+	request.header.nlmsg_len = NLMSG_LENGTH(sizeof(request.body));
+	request.header.nlmsg_type = NLMSG_DONE;
+	request.header.nlmsg_pid = getpid();
+	request.body.message.id.idx = CN_IDX_PROC;
+	request.body.message.id.val = CN_VAL_PROC;
+	request.body.message.len = sizeof(enum proc_cn_mcast_op);
+	request.body.op = op;
+
+	if (send(self->fd, &request, request.header.nlmsg_len, 0) == -1) {
+		return -errno;
+	}
+	return 0;
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int proc_events_open(
+		proc_events_t* self
+		)
+{
+	struct sockaddr_nl addr;
+	int rc;
+
+	self->fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+	if (self->fd == -1) return -errno;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = CN_IDX_PROC;
+	addr.nl_pid = 0;
+	if (bind(self->fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+		rc = -errno;
+		goto error;
+	}
+	if ( (rc = proc_events_control(self, PROC_CN_MCAST_LISTEN)) != 0) {
+		goto error;
+	}
+	return 0;
+
+error:
+	close(self->fd);
+	self->fd = -1;
+	return rc;
+}
+
+
+int proc_events_read(
+		proc_events_t* self,
+		proc_events_fn handler,
+		void* arg
+		)
+{
+	char buffer[RECV_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+	int count = 0;
+
+	while (true) {
+		struct nlmsghdr* header = (struct nlmsghdr*)buffer;
+		ssize_t len = recv(self->fd, buffer, sizeof(buffer), 0);
+		if (len == -1) {
+			if (errno == EINTR) continue;
+			if (errno == EAGAIN) break;
+			if (errno == ENOBUFS) {
+				/* socket buffer overflow, events were lost */
+				handler(PROC_EVENTS_OVERFLOW, 0, arg);
+				count++;
+				continue;
+			}
+			return -errno;
+		}
+		for (; NLMSG_OK(header, len); header = NLMSG_NEXT(header, len)) {
+			if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP) continue;
+
+			struct cn_msg* message = NLMSG_DATA(header);
+			if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) continue;
+
+			struct proc_event* event = (struct proc_event*)message->data;
+			switch (event->what) {
+			case PROC_EVENT_FORK:
+				/* ignore thread creation */
+				if (event->event_data.fork.child_pid != event->event_data.fork.child_tgid) continue;
+				handler(PROC_EVENTS_FORK, event->event_data.fork.child_tgid, arg);
+				break;
+			case PROC_EVENT_EXEC:
+				handler(PROC_EVENTS_EXEC, event->event_data.exec.process_tgid, arg);
+				break;
+			case PROC_EVENT_COMM:
+				handler(PROC_EVENTS_COMM, event->event_data.comm.process_tgid, arg);
+				break;
+			case PROC_EVENT_EXIT:
+				/* ignore thread termination */
+				if (event->event_data.exit.process_pid != event->event_data.exit.process_tgid) continue;
+				handler(PROC_EVENTS_EXIT, event->event_data.exit.process_tgid, arg);
+				break;
+			default:
+				continue;
+			}
+			count++;
+		}
+	}
+	return count;
+}
+
+
+void proc_events_close(
+		proc_events_t* self
+		)
+{
+	if (self->fd != -1) {
+		proc_events_control(self, PROC_CN_MCAST_IGNORE);
+		close(self->fd);
+		self->fd = -1;
+	}
+}
@@ -0,0 +1,90 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file proc_events.h
+ * Process event notifications through the kernel netlink process
+ * connector (NETLINK_CONNECTOR, CN_IDX_PROC).
+ *
+ * Subscribing to the process events requires CAP_NET_ADMIN, so the
+ * callers should be prepared to fall back to scanning /proc.
+ */
+#ifndef PROC_EVENTS_H
+#define PROC_EVENTS_H
+
+/**
+ * Process event types reported to the event handler.
+ */
+typedef enum {
+	/* a new process was forked */
+	PROC_EVENTS_FORK,
+	/* process executed a new binary */
+	PROC_EVENTS_EXEC,
+	/* process changed its name */
+	PROC_EVENTS_COMM,
+	/* process exited */
+	PROC_EVENTS_EXIT,
+	/* events were lost, process list must be rescanned */
+	PROC_EVENTS_OVERFLOW,
+} proc_events_type_t;
+
+/* the event handler template function */
+typedef void (*proc_events_fn)(proc_events_type_t type, int pid, void* arg);
+
+/**
+ * The process event listener.
+ */
+typedef struct proc_events_t {
+	/* the netlink socket descriptor */
+	int fd;
+} proc_events_t;
+
+/**
+ * Subscribes to the process events.
+ *
+ * @param[in] self   the event listener.
+ * @return           0 for success or negative error code
+ *                   (-EPERM without the required privileges).
+ */
+int proc_events_open(
+		proc_events_t* self
+		);
+
+/**
+ * Reads all pending process events.
+ *
+ * Only events of processes (thread group leaders) are reported,
+ * thread creation and termination is filtered out. This function
+ * does not block.
+ * @param[in] self     the event listener.
+ * @param[in] handler  the event handler.
+ * @param[in] arg      the event handler argument.
+ * @return             the number of reported events or negative
+ *                     error code.
+ */
+int proc_events_read(
+		proc_events_t* self,
+		proc_events_fn handler,
+		void* arg
+		);
+
+/**
+ * Unsubscribes from the process events.
+ *
+ * @param[in] self   the event listener.
+ */
+void proc_events_close(
+		proc_events_t* self
+		);
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "proc_smaps.h"
+
+/* the read buffer size, smaps_rollup fits in a single read */
+#define READ_BUFFER_SIZE 16384
+
+/**
+ * Private API
+ */
+
+/**
+ * Parses the memory size value of an smaps field line.
+ *
+ * @param[in] ptr    the value part of the line.
+ * @return           the value in kilobytes.
+ */
+static int
+parse_size(const char* ptr)
+{
+	int value = 0;
+	while (*ptr == ' ') ptr++;
+	while (*ptr >= '0' && *ptr <= '9') value = value * 10 + *ptr++ - '0';
+	return value;
+}
+
+/**
+ * Adds the smaps lines to the sample.
+ *
+ * @param[in] ptr      the first line.
+ * @param[in] end      the end of the last complete line.
+ * @param[out] sample  the sample to update.
+ */
+static void
+parse_smaps_lines(const char* ptr, const char* end, proc_sample_t* sample)
+{
+	while (ptr < end) {
+		const char* eol = memchr(ptr, '\n', end - ptr);
+		if (!eol) break;
+		/* mapping header lines start with a hexadecimal address, so check
+		 * only the field lines starting with the interesting letters */
+		switch (*ptr) {
+		case 'P':
+			if (!strncmp(ptr, "Private_Clean:", 14)) {
+				sample->clean += parse_size(ptr + 14);
+			}
+			else if (!strncmp(ptr, "Private_Dirty:", 14)) {
+				sample->dirty += parse_size(ptr + 14);
+			}
+			break;
+		case 'S':
+			if (!strncmp(ptr, "Swap:", 5)) {
+				sample->swap += parse_size(ptr + 5);
+			}
+			break;
+		}
+		ptr = eol + 1;
+	}
+}
+
+/**
+ * Reads the memory usage from smaps or smaps_rollup.
+ *
+ * @return     0 for success, negative error code otherwise.
+ */
+static int
+read_smaps(proc_smaps_t* self, proc_sample_t* sample)
+{
+	char buffer[READ_BUFFER_SIZE + 1];
+	off_t offset = 0;
+	int left = 0;
+
+	sample->clean = sample->dirty = sample->swap = 0;
+	while (true) {
+		ssize_t len = pread(self->fd, buffer + left, READ_BUFFER_SIZE - left, offset);
+		if (len < 0) return -errno;
+		if (len == 0) break;
+		offset += len;
+		len += left;
+
+		/* parse the complete lines and keep the partial last line */
+		const char* end = buffer + len;
+		while (end > buffer && end[-1] != '\n') end--;
+		parse_smaps_lines(buffer, end, sample);
+		left = buffer + len - end;
+		if (left == READ_BUFFER_SIZE) return -EOVERFLOW;
+		memmove(buffer, end, left);
+	}
+	return 0;
+}
+
+/**
+ * Reads the user and system CPU ticks and the resident set size from stat.
+ *
+ * @return     0 for success, negative error code otherwise.
+ */
+static int
+read_stat(proc_smaps_t* self, proc_sample_t* sample)
+{
+	char buffer[1024];
+	ssize_t len = pread(self->stat_fd, buffer, sizeof(buffer) - 1, 0);
+	if (len <= 0) return len ? -errno : -ESRCH;
+	buffer[len] = '\0';
+
+	/* the process name can contain spaces and parentheses, so start
+	 * counting the fields from the last ')' */
+	char* ptr = strrchr(buffer, ')');
+	int field = 2;
+	while (ptr && *ptr && field < 14) {
+		if (*ptr++ == ' ') field++;
+	}
+	if (!ptr || field != 14) return -EINVAL;
+	unsigned long long utime = strtoull(ptr, &ptr, 10);
+	unsigned long long stime = strtoull(ptr, &ptr, 10);
+	sample->cpu_ticks = utime + stime;
+
+	/* skip to the rss field (24) */
+	for (field = 16; field < 24 && ptr; field++) {
+		ptr = strchr(ptr + 1, ' ');
+	}
+	sample->rss = ptr ? strtol(ptr, NULL, 10) * (sysconf(_SC_PAGESIZE) / 1024) : -1;
+	return 0;
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int
+proc_smaps_open(proc_smaps_t* self, int pid)
+{
+	char path[64];
+	int rc;
+
+	self->stat_fd = -1;
+	self->is_rollup = true;
+	sprintf(path, "/proc/%d/smaps_rollup", pid);
+	if ( (self->fd = open(path, O_RDONLY)) == -1) {
+		if (errno != ENOENT) return -errno;
+		/* kernels before 4.14 have only the per-mapping smaps */
+		self->is_rollup = false;
+		sprintf(path, "/proc/%d/smaps", pid);
+		if ( (self->fd = open(path, O_RDONLY)) == -1) return errno == ENOENT ? -ESRCH : -errno;
+	}
+	sprintf(path, "/proc/%d/stat", pid);
+	if ( (self->stat_fd = open(path, O_RDONLY)) == -1) {
+		rc = errno == ENOENT ? -ESRCH : -errno;
+		proc_smaps_close(self);
+		return rc;
+	}
+	return 0;
+}
+
+
+int
+proc_smaps_read(proc_smaps_t* self, proc_sample_t* sample)
+{
+	/* stat can be read as long as the process exists */
+	int rc = read_stat(self, sample);
+	if (rc == 0) {
+		rc = read_smaps(self, sample);
+		/* kernel threads and zombie processes have no memory map */
+		if (rc == -ESRCH) {
+			sample->clean = sample->dirty = sample->swap = 0;
+			rc = 0;
+		}
+	}
+	if (rc != 0) {
+		sample->clean = sample->dirty = sample->swap = -1;
+		sample->cpu_ticks = -1;
+		sample->rss = -1;
+	}
+	return rc;
+}
+
+
+int
+proc_smaps_read_stat(proc_smaps_t* self, proc_sample_t* sample)
+{
+	int rc = read_stat(self, sample);
+	if (rc != 0) {
+		sample->cpu_ticks = -1;
+		sample->rss = -1;
+	}
+	return rc;
+}
+
+
+void
+proc_smaps_close(proc_smaps_t* self)
+{
+	if (self->fd != -1) close(self->fd);
+	if (self->stat_fd != -1) close(self->stat_fd);
+	self->fd = self->stat_fd = -1;
+}
@@ -0,0 +1,108 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file proc_smaps.h
+ * Process memory and CPU usage collector.
+ *
+ * Reads the process private memory totals from /proc/<pid>/smaps_rollup,
+ * where the kernel has already summed the mappings, or by summing
+ * /proc/<pid>/smaps on kernels without smaps_rollup. The CPU ticks are
+ * read from /proc/<pid>/stat. The files are kept open between the reads.
+ */
+#ifndef PROC_SMAPS_H
+#define PROC_SMAPS_H
+
+#include <stdbool.h>
+
+/**
+ * Process resource usage sample.
+ *
+ * Memory sizes are in kilobytes. Unavailable values are set to -1.
+ */
+typedef struct proc_sample_t {
+	/* private clean memory */
+	int clean;
+	/* private dirty memory */
+	int dirty;
+	/* swapped out memory */
+	int swap;
+	/* user + system CPU ticks */
+	long long cpu_ticks;
+	/* resident set size */
+	int rss;
+} proc_sample_t;
+
+/**
+ * The collector of a single process.
+ */
+typedef struct proc_smaps_t {
+	/* smaps_rollup or smaps file descriptor */
+	int fd;
+	/* stat file descriptor */
+	int stat_fd;
+	/* fd refers to smaps_rollup */
+	bool is_rollup;
+} proc_smaps_t;
+
+/**
+ * Opens the process memory and CPU usage files.
+ *
+ * @param[out] self   the collector.
+ * @param[in] pid     the process identifier.
+ * @return            0 for success, -ESRCH if the process has exited,
+ *                    other negative error code otherwise.
+ */
+int proc_smaps_open(
+		proc_smaps_t* self,
+		int pid
+		);
+
+/**
+ * Reads the process resource usage.
+ *
+ * @param[in] self     the collector.
+ * @param[out] sample  the read resource usage.
+ * @return             0 for success, -ESRCH if the process has exited,
+ *                     other negative error code otherwise.
+ */
+int proc_smaps_read(
+		proc_smaps_t* self,
+		proc_sample_t* sample
+		);
+
+/**
+ * Reads only the process CPU usage and resident set size.
+ *
+ * This reads just the stat file, which is much cheaper than parsing
+ * smaps. The memory usage fields of the sample are not changed.
+ * @param[in] self     the collector.
+ * @param[out] sample  the read resource usage.
+ * @return             0 for success, -ESRCH if the process has exited,
+ *                     other negative error code otherwise.
+ */
+int proc_smaps_read_stat(
+		proc_smaps_t* self,
+		proc_sample_t* sample
+		);
+
+/**
+ * Closes the process files.
+ *
+ * @param[in] self    the collector.
+ */
+void proc_smaps_close(
+		proc_smaps_t* self
+		);
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "proc_table.h"
+
+/**
+ * Private API
+ */
+
+/* index slot values besides entry indices */
+#define PROC_TABLE_SLOT_EMPTY     -1
+#define PROC_TABLE_SLOT_DELETED   -2
+
+#define PROC_TABLE_MIN_CAPACITY   16
+
+/**
+ * Returns the first index slot of the pid probe sequence.
+ */
+static int slot_hash(
+		const proc_table_t* self,
+		int pid
+		)
+{
+	/* Fibonacci hashing spreads the sequential pids over the table */
+	return ((unsigned)pid * 2654435769u) & (self->slots_size - 1);
+}
+
+/**
+ * Checks if the entry matches the key.
+ */
+static int entry_match(
+		const proc_table_entry_t* entry,
+		int pid,
+		unsigned long long start_time
+		)
+{
+	return entry->pid == pid && (!start_time || entry->start_time == start_time);
+}
+
+/**
+ * Finds the index slot of a key.
+ *
+ * @return   the slot index or -1 if the key was not found.
+ */
+static int slot_find(
+		const proc_table_t* self,
+		int pid,
+		unsigned long long start_time
+		)
+{
+	int slot;
+	if (!self->slots_size) return -1;
+	for (slot = slot_hash(self, pid); self->slots[slot] != PROC_TABLE_SLOT_EMPTY;
+			slot = (slot + 1) & (self->slots_size - 1)) {
+		int index = self->slots[slot];
+		if (index >= 0 && entry_match(&self->entries[index], pid, start_time)) {
+			return slot;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Inserts an entry into the index (no duplicate or size checks).
+ */
+static void slot_insert(
+		proc_table_t* self,
+		int index
+		)
+{
+	int slot = slot_hash(self, self->entries[index].pid);
+	while (self->slots[slot] >= 0) {
+		slot = (slot + 1) & (self->slots_size - 1);
+	}
+	if (self->slots[slot] == PROC_TABLE_SLOT_EMPTY) self->slots_used++;
+	self->slots[slot] = index;
+}
+
+/**
+ * Rebuilds the index with the specified number of slots.
+ *
+ * @return   0 for success.
+ */
+static int index_rebuild(
+		proc_table_t* self,
+		int slots_size
+		)
+{
+	int index;
+	if (slots_size != self->slots_size) {
+		int* slots = (int*)malloc(slots_size * sizeof(int));
+		if (!slots) return -ENOMEM;
+		free(self->slots);
+		self->slots = slots;
+		self->slots_size = slots_size;
+	}
+	self->slots_used = 0;
+	memset(self->slots, 0xff, slots_size * sizeof(int));
+
+	for (index = 0; index < self->size; index++) {
+		if (self->entries[index].item) slot_insert(self, index);
+	}
+	return 0;
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int proc_table_add(
+		proc_table_t* self,
+		int pid,
+		unsigned long long start_time,
+		void* item
+		)
+{
+	int rc;
+	if (self->size == self->capacity) {
+		int capacity = self->capacity ? self->capacity * 2 : PROC_TABLE_MIN_CAPACITY;
+		proc_table_entry_t* entries = (proc_table_entry_t*)realloc(self->entries,
+				capacity * sizeof(proc_table_entry_t));
+		if (!entries) return -ENOMEM;
+		self->entries = entries;
+		self->capacity = capacity;
+	}
+	/* keep the index at most half full, counting also the deleted slots */
+	if ( (self->slots_used + 1) * 2 > self->slots_size) {
+		int slots_size = self->slots_size ? self->slots_size : PROC_TABLE_MIN_CAPACITY * 2;
+		while ( (self->count + 1) * 2 > slots_size / 2) slots_size *= 2;
+		if ( (rc = index_rebuild(self, slots_size)) != 0) return rc;
+	}
+	proc_table_entry_t* entry = &self->entries[self->size];
+	entry->pid = pid;
+	entry->start_time = start_time;
+	entry->item = item;
+	slot_insert(self, self->size++);
+	self->count++;
+	return 0;
+}
+
+
+void* proc_table_find(
+		const proc_table_t* self,
+		int pid,
+		unsigned long long start_time
+		)
+{
+	int slot = slot_find(self, pid, start_time);
+	return slot == -1 ? NULL : self->entries[self->slots[slot]].item;
+}
+
+
+void* proc_table_remove(
+		proc_table_t* self,
+		int pid,
+		unsigned long long start_time
+		)
+{
+	int slot = slot_find(self, pid, start_time);
+	if (slot == -1) return NULL;
+
+	proc_table_entry_t* entry = &self->entries[self->slots[slot]];
+	void* item = entry->item;
+	entry->item = NULL;
+	self->slots[slot] = PROC_TABLE_SLOT_DELETED;
+	self->count--;
+	return item;
+}
+
+
+int proc_table_compact(
+		proc_table_t* self
+		)
+{
+	int index, first = -1, size = 0;
+	if (self->count == self->size) return -1;
+
+	for (index = 0; index < self->size; index++) {
+		if (self->entries[index].item) {
+			if (size != index) {
+				self->entries[size] = self->entries[index];
+				if (first == -1) first = size;
+			}
+			size++;
+		}
+	}
+	self->size = size;
+	/* the entry indices have changed, rebuild the index */
+	index_rebuild(self, self->slots_size);
+	return first == -1 ? size : first;
+}
+
+
+void proc_table_free(
+		proc_table_t* self
+		)
+{
+	free(self->entries);
+	free(self->slots);
+	memset(self, 0, sizeof(proc_table_t));
+}
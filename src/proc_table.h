@@ -0,0 +1,134 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file proc_table.h
+ * Process table keyed by (pid, start time).
+ *
+ * The items are kept in a dense array in the insertion order, which is
+ * also the report column order, and indexed by an open addressing hash
+ * table. Adding, finding and removing items are constant time operations.
+ *
+ * Removed items leave holes (NULL items) in the array, so removal is safe
+ * while iterating. The holes are squeezed out by proc_table_compact().
+ */
+#ifndef PROC_TABLE_H
+#define PROC_TABLE_H
+
+/**
+ * The process table entry.
+ */
+typedef struct proc_table_entry_t {
+	/* process identifier */
+	int pid;
+	/* process start time, distinguishes processes with reused pid */
+	unsigned long long start_time;
+	/* the stored item, NULL for removed entries */
+	void* item;
+} proc_table_entry_t;
+
+/**
+ * The process table.
+ *
+ * A zero initialized structure is an empty table.
+ */
+typedef struct proc_table_t {
+	/* the entries in insertion order */
+	proc_table_entry_t* entries;
+	/* the number of used entries, including removed ones */
+	int size;
+	/* the number of allocated entries */
+	int capacity;
+	/* the number of stored items */
+	int count;
+
+	/* hash index of entries, see PROC_TABLE_SLOT_* values */
+	int* slots;
+	/* the number of index slots, power of 2 */
+	int slots_size;
+	/* the number of used index slots, including deleted ones */
+	int slots_used;
+} proc_table_t;
+
+/* iterates over the stored items, skipping removed entries */
+#define PROC_TABLE_FOREACH(table, i, ptr) \
+	for ((i) = 0; (i) < (table)->size; (i)++) \
+		if ( ((ptr) = (table)->entries[i].item) != NULL)
+
+/**
+ * Adds an item to the end of the table.
+ *
+ * @param[in] self        the table.
+ * @param[in] pid         the process identifier.
+ * @param[in] start_time  the process start time.
+ * @param[in] item        the item to add.
+ * @return                0 for success.
+ */
+int proc_table_add(
+		proc_table_t* self,
+		int pid,
+		unsigned long long start_time,
+		void* item
+		);
+
+/**
+ * Finds an item.
+ *
+ * @param[in] self        the table.
+ * @param[in] pid         the process identifier.
+ * @param[in] start_time  the process start time, 0 matches any start time.
+ * @return                the found item or NULL.
+ */
+void* proc_table_find(
+		const proc_table_t* self,
+		int pid,
+		unsigned long long start_time
+		);
+
+/**
+ * Removes an item.
+ *
+ * The item entry is left as a hole until the table is compacted.
+ * @param[in] self        the table.
+ * @param[in] pid         the process identifier.
+ * @param[in] start_time  the process start time, 0 matches any start time.
+ * @return                the removed item or NULL if it was not found.
+ */
+void* proc_table_remove(
+		proc_table_t* self,
+		int pid,
+		unsigned long long start_time
+		);
+
+/**
+ * Removes the holes left by removed items.
+ *
+ * @param[in] self        the table.
+ * @return                the index of the first moved entry (the new
+ *                        table size if no entries were moved) or -1 if
+ *                        there was nothing to compact.
+ */
+int proc_table_compact(
+		proc_table_t* self
+		);
+
+/**
+ * Frees the table resources (but not the stored items).
+ *
+ * @param[in] self        the table.
+ */
+void proc_table_free(
+		proc_table_t* self
+		);
+
+#endif
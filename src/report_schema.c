@@ -0,0 +1,365 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "report_schema.h"
+
+/**
+ * Private API
+ */
+
+/**
+ * The encoding buffer.
+ */
+typedef struct buffer_t {
+	unsigned char* data;
+	int size;
+	int capacity;
+} buffer_t;
+
+/**
+ * The decoding position.
+ */
+typedef struct cursor_t {
+	const unsigned char* ptr;
+	const unsigned char* end;
+	/* the data ended before the decoded value */
+	bool is_truncated;
+} cursor_t;
+
+/**
+ * Appends data to the buffer.
+ *
+ * @param[in] buffer   the buffer.
+ * @param[in] data     the data.
+ * @param[in] size     the data size.
+ * @return             0 for success.
+ */
+static int buffer_put(
+		buffer_t* buffer,
+		const void* data,
+		int size
+		)
+{
+	if (buffer->size + size > buffer->capacity) {
+		int capacity = buffer->capacity ? buffer->capacity : 256;
+		while (capacity < buffer->size + size) capacity *= 2;
+		unsigned char* ptr = realloc(buffer->data, capacity);
+		if (!ptr) return -ENOMEM;
+		buffer->data = ptr;
+		buffer->capacity = capacity;
+	}
+	memcpy(buffer->data + buffer->size, data, size);
+	buffer->size += size;
+	return 0;
+}
+
+/**
+ * Appends a byte to the buffer.
+ */
+static int buffer_put_u8(
+		buffer_t* buffer,
+		int value
+		)
+{
+	unsigned char byte = value;
+	return buffer_put(buffer, &byte, 1);
+}
+
+/**
+ * Appends an unsigned LEB128 encoded value to the buffer.
+ */
+static int buffer_put_varint(
+		buffer_t* buffer,
+		uint64_t value
+		)
+{
+	unsigned char data[10];
+	int size = 0;
+	while (value >= 0x80) {
+		data[size++] = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	data[size++] = value;
+	return buffer_put(buffer, data, size);
+}
+
+/**
+ * Appends a string with its length to the buffer, NULL is stored as
+ * an empty string.
+ */
+static int buffer_put_string(
+		buffer_t* buffer,
+		const char* text
+		)
+{
+	int len = text ? strlen(text) : 0, rc;
+	if ( (rc = buffer_put_varint(buffer, len)) != 0) return rc;
+	return len ? buffer_put(buffer, text, len) : 0;
+}
+
+/**
+ * Reads a byte.
+ */
+static int cursor_get_u8(
+		cursor_t* cursor
+		)
+{
+	if (cursor->ptr >= cursor->end) {
+		cursor->is_truncated = true;
+		return 0;
+	}
+	return *cursor->ptr++;
+}
+
+/**
+ * Reads an unsigned LEB128 encoded value.
+ */
+static uint64_t cursor_get_varint(
+		cursor_t* cursor
+		)
+{
+	uint64_t value = 0;
+	int shift = 0;
+	while (cursor->ptr < cursor->end && shift < 64) {
+		unsigned char byte = *cursor->ptr++;
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return value;
+		shift += 7;
+	}
+	cursor->is_truncated = true;
+	return 0;
+}
+
+/**
+ * Reads a string.
+ *
+ * @return   the allocated string or NULL if the data is too short or
+ *           the string is empty and empty strings are not allowed.
+ */
+static char* cursor_get_string(
+		cursor_t* cursor,
+		bool allow_empty
+		)
+{
+	uint64_t len = cursor_get_varint(cursor);
+	if ((uint64_t)(cursor->end - cursor->ptr) < len) {
+		cursor->is_truncated = true;
+		return NULL;
+	}
+	const unsigned char* data = cursor->ptr;
+	cursor->ptr += len;
+	if (!len && !allow_empty) return NULL;
+	return strndup((const char*)data, len);
+}
+
+/**
+ * Counts the nodes and data columns of the header structure.
+ *
+ * @param[in] header      the first header at the current level.
+ * @param[in,out] count   the number of nodes.
+ * @param[in,out] columns the number of data columns.
+ */
+static void count_nodes(
+		const sp_report_header_t* header,
+		int* count,
+		int* columns
+		)
+{
+	for (; header; header = header->next) {
+		if (!header->child) {
+			/* the same headers are data columns as in the report layout */
+			if (!header->print && !header->value) continue;
+			(*columns)++;
+		}
+		(*count)++;
+		if (header->child) count_nodes(header->child, count, columns);
+	}
+}
+
+/**
+ * Copies the header structure into the schema nodes.
+ *
+ * @param[in] self     the schema.
+ * @param[in] header   the first header at the current level.
+ * @param[in] depth    the current level.
+ * @return             0 for success.
+ */
+static int copy_nodes(
+		report_schema_t* self,
+		const sp_report_header_t* header,
+		int depth
+		)
+{
+	int rc;
+	for (; header; header = header->next) {
+		int flags = 0;
+		if (!header->child) {
+			if (!header->print && !header->value) continue;
+			flags |= REPORT_SCHEMA_NODE_LEAF;
+			if (header->value) flags |= REPORT_SCHEMA_NODE_TYPED;
+			if (header->format.sign) flags |= REPORT_SCHEMA_NODE_SIGN;
+			self->columns[self->column_count++] = self->node_count;
+		}
+		report_schema_node_t* node = &self->nodes[self->node_count++];
+		node->depth = depth;
+		node->flags = flags;
+		node->alignment = header->alignment;
+		node->size = header->size > 0 ? header->size : 0;
+		node->precision = header->format.precision;
+		if ( (node->title = strdup(header->title)) == NULL) return -ENOMEM;
+		if (header->key && *header->key && (node->key = strdup(header->key)) == NULL) return -ENOMEM;
+		if (header->format.suffix && *header->format.suffix &&
+				(node->suffix = strdup(header->format.suffix)) == NULL) return -ENOMEM;
+		if (header->child && (rc = copy_nodes(self, header->child, depth + 1)) != 0) return rc;
+	}
+	return 0;
+}
+
+/**
+ * Allocates the node and column arrays.
+ *
+ * @param[in] self     the schema.
+ * @param[in] count    the number of nodes.
+ * @return             0 for success.
+ */
+static int schema_alloc(
+		report_schema_t* self,
+		int count
+		)
+{
+	memset(self, 0, sizeof(*self));
+	if ( (self->nodes = calloc(count + 1, sizeof(report_schema_node_t))) == NULL ||
+			(self->columns = calloc(count + 1, sizeof(int))) == NULL) {
+		report_schema_free(self);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int report_schema_init(
+		report_schema_t* self,
+		const sp_report_header_t* root
+		)
+{
+	int count = 0, columns = 0, rc;
+
+	count_nodes(root->child, &count, &columns);
+	if ( (rc = schema_alloc(self, count)) != 0) return rc;
+	if ( (rc = copy_nodes(self, root->child, 0)) != 0) {
+		report_schema_free(self);
+		return rc;
+	}
+	return 0;
+}
+
+
+int report_schema_encode(
+		const report_schema_t* self,
+		unsigned char** data,
+		int* size
+		)
+{
+	buffer_t buffer = {0};
+	int i, rc;
+
+	if ( (rc = buffer_put_varint(&buffer, self->node_count)) != 0) goto failure;
+	for (i = 0; i < self->node_count; i++) {
+		const report_schema_node_t* node = &self->nodes[i];
+		if ( (rc = buffer_put_varint(&buffer, node->depth)) != 0 ||
+				(rc = buffer_put_u8(&buffer, node->flags)) != 0 ||
+				(rc = buffer_put_u8(&buffer, node->alignment)) != 0 ||
+				(rc = buffer_put_varint(&buffer, node->size)) != 0 ||
+				(rc = buffer_put_u8(&buffer, node->precision)) != 0 ||
+				(rc = buffer_put_string(&buffer, node->title)) != 0 ||
+				(rc = buffer_put_string(&buffer, node->key)) != 0 ||
+				(rc = buffer_put_string(&buffer, node->suffix)) != 0) goto failure;
+	}
+	*data = buffer.data;
+	*size = buffer.size;
+	return 0;
+
+failure:
+	free(buffer.data);
+	return rc;
+}
+
+
+int report_schema_decode(
+		report_schema_t* self,
+		const unsigned char* data,
+		int size
+		)
+{
+	cursor_t cursor = {.ptr = data, .end = data + size};
+	int i, count, rc;
+
+	memset(self, 0, sizeof(*self));
+	count = cursor_get_varint(&cursor);
+	/* every node takes at least one byte */
+	if (cursor.is_truncated || (uint64_t)count > (uint64_t)size) return -EINVAL;
+	if ( (rc = schema_alloc(self, count)) != 0) return rc;
+	for (i = 0; i < count; i++) {
+		report_schema_node_t* node = &self->nodes[i];
+		self->node_count++;
+		node->depth = cursor_get_varint(&cursor);
+		node->flags = cursor_get_u8(&cursor);
+		node->alignment = cursor_get_u8(&cursor);
+		node->size = cursor_get_varint(&cursor);
+		node->precision = cursor_get_u8(&cursor);
+		node->title = cursor_get_string(&cursor, true);
+		node->key = cursor_get_string(&cursor, false);
+		node->suffix = cursor_get_string(&cursor, false);
+		if (cursor.is_truncated || !node->title || node->size < 0) goto invalid;
+		/* the nodes are in pre-order, so the depth can grow only by one */
+		if (node->depth < 0 || node->depth > (i ? self->nodes[i - 1].depth + 1 : 0)) goto invalid;
+		if (node->flags & REPORT_SCHEMA_NODE_LEAF) self->columns[self->column_count++] = i;
+	}
+	return 0;
+
+invalid:
+	report_schema_free(self);
+	return -EINVAL;
+}
+
+
+void report_schema_free(
+		report_schema_t* self
+		)
+{
+	int i;
+	for (i = 0; i < self->node_count; i++) {
+		free(self->nodes[i].title);
+		free(self->nodes[i].key);
+		free(self->nodes[i].suffix);
+	}
+	free(self->nodes);
+	free(self->columns);
+	memset(self, 0, sizeof(*self));
+}
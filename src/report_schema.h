@@ -0,0 +1,123 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file report_schema.h
+ * Self describing schema of the report header structure.
+ *
+ * The schema holds the header tree as a list of nodes in pre-order with
+ * everything needed to create the same report layout again: the titles,
+ * keys, sizes, alignments and the typed value formats. It's stored with
+ * the recorded samples, so they can be printed later exactly as they
+ * were printed when recorded.
+ *
+ * The encoding (varint is unsigned LEB128, string is varint length and
+ * the text):
+ *     varint   number of header nodes, followed by the nodes in pre-order:
+ *     varint   node depth, 0 for the top level headers
+ *     u8       flags, see REPORT_SCHEMA_NODE_* definitions
+ *     u8       alignment
+ *     varint   size
+ *     u8       precision of typed double values
+ *     string   title
+ *     string   key, empty if derived from the title
+ *     string   suffix of typed values
+ */
+#ifndef REPORT_SCHEMA_H
+#define REPORT_SCHEMA_H
+
+#include "sp_report.h"
+
+/* the schema node flags */
+#define REPORT_SCHEMA_NODE_LEAF        1
+#define REPORT_SCHEMA_NODE_TYPED       2
+#define REPORT_SCHEMA_NODE_SIGN        4
+
+/**
+ * The header node of the schema.
+ */
+typedef struct report_schema_node_t {
+	int depth;
+	int flags;
+	int alignment;
+	int size;
+	int precision;
+	char* title;
+	/* the key and typed value suffix, NULL if not set */
+	char* key;
+	char* suffix;
+} report_schema_node_t;
+
+/**
+ * The report schema.
+ */
+typedef struct report_schema_t {
+	report_schema_node_t* nodes;
+	int node_count;
+	/* the data columns, indices of the leaf nodes */
+	int* columns;
+	int column_count;
+} report_schema_t;
+
+
+/**
+ * Creates the schema of the report header structure.
+ *
+ * The data columns are the same as in the report layout.
+ * @param[out] self  the schema.
+ * @param[in] root   the report root header.
+ * @return           0 for success.
+ */
+int report_schema_init(
+		report_schema_t* self,
+		const sp_report_header_t* root
+		);
+
+/**
+ * Encodes the schema.
+ *
+ * @param[in] self   the schema.
+ * @param[out] data  the allocated encoded schema.
+ * @param[out] size  the encoded schema size.
+ * @return           0 for success.
+ */
+int report_schema_encode(
+		const report_schema_t* self,
+		unsigned char** data,
+		int* size
+		);
+
+/**
+ * Decodes the schema.
+ *
+ * @param[out] self  the schema, left empty in the case of failure.
+ * @param[in] data   the encoded schema.
+ * @param[in] size   the encoded schema size.
+ * @return           0 for success, -EINVAL if the data is not valid.
+ */
+int report_schema_decode(
+		report_schema_t* self,
+		const unsigned char* data,
+		int size
+		);
+
+/**
+ * Releases the schema resources.
+ *
+ * @param[in] self   the schema.
+ */
+void report_schema_free(
+		report_schema_t* self
+		);
+
+#endif
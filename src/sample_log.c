@@ -0,0 +1,1035 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include "sample_log.h"
+
+/**
+ * Private API
+ */
+
+/* the run header size */
+#define RUN_HEADER_SIZE     5
+
+/* the trailer record size: type, payload length and the index offset */
+#define TRAILER_SIZE        10
+
+/* the largest number of decimals stored for typed double values */
+#define MAX_DECIMALS        9
+
+/* the largest number of digits in numeric text stored as a number */
+#define MAX_DIGITS          18
+
+static const int64_t pow10_table[MAX_DIGITS + 1] = {
+	1ll, 10ll, 100ll, 1000ll, 10000ll, 100000ll, 1000000ll, 10000000ll, 100000000ll,
+	1000000000ll, 10000000000ll, 100000000000ll, 1000000000000ll, 10000000000000ll,
+	100000000000000ll, 1000000000000000ll, 10000000000000000ll, 100000000000000000ll,
+	1000000000000000000ll,
+};
+
+/**
+ * The record payload parsing position.
+ */
+typedef struct cursor_t {
+	const unsigned char* ptr;
+	const unsigned char* end;
+	/* the payload ended before the parsed data */
+	bool is_truncated;
+} cursor_t;
+
+/**
+ * Reserves space at the end of the buffer.
+ *
+ * @param[in] buffer   the buffer.
+ * @param[in] size     the space to reserve.
+ * @return             the reserved space or NULL in the case of failure.
+ */
+static unsigned char* buffer_reserve(
+		sample_log_buffer_t* buffer,
+		int size
+		)
+{
+	if (buffer->size + size > buffer->capacity) {
+		int capacity = buffer->capacity ? buffer->capacity : 256;
+		while (capacity < buffer->size + size) capacity *= 2;
+		unsigned char* data = realloc(buffer->data, capacity);
+		if (!data) return NULL;
+		buffer->data = data;
+		buffer->capacity = capacity;
+	}
+	unsigned char* ptr = buffer->data + buffer->size;
+	buffer->size += size;
+	return ptr;
+}
+
+/**
+ * Appends data to the buffer.
+ *
+ * @param[in] buffer   the buffer.
+ * @param[in] data     the data.
+ * @param[in] size     the data size.
+ * @return             0 for success.
+ */
+static int buffer_put(
+		sample_log_buffer_t* buffer,
+		const void* data,
+		int size
+		)
+{
+	unsigned char* ptr = buffer_reserve(buffer, size);
+	if (!ptr) return -ENOMEM;
+	memcpy(ptr, data, size);
+	return 0;
+}
+
+/**
+ * Appends a byte to the buffer.
+ */
+static int buffer_put_u8(
+		sample_log_buffer_t* buffer,
+		int value
+		)
+{
+	unsigned char* ptr = buffer_reserve(buffer, 1);
+	if (!ptr) return -ENOMEM;
+	*ptr = value;
+	return 0;
+}
+
+/**
+ * Appends an unsigned LEB128 encoded value to the buffer.
+ */
+static int buffer_put_varint(
+		sample_log_buffer_t* buffer,
+		uint64_t value
+		)
+{
+	unsigned char data[10];
+	int size = 0;
+	while (value >= 0x80) {
+		data[size++] = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	data[size++] = value;
+	return buffer_put(buffer, data, size);
+}
+
+/**
+ * Appends a zigzag encoded signed value to the buffer.
+ */
+static int buffer_put_svarint(
+		sample_log_buffer_t* buffer,
+		int64_t value
+		)
+{
+	return buffer_put_varint(buffer, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+/**
+ * Appends a string with its length to the buffer.
+ */
+static int buffer_put_string(
+		sample_log_buffer_t* buffer,
+		const char* text,
+		int len
+		)
+{
+	int rc;
+	if ( (rc = buffer_put_varint(buffer, len)) != 0) return rc;
+	return buffer_put(buffer, text, len);
+}
+
+/**
+ * Reads a byte from the payload.
+ */
+static int cursor_get_u8(
+		cursor_t* cursor
+		)
+{
+	if (cursor->ptr >= cursor->end) {
+		cursor->is_truncated = true;
+		return 0;
+	}
+	return *cursor->ptr++;
+}
+
+/**
+ * Reads an unsigned LEB128 encoded value from the payload.
+ */
+static uint64_t cursor_get_varint(
+		cursor_t* cursor
+		)
+{
+	uint64_t value = 0;
+	int shift = 0;
+	while (cursor->ptr < cursor->end && shift < 64) {
+		unsigned char byte = *cursor->ptr++;
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return value;
+		shift += 7;
+	}
+	cursor->is_truncated = true;
+	return 0;
+}
+
+/**
+ * Reads a zigzag encoded signed value from the payload.
+ */
+static int64_t cursor_get_svarint(
+		cursor_t* cursor
+		)
+{
+	uint64_t value = cursor_get_varint(cursor);
+	return (int64_t)((value >> 1) ^ -(value & 1));
+}
+
+/**
+ * Reads data from the payload.
+ *
+ * @return   the data or NULL if the payload is too short.
+ */
+static const unsigned char* cursor_get_data(
+		cursor_t* cursor,
+		uint64_t size
+		)
+{
+	if ((uint64_t)(cursor->end - cursor->ptr) < size) {
+		cursor->is_truncated = true;
+		return NULL;
+	}
+	const unsigned char* ptr = cursor->ptr;
+	cursor->ptr += size;
+	return ptr;
+}
+
+/**
+ * Copies a string into the value.
+ *
+ * @return   0 for success.
+ */
+static int value_set_string(
+		sample_log_value_t* value,
+		const char* text,
+		int len
+		)
+{
+	if (len + 1 > value->s_capacity) {
+		int capacity = value->s_capacity ? value->s_capacity : 32;
+		while (capacity < len + 1) capacity *= 2;
+		char* s = realloc(value->s, capacity);
+		if (!s) return -ENOMEM;
+		value->s = s;
+		value->s_capacity = capacity;
+	}
+	memcpy(value->s, text, len);
+	value->s[len] = '\0';
+	return 0;
+}
+
+/**
+ * Resizes the value array, resetting all values to n/a.
+ *
+ * @param[in,out] values  the value array.
+ * @param[in] count       the current number of values.
+ * @param[in] new_count   the new number of values.
+ * @return                0 for success.
+ */
+static int values_resize(
+		sample_log_value_t** values,
+		int count,
+		int new_count
+		)
+{
+	int i;
+	for (i = 0; i < count; i++) {
+		free((*values)[i].s);
+	}
+	free(*values);
+	*values = NULL;
+	if (new_count && (*values = calloc(new_count, sizeof(sample_log_value_t))) == NULL) return -ENOMEM;
+	return 0;
+}
+
+/**
+ * Resets the values to n/a.
+ */
+static void values_reset(
+		sample_log_value_t* values,
+		int count
+		)
+{
+	int i;
+	for (i = 0; i < count; i++) {
+		values[i].tag = SAMPLE_LOG_VALUE_NA;
+	}
+}
+
+/**
+ * Parses numeric text as an integer or decimal number.
+ *
+ * Only the texts, which are printed back exactly the same, are parsed.
+ * @param[in] text       the text.
+ * @param[out] value     the value multiplied by 10^decimals.
+ * @param[out] decimals  the number of decimals.
+ * @return               true if the text was parsed.
+ */
+static bool parse_decimal(
+		const char* text,
+		int64_t* value,
+		int* decimals
+		)
+{
+	const char* ptr = text;
+	bool is_negative = *ptr == '-';
+	uint64_t number = 0;
+	int digits = 0, count = -1;
+
+	if (is_negative) ptr++;
+	if (*ptr < '0' || *ptr > '9') return false;
+	/* leading zeros would be lost */
+	if (*ptr == '0' && ptr[1] >= '0' && ptr[1] <= '9') return false;
+	for (; *ptr; ptr++) {
+		if (*ptr == '.') {
+			if (count != -1 || ptr[1] < '0' || ptr[1] > '9') return false;
+			count = 0;
+			continue;
+		}
+		if (*ptr < '0' || *ptr > '9' || ++digits > MAX_DIGITS) return false;
+		number = number * 10 + (*ptr - '0');
+		if (count != -1) count++;
+	}
+	/* the sign of negative zero would be lost */
+	if (is_negative && !number) return false;
+	*value = is_negative ? -(int64_t)number : (int64_t)number;
+	*decimals = count == -1 ? 0 : count;
+	return true;
+}
+
+/**
+ * Formats decimal number as text.
+ *
+ * @param[out] buffer    the output buffer.
+ * @param[in] size       the output buffer size.
+ * @param[in] value      the value multiplied by 10^decimals.
+ * @param[in] decimals   the number of decimals.
+ * @return               the text length.
+ */
+static int format_decimal(
+		char* buffer,
+		int size,
+		int64_t value,
+		int decimals
+		)
+{
+	uint64_t number = value < 0 ? -(uint64_t)value : (uint64_t)value;
+	if (!decimals) return snprintf(buffer, size, "%s%llu", value < 0 ? "-" : "", (unsigned long long)number);
+	return snprintf(buffer, size, "%s%llu.%0*llu", value < 0 ? "-" : "",
+			(unsigned long long)(number / pow10_table[decimals]), decimals,
+			(unsigned long long)(number % pow10_table[decimals]));
+}
+
+/**
+ * Writes a record into the log.
+ *
+ * @param[in] self     the log writer.
+ * @param[in] type     the record type.
+ * @param[in] payload  the record payload.
+ * @return             0 for success.
+ */
+static int writer_put_record(
+		sample_log_writer_t* self,
+		int type,
+		const sample_log_buffer_t* payload
+		)
+{
+	sample_log_buffer_t header = {0};
+	unsigned char data[16];
+	int rc;
+
+	/* the record header is encoded into the stack buffer */
+	header.data = data;
+	header.capacity = sizeof(data);
+	if ( (rc = buffer_put_u8(&header, type)) != 0) return rc;
+	if ( (rc = buffer_put_varint(&header, payload->size)) != 0) return rc;
+	if (fwrite(header.data, 1, header.size, self->fp) != (size_t)header.size ||
+			fwrite(payload->data, 1, payload->size, self->fp) != (size_t)payload->size) return -EIO;
+	if (self->offset != -1) self->offset += header.size + payload->size;
+	return 0;
+}
+
+/**
+ * Writes the schema of the report header structure.
+ *
+ * @param[in] self     the log writer.
+ * @param[in] root     the report root header.
+ * @param[in] columns  the number of data columns.
+ * @return             0 for success.
+ */
+static int writer_put_schema(
+		sample_log_writer_t* self,
+		sp_report_header_t* root,
+		int columns
+		)
+{
+	report_schema_t schema;
+	unsigned char* data;
+	int i, size, rc;
+
+	if ( (rc = report_schema_init(&schema, root)) != 0) return rc;
+	if (schema.column_count != columns) {
+		rc = -EINVAL;
+		goto cleanup;
+	}
+	if ( (rc = values_resize(&self->values, self->value_count, columns)) != 0) goto cleanup;
+	self->value_count = columns;
+	free(self->precisions);
+	if ( (self->precisions = calloc(columns + 1, sizeof(int))) == NULL) {
+		rc = -ENOMEM;
+		goto cleanup;
+	}
+	for (i = 0; i < columns; i++) {
+		const report_schema_node_t* node = &schema.nodes[schema.columns[i]];
+		int precision = node->precision < MAX_DECIMALS ? node->precision : MAX_DECIMALS;
+		self->precisions[i] = node->flags & REPORT_SCHEMA_NODE_TYPED ? precision : -1;
+	}
+
+	if ( (rc = report_schema_encode(&schema, &data, &size)) != 0) goto cleanup;
+	self->record.size = 0;
+	rc = buffer_put(&self->record, data, size);
+	free(data);
+	if (rc != 0) goto cleanup;
+	self->schema_offset = self->offset;
+	rc = writer_put_record(self, SAMPLE_LOG_RECORD_SCHEMA, &self->record);
+
+cleanup:
+	report_schema_free(&schema);
+	return rc;
+}
+
+/**
+ * Converts report value into the stored value.
+ *
+ * @param[out] out       the stored value, strings are not copied.
+ * @param[in] value      the report value.
+ * @param[in] precision  the number of decimals of typed double values,
+ *                       -1 for text columns.
+ */
+static void writer_convert_value(
+		sample_log_value_t* out,
+		const sp_report_value_t* value,
+		int precision
+		)
+{
+	switch (value->type) {
+	case SP_REPORT_VALUE_INT:
+		out->tag = SAMPLE_LOG_VALUE_INT;
+		out->i = value->i;
+		return;
+	case SP_REPORT_VALUE_DOUBLE:
+		out->tag = SAMPLE_LOG_VALUE_DOUBLE;
+		out->d = value->d;
+		if (precision >= 0 && isfinite(value->d)) {
+			/* store the digits as printed, so the value is rounded the
+			 * same way in the direct and the replayed output */
+			char text[SP_REPORT_VALUE_BUFFER_SIZE];
+			sp_report_format_t format = {.precision = precision};
+			sp_report_format_value(text, value, &format);
+			/* the value must be exactly representable after scaling back */
+			if (parse_decimal(text, &out->i, &out->precision) && out->precision == precision &&
+					out->i < 1000000000000000ll && out->i > -1000000000000000ll) {
+				out->tag = SAMPLE_LOG_VALUE_DECIMAL;
+			}
+		}
+		return;
+	case SP_REPORT_VALUE_STRING:
+		if (precision == -1 && parse_decimal(value->s, &out->i, &out->precision)) {
+			out->tag = out->precision ? SAMPLE_LOG_VALUE_DECIMAL : SAMPLE_LOG_VALUE_INT;
+			return;
+		}
+		out->tag = SAMPLE_LOG_VALUE_STRING;
+		out->s = (char*)value->s;
+		return;
+	default:
+		out->tag = SAMPLE_LOG_VALUE_NA;
+	}
+}
+
+/**
+ * Encodes the value change and stores the new value as the base for
+ * the next change.
+ *
+ * @param[in] self    the log writer.
+ * @param[in] base    the previous value.
+ * @param[in] value   the new value.
+ * @return            0 for success.
+ */
+static int writer_put_value(
+		sample_log_writer_t* self,
+		sample_log_value_t* base,
+		const sample_log_value_t* value
+		)
+{
+	sample_log_buffer_t* out = &self->changes;
+	int rc;
+
+	if ( (rc = buffer_put_u8(out, value->tag)) != 0) return rc;
+	switch (value->tag) {
+	case SAMPLE_LOG_VALUE_INT: {
+		uint64_t previous = base->tag == SAMPLE_LOG_VALUE_INT ? base->i : 0;
+		if ( (rc = buffer_put_svarint(out, (int64_t)((uint64_t)value->i - previous))) != 0) return rc;
+		base->i = value->i;
+		break;
+	}
+	case SAMPLE_LOG_VALUE_DECIMAL: {
+		uint64_t previous = base->tag == SAMPLE_LOG_VALUE_DECIMAL && base->precision == value->precision ? base->i : 0;
+		if ( (rc = buffer_put_u8(out, value->precision)) != 0) return rc;
+		if ( (rc = buffer_put_svarint(out, (int64_t)((uint64_t)value->i - previous))) != 0) return rc;
+		base->i = value->i;
+		base->precision = value->precision;
+		break;
+	}
+	case SAMPLE_LOG_VALUE_DOUBLE:
+		if ( (rc = buffer_put(out, &value->d, sizeof(double))) != 0) return rc;
+		base->d = value->d;
+		break;
+	case SAMPLE_LOG_VALUE_STRING: {
+		int len = strlen(value->s);
+		if ( (rc = buffer_put_string(out, value->s, len)) != 0) return rc;
+		if ( (rc = value_set_string(base, value->s, len)) != 0) return rc;
+		break;
+	}
+	}
+	base->tag = value->tag;
+	return 0;
+}
+
+/**
+ * Checks if the value is the same as the previous value.
+ */
+static bool value_equals(
+		const sample_log_value_t* base,
+		const sample_log_value_t* value
+		)
+{
+	if (base->tag != value->tag) return false;
+	switch (value->tag) {
+	case SAMPLE_LOG_VALUE_INT:
+		return base->i == value->i;
+	case SAMPLE_LOG_VALUE_DECIMAL:
+		return base->i == value->i && base->precision == value->precision;
+	case SAMPLE_LOG_VALUE_DOUBLE:
+		return !memcmp(&base->d, &value->d, sizeof(double));
+	case SAMPLE_LOG_VALUE_STRING:
+		return !strcmp(base->s, value->s);
+	}
+	return true;
+}
+
+/**
+ * Reads the next record.
+ *
+ * The run headers between the records are skipped.
+ * @param[in] self    the log reader.
+ * @param[out] type   the record type.
+ * @return            1 if the record was read, 0 at the end of log or
+ *                    negative error code.
+ */
+static int reader_get_record(
+		sample_log_reader_t* self,
+		int* type
+		)
+{
+	int c;
+	while ( (c = getc(self->fp)) == SAMPLE_LOG_MAGIC[0]) {
+		char magic[RUN_HEADER_SIZE - 1];
+		if (fread(magic, 1, sizeof(magic), self->fp) != sizeof(magic)) return 0;
+		if (memcmp(magic, SAMPLE_LOG_MAGIC + 1, 3)) return -EINVAL;
+		if (magic[3] != SAMPLE_LOG_VERSION) return -ENOTSUP;
+	}
+	if (c == EOF) return 0;
+	*type = c;
+
+	uint64_t size = 0;
+	int shift = 0;
+	do {
+		/* the log of an interrupted run can end in the middle of record */
+		if ( (c = getc(self->fp)) == EOF) return 0;
+		if (shift > 28) return -EINVAL;
+		size |= (uint64_t)(c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	if (size > (uint64_t)self->size) return -EINVAL;
+	self->record.size = 0;
+	if (!buffer_reserve(&self->record, size)) return -ENOMEM;
+	if (fread(self->record.data, 1, size, self->fp) != size) return 0;
+	return 1;
+}
+
+/**
+ * Frees the schema.
+ */
+static void reader_free_schema(
+		sample_log_reader_t* self
+		)
+{
+	values_resize(&self->values, self->schema.column_count, 0);
+	report_schema_free(&self->schema);
+	self->is_synced = false;
+	self->is_schema_pending = false;
+}
+
+/**
+ * Parses the schema record.
+ *
+ * @param[in] self    the log reader.
+ * @return            0 for success.
+ */
+static int reader_parse_schema(
+		sample_log_reader_t* self
+		)
+{
+	report_schema_t schema;
+	int rc;
+
+	reader_free_schema(self);
+	if ( (rc = report_schema_decode(&schema, self->record.data, self->record.size)) != 0) return rc;
+	/* the column count tells the size of the value array, so the schema
+	 * is set only when the array exists */
+	if ( (rc = values_resize(&self->values, 0, schema.column_count)) != 0) {
+		report_schema_free(&schema);
+		return rc;
+	}
+	self->schema = schema;
+	return 0;
+}
+
+/**
+ * Parses the keyframe or sample record.
+ *
+ * @param[in] self         the log reader.
+ * @param[in] is_keyframe  true for keyframes.
+ * @return                 0 for success.
+ */
+static int reader_parse_sample(
+		sample_log_reader_t* self,
+		bool is_keyframe
+		)
+{
+	cursor_t cursor = {.ptr = self->record.data, .end = self->record.data + self->record.size};
+	int column = -1, rc;
+	uint64_t i, count;
+
+	if (is_keyframe) {
+		self->time = cursor_get_varint(&cursor);
+		values_reset(self->values, self->schema.column_count);
+	}
+	else {
+		self->time += cursor_get_svarint(&cursor);
+	}
+	count = cursor_get_varint(&cursor);
+	for (i = 0; i < count && !cursor.is_truncated; i++) {
+		uint64_t skip = cursor_get_varint(&cursor);
+		if (skip >= (uint64_t)(self->schema.column_count - column - 1)) return -EINVAL;
+		column += skip + 1;
+
+		sample_log_value_t* value = &self->values[column];
+		int tag = cursor_get_u8(&cursor);
+		switch (tag) {
+		case SAMPLE_LOG_VALUE_NA:
+			break;
+		case SAMPLE_LOG_VALUE_INT: {
+			uint64_t previous = value->tag == SAMPLE_LOG_VALUE_INT ? value->i : 0;
+			value->i = (int64_t)(previous + (uint64_t)cursor_get_svarint(&cursor));
+			break;
+		}
+		case SAMPLE_LOG_VALUE_DECIMAL: {
+			int precision = cursor_get_u8(&cursor);
+			if (precision > MAX_DIGITS) return -EINVAL;
+			uint64_t previous = value->tag == SAMPLE_LOG_VALUE_DECIMAL && value->precision == precision ? value->i : 0;
+			value->i = (int64_t)(previous + (uint64_t)cursor_get_svarint(&cursor));
+			value->precision = precision;
+			break;
+		}
+		case SAMPLE_LOG_VALUE_DOUBLE: {
+			const unsigned char* data = cursor_get_data(&cursor, sizeof(double));
+			if (data) memcpy(&value->d, data, sizeof(double));
+			break;
+		}
+		case SAMPLE_LOG_VALUE_STRING: {
+			uint64_t len = cursor_get_varint(&cursor);
+			const unsigned char* data = cursor_get_data(&cursor, len);
+			if (data && (rc = value_set_string(value, (const char*)data, len)) != 0) return rc;
+			break;
+		}
+		default:
+			return -EINVAL;
+		}
+		value->tag = tag;
+	}
+	return cursor.is_truncated ? -EINVAL : 0;
+}
+
+/**
+ * Loads the keyframe indices of the logging runs.
+ *
+ * The runs are followed backwards from the end of log as long as they
+ * end with the index trailer.
+ * @param[in] self    the log reader.
+ * @return            0 for success.
+ */
+static int reader_load_index(
+		sample_log_reader_t* self
+		)
+{
+	long long end = self->size;
+	int type, rc;
+
+	free(self->index);
+	self->index = NULL;
+	self->index_count = 0;
+	while (end >= RUN_HEADER_SIZE + TRAILER_SIZE) {
+		unsigned char trailer[TRAILER_SIZE];
+		uint64_t offset;
+
+		if (fseeko(self->fp, end - TRAILER_SIZE, SEEK_SET) != 0 ||
+				fread(trailer, 1, TRAILER_SIZE, self->fp) != TRAILER_SIZE) break;
+		if (trailer[0] != SAMPLE_LOG_RECORD_TRAILER || trailer[1] != sizeof(offset)) break;
+		memcpy(&offset, trailer + 2, sizeof(offset));
+		if (offset >= (uint64_t)end || fseeko(self->fp, offset, SEEK_SET) != 0) break;
+		if ( (rc = reader_get_record(self, &type)) < 0) return rc;
+		if (rc == 0 || type != SAMPLE_LOG_RECORD_INDEX) break;
+
+		cursor_t cursor = {.ptr = self->record.data, .end = self->record.data + self->record.size};
+		uint64_t run_offset = cursor_get_varint(&cursor);
+		uint64_t i, count = cursor_get_varint(&cursor);
+		if (cursor.is_truncated || run_offset >= (uint64_t)end || count > (uint64_t)self->record.size) break;
+
+		/* the earlier runs are inserted before the later ones */
+		sample_log_index_t* index = malloc((self->index_count + count + 1) * sizeof(sample_log_index_t));
+		if (!index) return -ENOMEM;
+		for (i = 0; i < count; i++) {
+			index[i].time = cursor_get_varint(&cursor);
+			index[i].schema_offset = cursor_get_varint(&cursor);
+			index[i].offset = cursor_get_varint(&cursor);
+		}
+		if (cursor.is_truncated) {
+			free(index);
+			break;
+		}
+		if (self->index_count) memcpy(index + count, self->index, self->index_count * sizeof(sample_log_index_t));
+		free(self->index);
+		self->index = index;
+		self->index_count += count;
+		end = run_offset;
+	}
+	return 0;
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int sample_log_writer_init(
+		sample_log_writer_t* self,
+		FILE* fp
+		)
+{
+	memset(self, 0, sizeof(*self));
+	self->fp = fp;
+	/* the index can be used only if the log can be seeked */
+	self->offset = fseeko(fp, 0, SEEK_END) == 0 ? ftello(fp) : -1;
+	self->run_offset = self->offset;
+
+	char header[RUN_HEADER_SIZE];
+	memcpy(header, SAMPLE_LOG_MAGIC, 4);
+	header[4] = SAMPLE_LOG_VERSION;
+	if (fwrite(header, 1, sizeof(header), fp) != sizeof(header)) return -EIO;
+	if (self->offset != -1) self->offset += sizeof(header);
+	return 0;
+}
+
+
+int sample_log_writer_add(
+		sample_log_writer_t* self,
+		sp_report_header_t* root,
+		const struct timespec* time
+		)
+{
+	int count = sp_report_get_column_count(root);
+	int i, changed = 0, skip = 0, rc;
+
+	if (count < 0) return count;
+
+	unsigned version = sp_report_get_layout_version(root);
+	if (!self->has_schema || version != self->layout_version) {
+		if ( (rc = writer_put_schema(self, root, count)) != 0) return rc;
+		self->has_schema = true;
+		self->layout_version = version;
+		self->keyframe_countdown = 0;
+	}
+
+	int64_t sample_time = (int64_t)time->tv_sec * 1000000 + time->tv_nsec / 1000;
+	int type = SAMPLE_LOG_RECORD_SAMPLE;
+	self->record.size = 0;
+	if (!self->keyframe_countdown) {
+		type = SAMPLE_LOG_RECORD_KEYFRAME;
+		if ( (rc = buffer_put_varint(&self->record, sample_time)) != 0) return rc;
+		values_reset(self->values, self->value_count);
+		if (self->offset != -1) {
+			if (self->index_count == self->index_capacity) {
+				int capacity = self->index_capacity ? self->index_capacity * 2 : 64;
+				sample_log_index_t* index = realloc(self->index, capacity * sizeof(sample_log_index_t));
+				if (!index) return -ENOMEM;
+				self->index = index;
+				self->index_capacity = capacity;
+			}
+			sample_log_index_t* entry = &self->index[self->index_count++];
+			entry->time = sample_time;
+			entry->schema_offset = self->schema_offset;
+			entry->offset = self->offset;
+		}
+		self->keyframe_countdown = SAMPLE_LOG_KEYFRAME_INTERVAL;
+	}
+	else {
+		if ( (rc = buffer_put_svarint(&self->record, sample_time - self->time)) != 0) return rc;
+	}
+	self->keyframe_countdown--;
+	self->time = sample_time;
+
+	self->changes.size = 0;
+	for (i = 0; i < count; i++) {
+		char buffer[SP_REPORT_VALUE_BUFFER_SIZE];
+		sp_report_value_t report_value;
+		sample_log_value_t value;
+
+		if (sp_report_get_column_value(root, i, &report_value, buffer) != 0) report_value.type = SP_REPORT_VALUE_NA;
+		writer_convert_value(&value, &report_value, self->precisions[i]);
+		if (value_equals(&self->values[i], &value)) {
+			skip++;
+			continue;
+		}
+		if ( (rc = buffer_put_varint(&self->changes, skip)) != 0) return rc;
+		if ( (rc = writer_put_value(self, &self->values[i], &value)) != 0) return rc;
+		skip = 0;
+		changed++;
+	}
+	if ( (rc = buffer_put_varint(&self->record, changed)) != 0) return rc;
+	if ( (rc = buffer_put(&self->record, self->changes.data, self->changes.size)) != 0) return rc;
+	return writer_put_record(self, type, &self->record);
+}
+
+
+int sample_log_writer_close(
+		sample_log_writer_t* self
+		)
+{
+	int i, rc = 0;
+
+	if (self->offset != -1 && self->index_count) {
+		uint64_t offset = self->offset;
+		self->record.size = 0;
+		if ( (rc = buffer_put_varint(&self->record, self->run_offset)) != 0) goto cleanup;
+		if ( (rc = buffer_put_varint(&self->record, self->index_count)) != 0) goto cleanup;
+		for (i = 0; i < self->index_count; i++) {
+			if ( (rc = buffer_put_varint(&self->record, self->index[i].time)) != 0) goto cleanup;
+			if ( (rc = buffer_put_varint(&self->record, self->index[i].schema_offset)) != 0) goto cleanup;
+			if ( (rc = buffer_put_varint(&self->record, self->index[i].offset)) != 0) goto cleanup;
+		}
+		if ( (rc = writer_put_record(self, SAMPLE_LOG_RECORD_INDEX, &self->record)) != 0) goto cleanup;
+		self->record.size = 0;
+		if ( (rc = buffer_put(&self->record, &offset, sizeof(offset))) != 0) goto cleanup;
+		if ( (rc = writer_put_record(self, SAMPLE_LOG_RECORD_TRAILER, &self->record)) != 0) goto cleanup;
+	}
+	if (fflush(self->fp) != 0) rc = -EIO;
+
+cleanup:
+	values_resize(&self->values, self->value_count, 0);
+	free(self->precisions);
+	free(self->index);
+	free(self->record.data);
+	free(self->changes.data);
+	memset(self, 0, sizeof(*self));
+	return rc;
+}
+
+
+int sample_log_reader_open(
+		sample_log_reader_t* self,
+		const char* path
+		)
+{
+	char header[RUN_HEADER_SIZE];
+
+	memset(self, 0, sizeof(*self));
+	if ( (self->fp = fopen(path, "rb")) == NULL) return -errno;
+	if (fread(header, 1, sizeof(header), self->fp) != sizeof(header) ||
+			memcmp(header, SAMPLE_LOG_MAGIC, 4)) {
+		sample_log_reader_close(self);
+		return -EINVAL;
+	}
+	if (header[4] != SAMPLE_LOG_VERSION) {
+		sample_log_reader_close(self);
+		return -ENOTSUP;
+	}
+	if (fseeko(self->fp, 0, SEEK_END) != 0 || (self->size = ftello(self->fp)) == -1 ||
+			fseeko(self->fp, 0, SEEK_SET) != 0) {
+		int rc = -errno;
+		sample_log_reader_close(self);
+		return rc;
+	}
+	return 0;
+}
+
+
+int sample_log_reader_seek(
+		sample_log_reader_t* self,
+		int64_t time
+		)
+{
+	int i, type, rc;
+
+	if ( (rc = reader_load_index(self)) != 0) return rc;
+
+	/* find the last keyframe before the time */
+	sample_log_index_t* entry = NULL;
+	for (i = 0; i < self->index_count && self->index[i].time <= time; i++) {
+		entry = &self->index[i];
+	}
+	reader_free_schema(self);
+	if (!entry) {
+		return fseeko(self->fp, 0, SEEK_SET) == 0 ? 0 : -errno;
+	}
+	if (fseeko(self->fp, entry->schema_offset, SEEK_SET) != 0) return -errno;
+	if ( (rc = reader_get_record(self, &type)) < 0) return rc;
+	if (rc == 0 || type != SAMPLE_LOG_RECORD_SCHEMA) return -EINVAL;
+	if ( (rc = reader_parse_schema(self)) != 0) return rc;
+	self->is_schema_pending = true;
+	return fseeko(self->fp, entry->offset, SEEK_SET) == 0 ? 0 : -errno;
+}
+
+
+int sample_log_reader_next(
+		sample_log_reader_t* self
+		)
+{
+	int type, rc;
+
+	if (self->is_schema_pending) {
+		self->is_schema_pending = false;
+		return SAMPLE_LOG_SCHEMA;
+	}
+	while ( (rc = reader_get_record(self, &type)) > 0) {
+		switch (type) {
+		case SAMPLE_LOG_RECORD_SCHEMA:
+			if ( (rc = reader_parse_schema(self)) != 0) return rc;
+			return SAMPLE_LOG_SCHEMA;
+
+		case SAMPLE_LOG_RECORD_KEYFRAME:
+			if (!self->schema.nodes) break;
+			if ( (rc = reader_parse_sample(self, true)) != 0) return rc;
+			self->is_synced = true;
+			return SAMPLE_LOG_SAMPLE;
+
+		case SAMPLE_LOG_RECORD_SAMPLE:
+			/* the samples can be decoded only after a keyframe */
+			if (!self->is_synced) break;
+			if ( (rc = reader_parse_sample(self, false)) != 0) return rc;
+			return SAMPLE_LOG_SAMPLE;
+
+		default:
+			/* index, trailer and unknown records */
+			break;
+		}
+	}
+	return rc;
+}
+
+
+void sample_log_reader_get_value(
+		sample_log_reader_t* self,
+		int index,
+		sp_report_value_t* value,
+		char* buffer
+		)
+{
+	const report_schema_node_t* node = &self->schema.nodes[self->schema.columns[index]];
+	const sample_log_value_t* stored = &self->values[index];
+
+	value->type = SP_REPORT_VALUE_NA;
+	if (node->flags & REPORT_SCHEMA_NODE_TYPED) {
+		switch (stored->tag) {
+		case SAMPLE_LOG_VALUE_INT:
+			value->type = SP_REPORT_VALUE_INT;
+			value->i = stored->i;
+			break;
+		case SAMPLE_LOG_VALUE_DECIMAL:
+			value->type = SP_REPORT_VALUE_DOUBLE;
+			value->d = (double)stored->i / pow10_table[stored->precision];
+			break;
+		case SAMPLE_LOG_VALUE_DOUBLE:
+			value->type = SP_REPORT_VALUE_DOUBLE;
+			value->d = stored->d;
+			break;
+		case SAMPLE_LOG_VALUE_STRING:
+			value->type = SP_REPORT_VALUE_STRING;
+			value->s = stored->s;
+			break;
+		}
+		return;
+	}
+
+	/* text columns are returned as the original text */
+	switch (stored->tag) {
+	case SAMPLE_LOG_VALUE_INT:
+	case SAMPLE_LOG_VALUE_DECIMAL:
+		format_decimal(buffer, SP_REPORT_VALUE_BUFFER_SIZE, stored->i,
+				stored->tag == SAMPLE_LOG_VALUE_DECIMAL ? stored->precision : 0);
+		break;
+	case SAMPLE_LOG_VALUE_DOUBLE:
+		snprintf(buffer, SP_REPORT_VALUE_BUFFER_SIZE, "%g", stored->d);
+		break;
+	case SAMPLE_LOG_VALUE_STRING:
+		value->type = SP_REPORT_VALUE_STRING;
+		value->s = stored->s;
+		return;
+	default:
+		return;
+	}
+	value->type = SP_REPORT_VALUE_STRING;
+	value->s = buffer;
+}
+
+
+void sample_log_reader_close(
+		sample_log_reader_t* self
+		)
+{
+	reader_free_schema(self);
+	if (self->fp) fclose(self->fp);
+	free(self->index);
+	free(self->record.data);
+	memset(self, 0, sizeof(*self));
+}
@@ -0,0 +1,295 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file sample_log.h
+ * Compact report sample log.
+ *
+ * The log stores the report header structure as a self describing schema
+ * and every sample as the changes from the previous sample. Numbers are
+ * stored as zigzag varint encoded deltas, so a value which doesn't change
+ * takes no space at all and a slowly changing value takes a byte or two.
+ * Every SAMPLE_LOG_KEYFRAME_INTERVAL samples a keyframe, which doesn't
+ * depend on the previous samples, is written. When the log is closed an
+ * index of the keyframes is appended, so the reader can seek to the
+ * start of a time range without decoding the log before it.
+ *
+ * The format (u64 in host byte order, varint is unsigned LEB128, svarint
+ * is zigzag encoded varint, string is varint length and the text):
+ *   run header, at the start of every logging run:
+ *     char[4]  magic "SPLG"
+ *     u8       format version (1)
+ *   records:
+ *     u8       record type
+ *     varint   payload length
+ *   schema payload, applies to the following samples:
+ *     the report header structure, see report_schema.h
+ *   keyframe payload:
+ *     varint   sample time, microseconds since the epoch
+ *     followed by the changed values from all values being n/a
+ *   sample payload:
+ *     svarint  sample time change from the previous sample
+ *     followed by the changed values from the previous sample:
+ *     varint   number of changed data columns, followed by the values:
+ *     varint   number of unchanged columns since the previous change
+ *     u8       value tag, followed by the value:
+ *              n/a: nothing
+ *              integer: svarint change from the previous integer value
+ *              decimal: u8 number of decimals and svarint change from the
+ *                       previous decimal value with the same number of
+ *                       decimals, the value is stored multiplied by
+ *                       10^decimals
+ *              double: 8 byte double
+ *              string: string
+ *   index payload:
+ *     varint   run header offset
+ *     varint   number of keyframes, followed by the keyframes:
+ *     varint   keyframe time, microseconds since the epoch
+ *     varint   offset of the schema record of the keyframe
+ *     varint   keyframe record offset
+ *   trailer payload, the last record of the run:
+ *     u64      index record offset
+ *
+ * Typed double values are stored with the number of decimals of their
+ * format, so the replayed values are printed exactly as the original
+ * ones. Numeric text column values are stored as integers and decimals
+ * with the same digits as in the text.
+ */
+#ifndef SAMPLE_LOG_H
+#define SAMPLE_LOG_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sp_report.h"
+#include "report_schema.h"
+
+#define SAMPLE_LOG_MAGIC               "SPLG"
+#define SAMPLE_LOG_VERSION             1
+
+/* the number of samples between keyframes */
+#define SAMPLE_LOG_KEYFRAME_INTERVAL   64
+
+/* the record types */
+#define SAMPLE_LOG_RECORD_SCHEMA       1
+#define SAMPLE_LOG_RECORD_KEYFRAME     2
+#define SAMPLE_LOG_RECORD_SAMPLE       3
+#define SAMPLE_LOG_RECORD_INDEX        4
+#define SAMPLE_LOG_RECORD_TRAILER      5
+
+/* the value tags */
+#define SAMPLE_LOG_VALUE_NA            0
+#define SAMPLE_LOG_VALUE_INT           1
+#define SAMPLE_LOG_VALUE_DECIMAL       2
+#define SAMPLE_LOG_VALUE_DOUBLE        3
+#define SAMPLE_LOG_VALUE_STRING        4
+
+/* sample_log_reader_next() results */
+#define SAMPLE_LOG_SCHEMA              1
+#define SAMPLE_LOG_SAMPLE              2
+
+/**
+ * The data column value, the base for the next value change.
+ */
+typedef struct sample_log_value_t {
+	int tag;
+	/* the number of decimals of decimal values */
+	int precision;
+	/* the integer or the decimal value multiplied by 10^precision */
+	int64_t i;
+	double d;
+	char* s;
+	int s_capacity;
+} sample_log_value_t;
+
+/**
+ * The record payload buffer.
+ */
+typedef struct sample_log_buffer_t {
+	unsigned char* data;
+	int size;
+	int capacity;
+} sample_log_buffer_t;
+
+/**
+ * The keyframe index entry.
+ */
+typedef struct sample_log_index_t {
+	int64_t time;
+	long long schema_offset;
+	long long offset;
+} sample_log_index_t;
+
+/**
+ * The log writer.
+ */
+typedef struct sample_log_writer_t {
+	FILE* fp;
+	/* the current file offset, -1 if the file is not seekable */
+	long long offset;
+	/* the offsets of the run header and the last schema record */
+	long long run_offset;
+	long long schema_offset;
+
+	/* the report layout version of the last schema */
+	unsigned layout_version;
+	bool has_schema;
+
+	/* the previous sample values and time */
+	sample_log_value_t* values;
+	int value_count;
+	int64_t time;
+	/* the number of decimals stored for the data columns, -1 for
+	 * text columns */
+	int* precisions;
+	/* samples left until the next keyframe, 0 for keyframe */
+	int keyframe_countdown;
+
+	/* the keyframe index */
+	sample_log_index_t* index;
+	int index_count;
+	int index_capacity;
+
+	/* the record payload and the changed values of a sample */
+	sample_log_buffer_t record;
+	sample_log_buffer_t changes;
+} sample_log_writer_t;
+
+/**
+ * The log reader.
+ */
+typedef struct sample_log_reader_t {
+	FILE* fp;
+	long long size;
+
+	/* the current schema */
+	report_schema_t schema;
+
+	/* the current sample values and time */
+	sample_log_value_t* values;
+	int64_t time;
+	/* a keyframe has been read after the schema */
+	bool is_synced;
+	/* the schema was read when seeking and is not yet reported */
+	bool is_schema_pending;
+
+	/* the keyframe index of the runs ending with index */
+	sample_log_index_t* index;
+	int index_count;
+
+	sample_log_buffer_t record;
+} sample_log_reader_t;
+
+
+/**
+ * Initializes the log writer and writes the run header.
+ *
+ * @param[in] self   the log writer.
+ * @param[in] fp     the output file.
+ * @return           0 for success.
+ */
+int sample_log_writer_init(
+		sample_log_writer_t* self,
+		FILE* fp
+		);
+
+/**
+ * Writes the current report column values.
+ *
+ * The schema is written first if the report columns have changed.
+ * @param[in] self   the log writer.
+ * @param[in] root   the report root header.
+ * @param[in] time   the sample time.
+ * @return           0 for success.
+ */
+int sample_log_writer_add(
+		sample_log_writer_t* self,
+		sp_report_header_t* root,
+		const struct timespec* time
+		);
+
+/**
+ * Writes the keyframe index and releases the writer resources.
+ *
+ * The output file is not closed.
+ * @param[in] self   the log writer.
+ * @return           0 for success.
+ */
+int sample_log_writer_close(
+		sample_log_writer_t* self
+		);
+
+/**
+ * Opens a log for reading.
+ *
+ * @param[in] self   the log reader.
+ * @param[in] path   the log file path.
+ * @return           0 for success.
+ */
+int sample_log_reader_open(
+		sample_log_reader_t* self,
+		const char* path
+		);
+
+/**
+ * Moves to the last keyframe before the specified time.
+ *
+ * Without index the log is read from the start.
+ * @param[in] self   the log reader.
+ * @param[in] time   the time, microseconds since the epoch.
+ * @return           0 for success.
+ */
+int sample_log_reader_seek(
+		sample_log_reader_t* self,
+		int64_t time
+		);
+
+/**
+ * Reads the next schema or sample.
+ *
+ * @param[in] self   the log reader.
+ * @return           SAMPLE_LOG_SCHEMA, SAMPLE_LOG_SAMPLE, 0 at the end
+ *                   of log or negative error code.
+ */
+int sample_log_reader_next(
+		sample_log_reader_t* self
+		);
+
+/**
+ * Retrieves a data column value of the current sample.
+ *
+ * The values of text columns are returned as their text.
+ * @param[in] self     the log reader.
+ * @param[in] index    the data column index.
+ * @param[out] value   the value.
+ * @param[out] buffer  the buffer of SP_REPORT_VALUE_BUFFER_SIZE bytes
+ *                     for string values.
+ */
+void sample_log_reader_get_value(
+		sample_log_reader_t* self,
+		int index,
+		sp_report_value_t* value,
+		char* buffer
+		);
+
+/**
+ * Closes the log and releases the reader resources.
+ *
+ * @param[in] self   the log reader.
+ */
+void sample_log_reader_close(
+		sample_log_reader_t* self
+		);
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "sample_timer.h"
+
+/**
+ * Private API
+ */
+
+#define USECS_PER_SEC   1000000LL
+#define NSECS_PER_USEC  1000LL
+
+/**
+ * Converts timespec to microseconds.
+ */
+static long long timespec_usecs(
+		const struct timespec* ts
+		)
+{
+	return ts->tv_sec * USECS_PER_SEC + ts->tv_nsec / NSECS_PER_USEC;
+}
+
+/**
+ * Converts microseconds to timespec.
+ */
+static void usecs_timespec(
+		struct timespec* ts,
+		long long usecs
+		)
+{
+	ts->tv_sec = usecs / USECS_PER_SEC;
+	ts->tv_nsec = (usecs % USECS_PER_SEC) * NSECS_PER_USEC;
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int sample_timer_init(
+		sample_timer_t* self,
+		unsigned long interval
+		)
+{
+	struct itimerspec spec;
+	struct timespec now;
+
+	memset(self, 0, sizeof(sample_timer_t));
+	self->interval = interval;
+	self->latency_min = -1;
+
+	self->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (self->fd == -1) return -errno;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	usecs_timespec(&self->start, timespec_usecs(&now) + interval);
+
+	spec.it_value = self->start;
+	usecs_timespec(&spec.it_interval, interval);
+	if (timerfd_settime(self->fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1) {
+		int rc = -errno;
+		close(self->fd);
+		self->fd = -1;
+		return rc;
+	}
+	return 0;
+}
+
+
+int sample_timer_wait(
+		sample_timer_t* self
+		)
+{
+	uint64_t expirations;
+	struct timespec now;
+	long long latency;
+
+	if (read(self->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+		return -1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	self->ticks += expirations;
+	self->schedule_ticks += expirations;
+	self->missed += expirations - 1;
+	self->samples++;
+
+	/* latency from the last elapsed deadline */
+	latency = timespec_usecs(&now) - timespec_usecs(&self->start) -
+			(long long)(self->schedule_ticks - 1) * self->interval;
+	if (latency < 0) latency = 0;
+	if (self->latency_min < 0 || latency < self->latency_min) self->latency_min = latency;
+	if (latency > self->latency_max) self->latency_max = latency;
+	self->latency_sum += latency;
+	self->latency_sum2 += (double)latency * latency;
+
+	return expirations - 1;
+}
+
+
+int sample_timer_set_interval(
+		sample_timer_t* self,
+		unsigned long interval
+		)
+{
+	struct itimerspec spec;
+	long long last = timespec_usecs(&self->start);
+
+	/* before the first deadline the schedule starts from the timer
+	 * initialization */
+	if (self->schedule_ticks) last += (long long)(self->schedule_ticks - 1) * self->interval;
+	else last -= self->interval;
+
+	usecs_timespec(&spec.it_value, last + interval);
+	usecs_timespec(&spec.it_interval, interval);
+	if (timerfd_settime(self->fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1) return -errno;
+
+	self->start = spec.it_value;
+	self->schedule_ticks = 0;
+	self->interval = interval;
+	self->interval_changes++;
+	return 0;
+}
+
+
+void sample_timer_print_summary(
+		const sample_timer_t* self,
+		FILE* fp
+		)
+{
+	double mean = 0, stddev = 0;
+	if (self->samples) {
+		mean = self->latency_sum / self->samples;
+		stddev = self->latency_sum2 / self->samples - mean * mean;
+		stddev = stddev > 0 ? sqrt(stddev) : 0;
+	}
+	fprintf(fp, "Sampling summary: %llu samples at %lu.%03lu s interval, %llu ticks missed\n",
+			self->samples, self->interval / 1000000, self->interval / 1000 % 1000, self->missed);
+	if (self->interval_changes) {
+		fprintf(fp, "Sampling interval changed %llu times\n", self->interval_changes);
+	}
+	if (self->samples) {
+		fprintf(fp, "Sampling jitter: min %lld us, max %lld us, mean %.0f us, stddev %.0f us\n",
+				self->latency_min, self->latency_max, mean, stddev);
+	}
+}
+
+
+void sample_timer_release(
+		sample_timer_t* self
+		)
+{
+	if (self->fd != -1) {
+		close(self->fd);
+		self->fd = -1;
+	}
+}
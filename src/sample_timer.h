@@ -0,0 +1,122 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file sample_timer.h
+ * Drift-free sampling schedule.
+ *
+ * The sampling deadlines are absolute CLOCK_MONOTONIC times
+ * start + n * interval, so neither wall clock changes nor signal
+ * interruptions or slow sampling accumulate drift. Deadlines which
+ * have passed while the previous sample was taken are counted
+ * as missed ticks instead of being sampled late.
+ *
+ * When the interval is changed the schedule is restarted from the last
+ * deadline, so the next deadline is the last one plus the new interval.
+ */
+#ifndef SAMPLE_TIMER_H
+#define SAMPLE_TIMER_H
+
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * The sampling timer.
+ */
+typedef struct sample_timer_t {
+	/* the timerfd descriptor */
+	int fd;
+	/* sampling interval in microseconds */
+	unsigned long interval;
+	/* the first deadline of the current schedule */
+	struct timespec start;
+	/* number of elapsed ticks of the current schedule */
+	unsigned long long schedule_ticks;
+
+	/* number of elapsed ticks (including missed ones) */
+	unsigned long long ticks;
+	/* number of samples taken */
+	unsigned long long samples;
+	/* number of missed ticks */
+	unsigned long long missed;
+	/* number of interval changes */
+	unsigned long long interval_changes;
+
+	/* wakeup latency from the deadline statistics, microseconds */
+	long long latency_min;
+	long long latency_max;
+	double latency_sum;
+	double latency_sum2;
+} sample_timer_t;
+
+
+/**
+ * Initializes and arms the sampling timer.
+ *
+ * The first deadline is set one interval from now.
+ * @param[in] self      the timer.
+ * @param[in] interval  the sampling interval in microseconds.
+ * @return              0 for success.
+ */
+int sample_timer_init(
+		sample_timer_t* self,
+		unsigned long interval
+		);
+
+/**
+ * Waits for the next deadline.
+ *
+ * @param[in] self   the timer.
+ * @return           the number of ticks missed since the last wait or
+ *                   -1 in the case of failure (errno is EINTR if the
+ *                   wait was interrupted by a signal).
+ */
+int sample_timer_wait(
+		sample_timer_t* self
+		);
+
+/**
+ * Changes the sampling interval.
+ *
+ * The next deadline is set to the last elapsed deadline plus the new
+ * interval.
+ * @param[in] self      the timer.
+ * @param[in] interval  the sampling interval in microseconds.
+ * @return              0 for success.
+ */
+int sample_timer_set_interval(
+		sample_timer_t* self,
+		unsigned long interval
+		);
+
+/**
+ * Prints sampling statistics summary.
+ *
+ * @param[in] self   the timer.
+ * @param[in] fp     the output file.
+ */
+void sample_timer_print_summary(
+		const sample_timer_t* self,
+		FILE* fp
+		);
+
+/**
+ * Releases timer resources.
+ *
+ * @param[in] self   the timer.
+ */
+void sample_timer_release(
+		sample_timer_t* self
+		);
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "self_profile.h"
+
+/**
+ * Private API
+ */
+
+/**
+ * Converts timespec to nanoseconds.
+ */
+static uint64_t timespec_to_ns(
+		const struct timespec* ts
+		)
+{
+	return (uint64_t)ts->tv_sec * 1000000000ull + ts->tv_nsec;
+}
+
+/**
+ * Converts timeval to microseconds.
+ */
+static unsigned long long timeval_to_us(
+		const struct timeval* tv
+		)
+{
+	return (unsigned long long)tv->tv_sec * 1000000ull + tv->tv_usec;
+}
+
+/**
+ * Reads the current and peak resident set size of the process.
+ *
+ * Both are read from the same source, so they are comparable.
+ * @param[out] rss   the resident set size in kilobytes, -1 if not available.
+ * @param[out] peak  the peak resident set size in kilobytes, -1 if not
+ *                   available.
+ */
+static void read_rss(
+		long* rss,
+		long* peak
+		)
+{
+	char line[256];
+	*rss = -1;
+	*peak = -1;
+	FILE* fp = fopen("/proc/self/status", "r");
+	if (!fp) return;
+	while (fgets(line, sizeof(line), fp)) {
+		if (!strncmp(line, "VmRSS:", 6)) *rss = strtol(line + 6, NULL, 10);
+		else if (!strncmp(line, "VmHWM:", 6)) *peak = strtol(line + 6, NULL, 10);
+	}
+	fclose(fp);
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int self_profile_init(
+		self_profile_t* self,
+		const char* const* names,
+		int count
+		)
+{
+	int i;
+	memset(self, 0, sizeof(*self));
+	if ( (self->phases = calloc(count, sizeof(self_profile_phase_t))) == NULL) return -ENOMEM;
+	for (i = 0; i < count; i++) {
+		self->phases[i].name = names[i];
+		self->phases[i].min = UINT64_MAX;
+	}
+	self->phase_count = count;
+	self->start = self_profile_now();
+	return 0;
+}
+
+
+uint64_t self_profile_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return timespec_to_ns(&ts);
+}
+
+
+uint64_t self_profile_cpu_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return timespec_to_ns(&ts);
+}
+
+
+void self_profile_add(
+		self_profile_t* self,
+		int phase,
+		uint64_t duration
+		)
+{
+	self_profile_phase_t* data = &self->phases[phase];
+	data->count++;
+	data->sum += duration;
+	if (duration < data->min) data->min = duration;
+	if (duration > data->max) data->max = duration;
+
+	/* the bucket is the index of the highest set bit of microseconds */
+	uint64_t us = duration / 1000;
+	int bucket = us ? 63 - __builtin_clzll(us) : 0;
+	if (bucket >= SELF_PROFILE_BUCKETS) bucket = SELF_PROFILE_BUCKETS - 1;
+	data->buckets[bucket]++;
+}
+
+
+void self_profile_print(
+		const self_profile_t* self,
+		FILE* fp
+		)
+{
+	struct rusage usage;
+	double elapsed = (self_profile_now() - self->start) / 1e9;
+	long rss, peak;
+	int i, j;
+
+	getrusage(RUSAGE_SELF, &usage);
+	read_rss(&rss, &peak);
+	unsigned long long cpu_user = timeval_to_us(&usage.ru_utime);
+	unsigned long long cpu_system = timeval_to_us(&usage.ru_stime);
+	fprintf(fp, "Self profile: %.3f s, CPU time %.3f s user, %.3f s system (%.2f%%), RSS %ld kB, peak %ld kB\n",
+			elapsed, cpu_user / 1e6, cpu_system / 1e6,
+			elapsed > 0 ? (cpu_user + cpu_system) / 1e4 / elapsed : 0.0, rss, peak);
+	fprintf(fp, "%-12s %10s %12s %10s %10s %10s\n", "phase:", "count:", "total ms:", "mean us:", "min us:", "max us:");
+	for (i = 0; i < self->phase_count; i++) {
+		const self_profile_phase_t* data = &self->phases[i];
+		if (!data->count) continue;
+		fprintf(fp, "%-12s %10llu %12.3f %10.1f %10.1f %10.1f\n", data->name, data->count,
+				data->sum / 1e6, data->sum / 1e3 / data->count, data->min / 1e3, data->max / 1e3);
+		fprintf(fp, "%12s", "us:");
+		for (j = 0; j < SELF_PROFILE_BUCKETS; j++) {
+			if (!data->buckets[j]) continue;
+			if (j == SELF_PROFILE_BUCKETS - 1) fprintf(fp, " >=%llu:%llu", 1ull << j, data->buckets[j]);
+			else fprintf(fp, " <%llu:%llu", 2ull << j, data->buckets[j]);
+		}
+		fputc('\n', fp);
+	}
+}
+
+
+void self_profile_free(
+		self_profile_t* self
+		)
+{
+	free(self->phases);
+	memset(self, 0, sizeof(*self));
+}
@@ -0,0 +1,119 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file self_profile.h
+ * Duration histograms of the monitor's own work phases.
+ *
+ * Every phase has a histogram of power of two microsecond buckets, so
+ * recording a duration is a few instructions and the histograms have
+ * a fixed size regardless of the run length. Bucket n counts durations
+ * of at least 2^n and less than 2^(n+1) microseconds, except bucket 0,
+ * which counts also the durations below one microsecond.
+ */
+#ifndef SELF_PROFILE_H
+#define SELF_PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* the number of histogram buckets, the last one counts also all the
+ * longer durations */
+#define SELF_PROFILE_BUCKETS       24
+
+/**
+ * The phase duration histogram.
+ */
+typedef struct self_profile_phase_t {
+	const char* name;
+	unsigned long long count;
+	/* the durations in nanoseconds */
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+	unsigned long long buckets[SELF_PROFILE_BUCKETS];
+} self_profile_phase_t;
+
+/**
+ * The self profile.
+ */
+typedef struct self_profile_t {
+	self_profile_phase_t* phases;
+	int phase_count;
+	/* the profiling start time, nanoseconds of CLOCK_MONOTONIC */
+	uint64_t start;
+} self_profile_t;
+
+
+/**
+ * Initializes the self profile.
+ *
+ * @param[out] self   the self profile.
+ * @param[in] names   the phase names, not copied.
+ * @param[in] count   the number of phases.
+ * @return            0 for success.
+ */
+int self_profile_init(
+		self_profile_t* self,
+		const char* const* names,
+		int count
+		);
+
+/**
+ * Retrieves the current time for phase timing.
+ *
+ * @return   the CLOCK_MONOTONIC time in nanoseconds.
+ */
+uint64_t self_profile_now(void);
+
+/**
+ * Retrieves the CPU time used by the process.
+ *
+ * @return   the CLOCK_PROCESS_CPUTIME_ID time in nanoseconds.
+ */
+uint64_t self_profile_cpu_time(void);
+
+/**
+ * Adds a phase duration to the phase histogram.
+ *
+ * @param[in] self       the self profile.
+ * @param[in] phase      the phase index.
+ * @param[in] duration   the duration in nanoseconds.
+ */
+void self_profile_add(
+		self_profile_t* self,
+		int phase,
+		uint64_t duration
+		);
+
+/**
+ * Prints the phase histograms and the process resource usage.
+ *
+ * @param[in] self   the self profile.
+ * @param[in] fp     the output file.
+ */
+void self_profile_print(
+		const self_profile_t* self,
+		FILE* fp
+		);
+
+/**
+ * Releases the self profile resources.
+ *
+ * @param[in] self   the self profile.
+ */
+void self_profile_free(
+		self_profile_t* self
+		);
+
+#endif
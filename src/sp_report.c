@@ -28,6 +28,7 @@
 #include <errno.h>
 #include <string.h>
 #include <stdbool.h>
+#include <unistd.h>
 
 #include "sp_report.h"
 
@@ -48,54 +49,129 @@ typedef void (*table_print_fn)(FILE*, const sp_report_header_t*, int);
 #define BORDER_VLINE     '|'
 
 /**
- * Returns memory location where the reference to new child of the
- * specified header must be stored.
+ * Literal text or data column of the flattened row layout.
+ */
+typedef struct layout_op_t {
+	/* the data column header, NULL for literal text */
+	const sp_report_header_t* header;
+	/* literal text offset and length in the layout text buffer */
+	int offset;
+	int len;
+} layout_op_t;
+
+/**
+ * Data column of the layout with its key path.
+ */
+typedef struct layout_leaf_t {
+	const sp_report_header_t* header;
+	char* path;
+} layout_leaf_t;
+
+/**
+ * The flattened row layout.
+ *
+ * The header tree is flattened once into a sequence of literal texts
+ * (colors, separators, empty fields) and data columns, so printing a data
+ * row does not need to walk the tree. The layout is rebuilt after the
+ * headers have been changed.
  *
- * If header does not have any children, address of its 'child' field
- * is returned. If header already has children, address of the 'next'
- * field of the last child is returned.
- * @param[in] header  the parent header for the new child.
- * @return            memory location where the reference to the new child
- *                    must be stored.
+ * The layout is stored in the report root header and also keeps the
+ * freed headers of the report for reuse.
  */
-static sp_report_header_t** get_new_child_address(
-		sp_report_header_t* header
+struct sp_report_layout_t {
+	/* the headers have been changed after the layout was built */
+	bool is_dirty;
+	/* changed whenever the layout is rebuilt */
+	unsigned version;
+
+	/* the row layout operations */
+	layout_op_t* ops;
+	int op_count;
+	int op_capacity;
+
+	/* the literal texts */
+	char* text;
+	int text_size;
+	int text_capacity;
+
+	/* the data columns and their key paths for machine readable formats */
+	layout_leaf_t* leaves;
+	int leaf_count;
+	int leaf_capacity;
+
+	/* the row buffer, large enough for the longest possible row */
+	char* row;
+	int row_capacity;
+
+	/* the freed headers, linked with the next field */
+	sp_report_header_t* free_headers;
+};
+
+/**
+ * Sets header text, using the embedded buffer if the text fits into it.
+ *
+ * @param[in,out] text   the text field.
+ * @param[in] buffer     the embedded text buffer.
+ * @param[in] size       the embedded text buffer size.
+ * @param[in] value      the new text or NULL.
+ * @return               0 for success.
+ */
+static int header_set_text(
+		char** text,
+		char* buffer,
+		size_t size,
+		const char* value
 		)
 {
-	if (header->child) {
-		sp_report_header_t* child = header->child;
-		while (child->next) {
-			child = child->next;
-		}
-		return &child->next;
-	}
-	else {
-		return &header->child;
+	if (value && value == *text) return 0;
+	if (*text && *text != buffer) free(*text);
+	*text = NULL;
+	if (!value) return 0;
+	if (strlen(value) < size) {
+		*text = strcpy(buffer, value);
+		return 0;
 	}
+	*text = strdup(value);
+	return *text ? 0 : -ENOMEM;
 }
 
 /**
- * Returns memory location where the reference to new sibling of the
- * specified header must be stored.
+ * Returns the root header of the report containing the header.
  *
- * Address of the 'next' field of the last sibling is returned.
- * @param[in] header  the sibling header for the new child.
- * @return            memory location where the reference to the new sibling
- *                    must be stored.
+ * @param[in] header   the header.
+ * @return             the report root header.
  */
-static sp_report_header_t** get_new_sibling_address(
+static sp_report_header_t* header_get_root(
 		sp_report_header_t* header
 		)
 {
-	while (header->next) {
-		header = header->next;
+	while (header->parent) header = header->parent;
+	return header;
+}
+
+/**
+ * Returns the private data of the report containing the header.
+ *
+ * The data is allocated when accessed for the first time.
+ * @param[in] header   the header.
+ * @return             the report data or NULL in the case of failure.
+ */
+static struct sp_report_layout_t* header_get_report_data(
+		sp_report_header_t* header
+		)
+{
+	sp_report_header_t* root = header_get_root(header);
+	if (!root->layout) {
+		root->layout = calloc(1, sizeof(struct sp_report_layout_t));
+		if (root->layout) root->layout->is_dirty = true;
 	}
-	return &header->next;
+	return root->layout;
 }
 
 /**
  * Frees resources associated with the header.
  *
+ * The header is stored for reuse if possible.
  * @param[in] header   the header to free.
  * @return
  */
@@ -104,11 +180,40 @@ static void header_free_item(
 		)
 {
 	if (header) {
-		if (header->title) free(header->title);
-		if (header->color_prefix) free(header->color_prefix);
-		if (header->color_postfix) free(header->color_postfix);
-		free(header);
+		header_set_text(&header->title, header->title_buffer, 0, NULL);
+		header_set_text(&header->key, header->key_buffer, 0, NULL);
+		header_set_text(&header->color_prefix, header->color_prefix_buffer, 0, NULL);
+		header_set_text(&header->color_postfix, header->color_postfix_buffer, 0, NULL);
+		struct sp_report_layout_t* report = header->parent ? header_get_report_data(header) : NULL;
+		if (report) {
+			header->next = report->free_headers;
+			report->free_headers = header;
+		}
+		else {
+			free(header);
+		}
+	}
+}
+
+/**
+ * Links header as the last child of its parent.
+ *
+ * @param[in] header   the header to link.
+ */
+static void header_link_item(
+		sp_report_header_t* header
+		)
+{
+	sp_report_header_t* parent = header->parent;
+	header->prev = parent->last_child;
+	header->next = NULL;
+	if (parent->last_child) {
+		parent->last_child->next = header;
+	}
+	else {
+		parent->child = header;
 	}
+	parent->last_child = header;
 }
 
 
@@ -116,7 +221,8 @@ static void header_free_item(
  * Creates new header item.
  *
  * This function allocates resources for a new header item and initializes it
- * with the specified values.
+ * with the specified values. The header items freed from the same report
+ * are reused.
  * @param[out] header   the created header.
  * @param[in] parent    the header parent.
  * @param[in] title     the header title.
@@ -136,34 +242,41 @@ static int header_create_item(
 		void* data
 		)
 {
-	sp_report_header_t* item = (sp_report_header_t*)malloc(sizeof(sp_report_header_t));
-	*header = item;
+	struct sp_report_layout_t* report = header_get_report_data(parent);
+	sp_report_header_t* item;
 
-	if (!item) return -ENOMEM;
-	item->size = size ? size : (int)strlen(title) + 1;
-	if (item->size > MAX_COLUMN_SIZE) {
-		return -EINVAL;
-	}
-	if (title) {
-		item->title = strdup(title);
-		if (!item->title) {
-			return -ENOMEM;
-		}
+	if (report && report->free_headers) {
+		item = report->free_headers;
+		report->free_headers = item->next;
 	}
 	else {
-		item->title = NULL;
+		item = (sp_report_header_t*)malloc(sizeof(sp_report_header_t));
 	}
+	*header = item;
+
+	if (!item) return -ENOMEM;
+	item->title = NULL;
+	item->key = NULL;
+	item->color_prefix = NULL;
+	item->color_postfix = NULL;
+	item->layout = NULL;
+	item->value = NULL;
+	memset(&item->format, 0, sizeof(item->format));
 	item->print = print;
 	item->data = data;
 	item->child = NULL;
+	item->last_child = NULL;
 	item->next = NULL;
+	item->prev = NULL;
 	item->parent = parent;
 	item->depth = 0;
 	item->size_print = 0;
-	item->color_prefix = 0;
-	item->color_postfix = 0;
 	item->alignment = alignment;
-	return 0;
+	item->size = size ? size : (int)strlen(title) + 1;
+	if (item->size > MAX_COLUMN_SIZE) {
+		return -EINVAL;
+	}
+	return header_set_text(&item->title, item->title_buffer, sizeof(item->title_buffer), title);
 }
 
 /**
@@ -276,6 +389,7 @@ static void header_print_top(
  * Writes aligned text into the buffer.
  * @param[out] buffer    the output buffer.
  * @param[in] text       the text to write.
+ * @param[in] len        the text length.
  * @param[in] size       the output field size.
  * @param[in] alignment  the text alignment (see sp_report_alignment_t enum).
  * @return
@@ -283,12 +397,12 @@ static void header_print_top(
 static void write_aligned_text(
 		char* buffer,
 		const char* text,
+		int len,
 		int size,
 		int alignment
 		)
 {
 	int pos = 0;
-	int len = strlen(text);
 	memset(buffer, ' ', size);
 	buffer[size] = '\0';
 	if (len <= size) {
@@ -327,42 +441,585 @@ static void header_print_item(
 	/* only print header if it's located at the target depth.
 	 * Otherwise print just empty field of the header's size */
 	if (relative_depth == 0 && header->title) {
-		write_aligned_text(buffer, header->title, header->size_print, header->alignment);
+		write_aligned_text(buffer, header->title, strlen(header->title), header->size_print, header->alignment);
 	}
 	else {
-		write_aligned_text(buffer, "", header->size_print, 0);
+		write_aligned_text(buffer, "", 0, header->size_print, 0);
 	}
 	fputs(buffer, fp);
 }
 
 /**
- * Prints the data described by header.
+ * Appends the header key to the key path.
  *
- * @param[in] fp              the output file.
- * @param[in] header          the header to print.
- * @param[in] relative_depth  -1 header is above the printing target depth(row).
- *                             0 header is at the printing target depth(row).
- *                             1 header is below the printing target depth(row).
- * @return
+ * @param[in,out] path   the key path.
+ * @param[in] len        the key path length.
+ * @param[in] header     the header.
+ * @return               the new key path length.
  */
+static int header_append_key(
+		char* path,
+		int len,
+		const sp_report_header_t* header
+		)
+{
+	const char* key = header->key ? header->key : header->title;
+	bool is_separated = false;
+
+	if (!key) return len;
+	if (len && len < MAX_COLUMN_SIZE - 1) path[len++] = '.';
+	for (; *key && len < MAX_COLUMN_SIZE - 1; key++) {
+		if (header->key || (*key >= 'a' && *key <= 'z') || (*key >= '0' && *key <= '9')) {
+			path[len++] = *key;
+		}
+		else if (*key >= 'A' && *key <= 'Z') {
+			path[len++] = *key - 'A' + 'a';
+		}
+		else {
+			/* replace other character sequences in titles with single underscore */
+			if (!is_separated && len && path[len - 1] != '.') path[len++] = '_';
+			is_separated = true;
+			continue;
+		}
+		is_separated = false;
+	}
+	if (len && path[len - 1] == '_') len--;
+	path[len] = '\0';
+	return len;
+}
 
-static void header_print_data(
+
+/**
+ * Grows array capacity if necessary.
+ *
+ * @param[in,out] array     the array.
+ * @param[in,out] capacity  the array capacity.
+ * @param[in] count         the required number of items.
+ * @param[in] item_size     the item size.
+ * @return                  0 for success.
+ */
+static int layout_reserve(
+		void* array,
+		int* capacity,
+		int count,
+		size_t item_size
+		)
+{
+	if (count <= *capacity) return 0;
+	int new_capacity = *capacity ? *capacity : 16;
+	while (new_capacity < count) new_capacity *= 2;
+	void* items = realloc(*(void**)array, new_capacity * item_size);
+	if (!items) return -ENOMEM;
+	*(void**)array = items;
+	*capacity = new_capacity;
+	return 0;
+}
+
+/**
+ * Appends literal text to the layout.
+ *
+ * Consecutive literal texts are merged into single operation.
+ * @param[in] layout   the layout.
+ * @param[in] text     the text.
+ * @param[in] len      the text length.
+ * @return             0 for success.
+ */
+static int layout_add_text(
+		struct sp_report_layout_t* layout,
+		const char* text,
+		int len
+		)
+{
+	if (!len) return 0;
+	if (layout_reserve(&layout->text, &layout->text_capacity, layout->text_size + len, 1) != 0) return -ENOMEM;
+	memcpy(layout->text + layout->text_size, text, len);
+	layout->text_size += len;
+
+	if (layout->op_count && !layout->ops[layout->op_count - 1].header) {
+		layout->ops[layout->op_count - 1].len += len;
+		return 0;
+	}
+	if (layout_reserve(&layout->ops, &layout->op_capacity, layout->op_count + 1, sizeof(layout_op_t)) != 0) return -ENOMEM;
+	layout_op_t* op = &layout->ops[layout->op_count++];
+	op->header = NULL;
+	op->offset = layout->text_size - len;
+	op->len = len;
+	return 0;
+}
+
+/**
+ * Appends data column to the layout.
+ *
+ * @param[in] layout   the layout.
+ * @param[in] header   the data column header.
+ * @return             0 for success.
+ */
+static int layout_add_column(
+		struct sp_report_layout_t* layout,
+		const sp_report_header_t* header
+		)
+{
+	if (layout_reserve(&layout->ops, &layout->op_capacity, layout->op_count + 1, sizeof(layout_op_t)) != 0) return -ENOMEM;
+	layout_op_t* op = &layout->ops[layout->op_count++];
+	op->header = header;
+	op->offset = 0;
+	op->len = header->size_print;
+	return 0;
+}
+
+/**
+ * Flattens the data row of the header and its next siblings.
+ *
+ * This follows the header_iterate_level() logic for data rows.
+ * @param[in] layout   the layout.
+ * @param[in] header   the header.
+ * @return             0 for success.
+ */
+static int layout_add_level(
+		struct sp_report_layout_t* layout,
+		const sp_report_header_t* header
+		)
+{
+	char buffer[MAX_COLUMN_SIZE];
+	int rc;
+
+	for (; header; header = header->next) {
+		if (header->color_prefix &&
+				(rc = layout_add_text(layout, header->color_prefix, strlen(header->color_prefix))) != 0) return rc;
+		if (header->child) {
+			if ( (rc = layout_add_level(layout, header->child)) != 0) return rc;
+		}
+		else if (header->print || header->value) {
+			if ( (rc = layout_add_column(layout, header)) != 0) return rc;
+		}
+		else {
+			memset(buffer, ' ', header->size_print);
+			if ( (rc = layout_add_text(layout, buffer, header->size_print)) != 0) return rc;
+		}
+		if (header->color_postfix &&
+				(rc = layout_add_text(layout, header->color_postfix, strlen(header->color_postfix))) != 0) return rc;
+		/* the top level headers are flattened by the caller */
+		if (!header->parent->parent) break;
+	}
+	return 0;
+}
+
+/**
+ * Collects the data columns and their key paths.
+ *
+ * @param[in] layout   the layout.
+ * @param[in] header   the first header at the current level.
+ * @param[in] path     the key path of the parent header.
+ * @param[in] len      the key path length.
+ * @return             0 for success.
+ */
+static int layout_add_leaves(
+		struct sp_report_layout_t* layout,
+		const sp_report_header_t* header,
+		const char* path,
+		int len
+		)
+{
+	char buffer[MAX_COLUMN_SIZE];
+	int rc;
+
+	for (; header; header = header->next) {
+		memcpy(buffer, path, len + 1);
+		int header_len = header_append_key(buffer, len, header);
+		if (header->child) {
+			if ( (rc = layout_add_leaves(layout, header->child, buffer, header_len)) != 0) return rc;
+		}
+		else if (header->print || header->value) {
+			if (layout_reserve(&layout->leaves, &layout->leaf_capacity, layout->leaf_count + 1, sizeof(layout_leaf_t)) != 0) {
+				return -ENOMEM;
+			}
+			layout_leaf_t* leaf = &layout->leaves[layout->leaf_count];
+			if ( (leaf->path = strdup(buffer)) == NULL) return -ENOMEM;
+			leaf->header = header;
+			layout->leaf_count++;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Clears the layout for rebuilding.
+ *
+ * @param[in] layout   the layout.
+ */
+static void layout_clear(
+		struct sp_report_layout_t* layout
+		)
+{
+	int i;
+	for (i = 0; i < layout->leaf_count; i++) {
+		free(layout->leaves[i].path);
+	}
+	layout->leaf_count = 0;
+	layout->op_count = 0;
+	layout->text_size = 0;
+}
+
+/**
+ * Frees the layout.
+ *
+ * @param[in] layout   the layout.
+ */
+static void layout_free(
+		struct sp_report_layout_t* layout
+		)
+{
+	if (layout) {
+		layout_clear(layout);
+		while (layout->free_headers) {
+			sp_report_header_t* header = layout->free_headers;
+			layout->free_headers = header->next;
+			free(header);
+		}
+		free(layout->ops);
+		free(layout->text);
+		free(layout->leaves);
+		free(layout->row);
+		free(layout);
+	}
+}
+
+/**
+ * Marks the layout of the report containing the header as changed.
+ *
+ * @param[in] header   the changed header.
+ */
+static void header_invalidate_layout(
+		sp_report_header_t* header
+		)
+{
+	header = header_get_root(header);
+	if (header->layout) header->layout->is_dirty = true;
+}
+
+/**
+ * Returns the report layout, (re)building it if necessary.
+ *
+ * @param[in] root   the report root header.
+ * @return           the layout or NULL in the case of failure.
+ */
+static struct sp_report_layout_t* header_get_layout(
+		sp_report_header_t* root
+		)
+{
+	struct sp_report_layout_t* layout = root->layout;
+	sp_report_header_t* header;
+	int size, depth, i;
+
+	if (layout && !layout->is_dirty) return layout;
+	if ( (layout = header_get_report_data(root)) == NULL) return NULL;
+	layout_clear(layout);
+
+	header_update_format(root, &size, &depth);
+	for (header = root->child; header; header = header->next) {
+		if (layout_add_level(layout, header) != 0) return NULL;
+		if (header->next && layout_add_text(layout, " ", 1) != 0) return NULL;
+	}
+	if (layout_add_text(layout, "\n", 1) != 0) return NULL;
+	if (layout_add_leaves(layout, root->child, "", 0) != 0) return NULL;
+
+	/* the column sizes are fixed, so the row length has upper limit */
+	size = 0;
+	for (i = 0; i < layout->op_count; i++) {
+		size += layout->ops[i].len;
+	}
+	/* the last column is terminated with zero before the row end is written */
+	if (layout_reserve(&layout->row, &layout->row_capacity, size + 1, 1) != 0) return NULL;
+
+	/* the versions are unique also when the layout is freed and allocated again */
+	static unsigned version = 0;
+	layout->is_dirty = false;
+	layout->version = ++version;
+	return layout;
+}
+
+/**
+ * Writes the buffer to the output file.
+ *
+ * The stdio buffers are flushed and the data is written with a single
+ * write() call, unless the file has no descriptor or the write is partial.
+ * @param[in] fp      the output file.
+ * @param[in] buffer  the data to write.
+ * @param[in] len     the data length.
+ * @return            0 for success.
+ */
+static int write_buffer(
 		FILE* fp,
+		const char* buffer,
+		int len
+		)
+{
+	int fd = fileno(fp);
+	if (fd == -1) {
+		return fwrite(buffer, 1, len, fp) == (size_t)len ? 0 : -EIO;
+	}
+	if (fflush(fp) != 0) return -errno;
+	while (len) {
+		ssize_t n = write(fd, buffer, len);
+		if (n == -1) {
+			if (errno == EINTR) continue;
+			return -errno;
+		}
+		buffer += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* decimal digit pairs for integer formatting */
+static const char digit_pairs[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+
+/**
+ * Writes unsigned integer in decimal.
+ *
+ * @param[out] buffer   the output buffer.
+ * @param[in] value     the value to write.
+ * @return              the number of written characters.
+ */
+static int format_uint(
+		char* buffer,
+		uint64_t value
+		)
+{
+	char digits[20];
+	char* ptr = digits + sizeof(digits);
+	int len;
+
+	while (value >= 100) {
+		const char* pair = digit_pairs + (value % 100) * 2;
+		value /= 100;
+		*--ptr = pair[1];
+		*--ptr = pair[0];
+	}
+	if (value >= 10) {
+		*--ptr = digit_pairs[value * 2 + 1];
+		*--ptr = digit_pairs[value * 2];
+	}
+	else {
+		*--ptr = '0' + value;
+	}
+	len = digits + sizeof(digits) - ptr;
+	memcpy(buffer, ptr, len);
+	return len;
+}
+
+/**
+ * Writes typed value into the buffer.
+ *
+ * @param[out] buffer   the output buffer of MAX_COLUMN_SIZE bytes.
+ * @param[in] value     the value to write.
+ * @param[in] format    the value format.
+ * @return              the number of written characters, at most
+ *                      MAX_COLUMN_SIZE - 1.
+ */
+static int format_value(
+		char* buffer,
+		const sp_report_value_t* value,
+		const sp_report_format_t* format
+		)
+{
+	static const uint64_t scales[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+	const int max_precision = sizeof(scales) / sizeof(scales[0]) - 1;
+	int len = 0, precision = 0;
+	uint64_t number = 0;
+	bool negative = false;
+
+	switch (value->type) {
+	case SP_REPORT_VALUE_NA:
+		memcpy(buffer, SP_REPORT_NA_TEXT, sizeof(SP_REPORT_NA_TEXT) - 1);
+		return sizeof(SP_REPORT_NA_TEXT) - 1;
+
+	case SP_REPORT_VALUE_STRING:
+		len = strlen(value->s);
+		if (len > MAX_COLUMN_SIZE - 1) len = MAX_COLUMN_SIZE - 1;
+		memcpy(buffer, value->s, len);
+		return len;
+
+	case SP_REPORT_VALUE_INT:
+		negative = value->i < 0;
+		number = negative ? -(uint64_t)value->i : (uint64_t)value->i;
+		break;
+
+	case SP_REPORT_VALUE_DOUBLE: {
+		double d = value->d;
+		precision = format->precision;
+		/* fall back to printf for values the fixed point conversion can't handle */
+		if (precision < 0 || precision > max_precision || d != d || d > 1e12 || d < -1e12) {
+			/* snprintf() returns the untruncated length */
+			len = snprintf(buffer, MAX_COLUMN_SIZE, format->sign ? "%+.*f%s" : "%.*f%s",
+					precision, d, format->suffix ? format->suffix : "");
+			if (len < 0) return 0;
+			return len > MAX_COLUMN_SIZE - 1 ? MAX_COLUMN_SIZE - 1 : len;
+		}
+		negative = d < 0;
+		number = (uint64_t)((negative ? -d : d) * scales[precision] + 0.5);
+		break;
+	}
+	}
+
+	if (negative) {
+		buffer[len++] = '-';
+	}
+	else if (format->sign) {
+		buffer[len++] = '+';
+	}
+	len += format_uint(buffer + len, number / scales[precision]);
+	if (precision) {
+		/* write the decimals with leading zeros */
+		uint64_t decimals = number % scales[precision] + scales[precision];
+		char digits[24];
+		format_uint(digits, decimals);
+		buffer[len++] = '.';
+		memcpy(buffer + len, digits + 1, precision);
+		len += precision;
+	}
+	if (format->suffix) {
+		int suffix_len = strlen(format->suffix);
+		if (suffix_len > MAX_COLUMN_SIZE - 1 - len) suffix_len = MAX_COLUMN_SIZE - 1 - len;
+		memcpy(buffer + len, format->suffix, suffix_len);
+		len += suffix_len;
+	}
+	return len;
+}
+
+/**
+ * Writes the column data into the buffer without padding.
+ *
+ * @param[out] buffer   the output buffer of MAX_COLUMN_SIZE bytes.
+ * @param[in] header    the column header.
+ * @param[out] type     the value type. The values of text columns are
+ *                      reported as double if they look like a number.
+ * @return              the trimmed value.
+ */
+static const char* header_write_value(
+		char* buffer,
 		const sp_report_header_t* header,
-		int relative_depth __attribute__ ((unused))
+		sp_report_value_type_t* type
+		)
+{
+	if (header->value) {
+		/* raw values keep the precision, but not the sign or suffix */
+		sp_report_format_t format = {.precision = header->format.precision};
+		sp_report_value_t value = {.type = SP_REPORT_VALUE_NA};
+		header->value(&value, header->data);
+		buffer[value.type == SP_REPORT_VALUE_NA ? 0 : format_value(buffer, &value, &format)] = '\0';
+		*type = value.type;
+		return buffer;
+	}
+
+	int size = header->print(buffer, MAX_COLUMN_SIZE - 1, header->data);
+	if (size < 0) size = 0;
+	if (size > MAX_COLUMN_SIZE - 1) size = MAX_COLUMN_SIZE - 1;
+	while (size && buffer[size - 1] == ' ') size--;
+	buffer[size] = '\0';
+	while (*buffer == ' ') buffer++;
+
+	*type = SP_REPORT_VALUE_STRING;
+	if (!*buffer) {
+		*type = SP_REPORT_VALUE_NA;
+	}
+	else {
+		/* numbers have no leading '+' and no hexadecimal or special values */
+		const char* number = *buffer == '+' ? buffer + 1 : buffer;
+		if ((*number == '-' || (*number >= '0' && *number <= '9')) &&
+				strspn(number, "0123456789.-+eE") == strlen(number)) {
+			char* end;
+			strtod(number, &end);
+			if (!*end) {
+				*type = SP_REPORT_VALUE_DOUBLE;
+				return number;
+			}
+		}
+	}
+	return buffer;
+}
+
+/**
+ * Prints a string quoted and escaped for CSV or JSON output.
+ *
+ * @param[in] fp      the output file.
+ * @param[in] text    the string to print.
+ * @param[in] json    true for JSON escaping, false for CSV escaping.
+ */
+static void print_quoted(
+		FILE* fp,
+		const char* text,
+		bool json
 		)
 {
-	if (header->print) {
-		char data[MAX_COLUMN_SIZE];
-		char buffer[MAX_COLUMN_SIZE];
-		int size = header->print(data, header->size, header->data);
-		data[size] = '\0';
+	fputc('"', fp);
+	for (; *text; text++) {
+		if (*text == '"') {
+			fputs(json ? "\\\"" : "\"\"", fp);
+		}
+		else if (json && *text == '\\') {
+			fputs("\\\\", fp);
+		}
+		else if (json && (unsigned char)*text < ' ') {
+			fprintf(fp, "\\u%04x", *text);
+		}
+		else {
+			fputc(*text, fp);
+		}
+	}
+	fputc('"', fp);
+}
 
-		write_aligned_text(buffer, data, header->size_print, header->alignment);
-		fputs(buffer, fp);
+/**
+ * Prints a CSV field, quoted if necessary.
+ */
+static void print_csv_field(
+		FILE* fp,
+		const char* text,
+		int index
+		)
+{
+	if (index) fputc(',', fp);
+	if (strpbrk(text, ",\"\n")) {
+		print_quoted(fp, text, false);
 	}
 	else {
-		header_print_item(fp, header, 1);
+		fputs(text, fp);
+	}
+}
+
+/**
+ * Prints a JSON object member.
+ *
+ * @param[in] fp      the output file.
+ * @param[in] path    the member name.
+ * @param[in] value   the member value.
+ * @param[in] type    the member value type.
+ * @param[in] index   the member index.
+ */
+static void print_json_member(
+		FILE* fp,
+		const char* path,
+		const char* value,
+		sp_report_value_type_t type,
+		int index
+		)
+{
+	if (index) fputc(',', fp);
+	print_quoted(fp, path, true);
+	fputc(':', fp);
+	switch (type) {
+	case SP_REPORT_VALUE_NA:
+		fputs("null", fp);
+		break;
+	case SP_REPORT_VALUE_STRING:
+		print_quoted(fp, value, true);
+		break;
+	default:
+		fputs(value, fp);
 	}
 }
 
@@ -378,6 +1035,7 @@ void sp_report_header_free(
 		)
 {
 	if (header) {
+		if (header->parent) header_invalidate_layout(header);
 		sp_report_header_free(header->child);
 		sp_report_header_free(header->next);
 		header_free_item(header);
@@ -385,6 +1043,18 @@ void sp_report_header_free(
 }
 
 
+void sp_report_free(
+		sp_report_header_t* root
+		)
+{
+	sp_report_header_free(root->child);
+	root->child = NULL;
+	root->last_child = NULL;
+	layout_free(root->layout);
+	root->layout = NULL;
+}
+
+
 sp_report_header_t* sp_report_header_add_child(
 		sp_report_header_t* header,
 		const char* title,
@@ -401,7 +1071,27 @@ sp_report_header_t* sp_report_header_add_child(
 		header_free_item(child);
 		return NULL;
 	}
-	*get_new_child_address(header) = child;
+	header_link_item(child);
+	header_invalidate_layout(header);
+	return child;
+}
+
+
+sp_report_header_t* sp_report_header_add_value_child(
+		sp_report_header_t* header,
+		const char* title,
+		int size,
+		int alignment,
+		sp_report_cell_value_fn value,
+		const sp_report_format_t* format,
+		void* data
+		)
+{
+	sp_report_header_t* child = sp_report_header_add_child(header, title, size, alignment, NULL, data);
+	if (child) {
+		child->value = value;
+		if (format) child->format = *format;
+	}
 	return child;
 }
 
@@ -422,7 +1112,8 @@ sp_report_header_t* sp_report_header_add_sibling(
 		header_free_item(sibling);
 		return NULL;
 	}
-	*get_new_sibling_address(header) = sibling;
+	header_link_item(sibling);
+	header_invalidate_layout(header);
 	return sibling;
 }
 
@@ -432,23 +1123,32 @@ int sp_report_header_remove(
 		sp_report_header_t* header
 		)
 {
-	sp_report_header_t* child;
-	if (root->child == header) {
-		root->child = header->next;
-		header->next = NULL;
-		return 0;
+	sp_report_header_t* parent = header->parent;
+	sp_report_header_t* ancestor;
+
+	/* check that the header is linked into the report */
+	for (ancestor = parent; ancestor && ancestor != root; ancestor = ancestor->parent);
+	if (!ancestor) return 1;
+	if ((header->prev ? header->prev->next : parent->child) != header) return 1;
+
+	if (header->prev) {
+		header->prev->next = header->next;
 	}
-	for (child = root->child; child; child = child->next) {
-		if (child->next == header) {
-			child->next = header->next;
-			header->next = NULL;
-			return 0;
-		}
-		if (child->child && sp_report_header_remove(child->child, header) == 0) {
-			return 0;
-		}
+	else {
+		parent->child = header->next;
+	}
+	if (header->next) {
+		header->next->prev = header->prev;
+	}
+	else {
+		parent->last_child = header->prev;
 	}
-	return 1;
+	/* the parent link is kept, so the header can be returned to the report
+	 * when it's freed */
+	header->next = NULL;
+	header->prev = NULL;
+	header_invalidate_layout(root);
+	return 0;
 }
 
 int sp_report_print_header(
@@ -489,21 +1189,41 @@ int sp_report_print_header(
 
 int sp_report_print_data(
 		FILE* fp,
-		const sp_report_header_t* root
+		sp_report_header_t* root
 		)
 {
-	sp_report_header_t* header;
+	struct sp_report_layout_t* layout = header_get_layout(root);
+	char data[MAX_COLUMN_SIZE];
+	char* ptr;
+	int i;
 
-	for (header = root->child; header; header = header->next) {
-		/* large target depth (0xFFFF) fill result in the lowest headers being called
-		 * for header_print_data, which is exactly what we need */
-		header_iterate_level(header, 0, 0xFFFF, header_print_data, fp);
-		if (header->next) {
-			fputc(' ', fp);
+	if (!layout) return -ENOMEM;
+
+	/* render the whole row into the row buffer */
+	ptr = layout->row;
+	for (i = 0; i < layout->op_count; i++) {
+		const layout_op_t* op = &layout->ops[i];
+		const sp_report_header_t* header = op->header;
+		if (header) {
+			int size;
+			if (header->value) {
+				sp_report_value_t value = {.type = SP_REPORT_VALUE_NA};
+				header->value(&value, header->data);
+				size = format_value(data, &value, &header->format);
+			}
+			else {
+				size = header->print(data, header->size, header->data);
+			}
+			if (size < 0) size = 0;
+			if (size > MAX_COLUMN_SIZE - 1) size = MAX_COLUMN_SIZE - 1;
+			write_aligned_text(ptr, data, size, header->size_print, header->alignment);
 		}
+		else {
+			memcpy(ptr, layout->text + op->offset, op->len);
+		}
+		ptr += op->len;
 	}
-	fputc('\n', fp);
-	return 0;
+	return write_buffer(fp, layout->row, ptr - layout->row);
 }
 
 
@@ -513,15 +1233,22 @@ int sp_report_header_set_color(
 		const char* color_postfix
 		)
 {
-	if (header->color_prefix) {
-		free(header->color_prefix);
-	}
-	if (header->color_postfix) {
-		free(header->color_postfix);
-	}
-	header->color_prefix = color_prefix ? strdup(color_prefix) : NULL;
-	header->color_postfix = color_postfix ? strdup(color_postfix) : NULL;
-	return 0;
+	int rc;
+	header_invalidate_layout(header);
+	if ( (rc = header_set_text(&header->color_prefix, header->color_prefix_buffer,
+			sizeof(header->color_prefix_buffer), color_prefix)) != 0) return rc;
+	return header_set_text(&header->color_postfix, header->color_postfix_buffer,
+			sizeof(header->color_postfix_buffer), color_postfix);
+}
+
+
+int sp_report_header_set_key(
+		sp_report_header_t* header,
+		const char* key
+		)
+{
+	header_invalidate_layout(header);
+	return header_set_text(&header->key, header->key_buffer, sizeof(header->key_buffer), key);
 }
 
 
@@ -532,13 +1259,143 @@ int sp_report_header_set_title(
 		int alignment
 		)
 {
-	if (header->title) free(header->title);
-	header->title = strdup(title);
-	if (header->title == NULL) {
-		return -ENOMEM;
+	int rc;
+	if ( (rc = header_set_text(&header->title, header->title_buffer, sizeof(header->title_buffer), title)) != 0) {
+		return rc;
 	}
 	header->size = size ? size : (int)strlen(title) + 1;
 	header->alignment = alignment;
+	header_invalidate_layout(header);
+
+	return 0;
+}
+
 
+int sp_report_print_header_csv(
+		FILE* fp,
+		sp_report_header_t* root
+		)
+{
+	struct sp_report_layout_t* layout = header_get_layout(root);
+	int i;
+
+	if (!layout) return -ENOMEM;
+	for (i = 0; i < layout->leaf_count; i++) {
+		print_csv_field(fp, layout->leaves[i].path, i);
+	}
+	fputc('\n', fp);
 	return 0;
 }
+
+
+int sp_report_print_data_csv(
+		FILE* fp,
+		sp_report_header_t* root
+		)
+{
+	struct sp_report_layout_t* layout = header_get_layout(root);
+	char buffer[MAX_COLUMN_SIZE];
+	sp_report_value_type_t type;
+	int i;
+
+	if (!layout) return -ENOMEM;
+	for (i = 0; i < layout->leaf_count; i++) {
+		print_csv_field(fp, header_write_value(buffer, layout->leaves[i].header, &type), i);
+	}
+	fputc('\n', fp);
+	return 0;
+}
+
+
+int sp_report_print_data_jsonl(
+		FILE* fp,
+		sp_report_header_t* root
+		)
+{
+	struct sp_report_layout_t* layout = header_get_layout(root);
+	char buffer[MAX_COLUMN_SIZE];
+	sp_report_value_type_t type;
+	int i;
+
+	if (!layout) return -ENOMEM;
+	fputc('{', fp);
+	for (i = 0; i < layout->leaf_count; i++) {
+		const char* value = header_write_value(buffer, layout->leaves[i].header, &type);
+		print_json_member(fp, layout->leaves[i].path, value, type, i);
+	}
+	fputs("}\n", fp);
+	return 0;
+}
+
+
+int sp_report_get_column_count(
+		sp_report_header_t* root
+		)
+{
+	struct sp_report_layout_t* layout = header_get_layout(root);
+	return layout ? layout->leaf_count : -ENOMEM;
+}
+
+
+const char* sp_report_get_column_key(
+		sp_report_header_t* root,
+		int index
+		)
+{
+	struct sp_report_layout_t* layout = header_get_layout(root);
+	if (!layout || index < 0 || index >= layout->leaf_count) return NULL;
+	return layout->leaves[index].path;
+}
+
+
+int sp_report_get_column_value(
+		sp_report_header_t* root,
+		int index,
+		sp_report_value_t* value,
+		char* buffer
+		)
+{
+	struct sp_report_layout_t* layout = header_get_layout(root);
+	if (!layout) return -ENOMEM;
+	if (index < 0 || index >= layout->leaf_count) return -EINVAL;
+
+	const sp_report_header_t* header = layout->leaves[index].header;
+	value->type = SP_REPORT_VALUE_NA;
+	if (header->value) {
+		header->value(value, header->data);
+		return 0;
+	}
+	int size = header->print(buffer, SP_REPORT_VALUE_BUFFER_SIZE - 1, header->data);
+	if (size < 0) size = 0;
+	if (size > SP_REPORT_VALUE_BUFFER_SIZE - 1) size = SP_REPORT_VALUE_BUFFER_SIZE - 1;
+	while (size && buffer[size - 1] == ' ') size--;
+	buffer[size] = '\0';
+	while (*buffer == ' ') buffer++;
+	if (*buffer) {
+		value->type = SP_REPORT_VALUE_STRING;
+		value->s = buffer;
+	}
+	return 0;
+}
+
+
+int sp_report_format_value(
+		char* buffer,
+		const sp_report_value_t* value,
+		const sp_report_format_t* format
+		)
+{
+	int len = format_value(buffer, value, format);
+	if (len > SP_REPORT_VALUE_BUFFER_SIZE - 1) len = SP_REPORT_VALUE_BUFFER_SIZE - 1;
+	buffer[len] = '\0';
+	return len;
+}
+
+
+unsigned sp_report_get_layout_version(
+		sp_report_header_t* root
+		)
+{
+	struct sp_report_layout_t* layout = header_get_layout(root);
+	return layout ? layout->version : 0;
+}
@@ -38,34 +38,99 @@
  *
  * Columns also can be dynamically added (of course the headers should
  * be reprinted before printing data for the new header structure).
+ *
+ * Besides the formatted table the data can be printed in machine readable
+ * CSV and JSON lines formats. There the columns are identified by their
+ * key paths - the keys of the column and its parent headers joined with
+ * dots, for example pid1547.dirty.
  */
 #ifndef SP_REPORT_H
 #define SP_REPORT_H
 
 #include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
 
-enum {
+typedef enum {
 	SP_REPORT_ALIGN_LEFT = 0,
 	SP_REPORT_ALIGN_RIGHT = 1,
 	SP_REPORT_ALIGN_CENTER = 2
 } sp_report_alignment_t;
 
+/* the cached row layout, see sp_report.c */
+struct sp_report_layout_t;
+
 /* the data printing template function */
 typedef int (*sp_report_cell_write_fn)(char* buffer, int size, void* arg);
 
+/* the text printed for unavailable values */
+#define SP_REPORT_NA_TEXT	"n/a"
+
+/**
+ * The cell value types.
+ */
+typedef enum {
+	SP_REPORT_VALUE_NA = 0,
+	SP_REPORT_VALUE_INT,
+	SP_REPORT_VALUE_DOUBLE,
+	SP_REPORT_VALUE_STRING
+} sp_report_value_type_t;
+
+/**
+ * The typed cell value.
+ */
+typedef struct sp_report_value_t {
+	sp_report_value_type_t type;
+	union {
+		int64_t i;
+		double d;
+		/* the string must stay valid until the row has been printed */
+		const char* s;
+	};
+} sp_report_value_t;
+
+/**
+ * The typed cell value formatting specification.
+ *
+ * The format applies only to the formatted table, machine readable
+ * formats print the raw values.
+ */
+typedef struct sp_report_format_t {
+	/* print '+' sign also for positive numbers and zero */
+	bool sign;
+	/* number of decimals printed for double values */
+	int precision;
+	/* the text printed after numbers, for example "%" or NULL */
+	const char* suffix;
+} sp_report_format_t;
+
+/* the typed value retrieval template function */
+typedef void (*sp_report_cell_value_fn)(sp_report_value_t* value, void* arg);
+
+/* the sizes of the header title and other text buffers embedded in the
+ * header structure, longer texts are allocated separately */
+#define SP_REPORT_TITLE_BUFFER_SIZE     48
+#define SP_REPORT_TEXT_BUFFER_SIZE      24
+
 /**
  * The column header structure.
  *
- * Column header structure must contain either printing function or
- * child headers.
+ * Column header structure must contain either printing function, typed
+ * value function or child headers.
  */
 typedef struct sp_report_header_t {
 	/* actual header size */
 	int size;
 	/* header title */
 	char* title;
+	/* header key for machine readable formats, derived from title if not set */
+	char* key;
 	/* column data printing function */
 	sp_report_cell_write_fn print;
+	/* column typed value function, used instead of print if set */
+	sp_report_cell_value_fn value;
+	/* typed value format */
+	sp_report_format_t format;
 
 	/* the header 'depth' - number of child rows */
 	int depth;
@@ -87,8 +152,23 @@ typedef struct sp_report_header_t {
 	/* next (sibling) header */
 	struct sp_report_header_t* next;
 
+	/* previous (sibling) header */
+	struct sp_report_header_t* prev;
+
 	/* first child header */
 	struct sp_report_header_t* child;
+
+	/* last child header */
+	struct sp_report_header_t* last_child;
+
+	/* the embedded title, key and color texts */
+	char title_buffer[SP_REPORT_TITLE_BUFFER_SIZE];
+	char key_buffer[SP_REPORT_TEXT_BUFFER_SIZE];
+	char color_prefix_buffer[SP_REPORT_TEXT_BUFFER_SIZE];
+	char color_postfix_buffer[SP_REPORT_TEXT_BUFFER_SIZE];
+
+	/* flattened row layout, used only in the root header */
+	struct sp_report_layout_t* layout;
 } sp_report_header_t;
 
 
@@ -137,6 +217,33 @@ sp_report_header_t* sp_report_header_add_sibling(
 		);
 
 
+/**
+ * Adds a new child column with typed values to the specified header.
+ *
+ * Typed values are formatted by the report itself, without the
+ * intermediate text, and are printed as raw values in machine readable
+ * formats.
+ * @param[in] header    the parent header.
+ * @param[in] title     the new header title.
+ * @param[in] size      the new header size. Length of the title (increased by 1) is
+ *                      be used if size is 0.
+ * @param[in] alignment the column alignment (see sp_report_alignment_t enum).
+ * @param[in] value     the value function.
+ * @param[in] format    the value format, NULL for the default format.
+ * @param[in] data      the value function argument.
+ * @return              the created header or NULL in the case of failure.
+ */
+sp_report_header_t* sp_report_header_add_value_child(
+		sp_report_header_t* header,
+		const char* title,
+		int size,
+		int alignment,
+		sp_report_cell_value_fn value,
+		const sp_report_format_t* format,
+		void* data
+		);
+
+
 /**
  * Sets header (column) color.
  *
@@ -169,9 +276,26 @@ int sp_report_header_set_title(
 		int alignment
 		);
 
+/**
+ * Sets header key.
+ *
+ * The key identifies the header in machine readable formats. If the key is
+ * not set, it is derived from the header title by replacing non-alphanumeric
+ * characters with underscores.
+ * @param[in] header   the header.
+ * @param[in] key      the header key.
+ * @return             0 for success.
+ */
+int sp_report_header_set_key(
+		sp_report_header_t* header,
+		const char* key
+		);
+
 /**
  * Removes header from the report.
  *
+ * The header is unlinked in constant time, so it must be freed with
+ * sp_report_header_free() before the report is freed.
  * @param[in] root    the report root header.
  * @param[in] header  the header to remove.
  * @return            0 if the header was successfully removed.
@@ -185,6 +309,8 @@ int sp_report_header_remove(
 /**
  * Frees header together with its siblings and children.
  *
+ * The freed headers are kept by the report root for reuse until the
+ * report is freed with sp_report_free().
  * @param[in] header   the root header.
  */
 void sp_report_header_free(
@@ -192,6 +318,17 @@ void sp_report_header_free(
 		);
 
 
+/**
+ * Frees the report headers, the reusable headers and the cached row layout.
+ *
+ * The root header itself is not freed.
+ * @param[in] root   the report root header.
+ */
+void sp_report_free(
+		sp_report_header_t* root
+		);
+
+
 /**
  * Prints formatted data header described by the header structure.
  *
@@ -207,16 +344,127 @@ int sp_report_print_header(
 /**
  * Prints data described by the header structure.
  *
+ * The header structure is flattened into a row layout on the first call
+ * after the headers have been changed. The row is rendered into a single
+ * buffer and written with one write() call after flushing the file
+ * buffers.
  * @param[in] fp    the output file.
  * @param[in] root  the root of header structure.
  * @return          0 for success.
  */
-
 int sp_report_print_data(
 		FILE* fp,
-		const sp_report_header_t* root
+		sp_report_header_t* root
+		);
+
+
+/**
+ * Prints CSV header line containing the column key paths.
+ *
+ * @param[in] fp    the output file.
+ * @param[in] root  the root of header structure.
+ * @return          0 for success.
+ */
+int sp_report_print_header_csv(
+		FILE* fp,
+		sp_report_header_t* root
 		);
 
+/**
+ * Prints data described by the header structure as a CSV line.
+ *
+ * The values are printed without padding, empty values are left empty.
+ * @param[in] fp    the output file.
+ * @param[in] root  the root of header structure.
+ * @return          0 for success.
+ */
+int sp_report_print_data_csv(
+		FILE* fp,
+		sp_report_header_t* root
+		);
 
+/**
+ * Prints data described by the header structure as a JSON object line.
+ *
+ * The values are keyed by the column key paths. Numeric values are
+ * printed as numbers, empty values as null and the rest as strings.
+ * @param[in] fp    the output file.
+ * @param[in] root  the root of header structure.
+ * @return          0 for success.
+ */
+int sp_report_print_data_jsonl(
+		FILE* fp,
+		sp_report_header_t* root
+		);
+
+
+/* the size of the text buffer for sp_report_get_column_value() */
+#define SP_REPORT_VALUE_BUFFER_SIZE     256
+
+/**
+ * Returns the number of data columns.
+ *
+ * The data columns are the leaf headers in the printing order.
+ * @param[in] root  the root of header structure.
+ * @return          the number of data columns or negative error code.
+ */
+int sp_report_get_column_count(
+		sp_report_header_t* root
+		);
+
+/**
+ * Returns the key path of a data column.
+ *
+ * @param[in] root   the root of header structure.
+ * @param[in] index  the data column index.
+ * @return           the key path or NULL if the index is out of range.
+ */
+const char* sp_report_get_column_key(
+		sp_report_header_t* root,
+		int index
+		);
+
+/**
+ * Retrieves the current value of a data column.
+ *
+ * Text columns are returned as string values, or n/a if empty.
+ * @param[in] root     the root of header structure.
+ * @param[in] index    the data column index.
+ * @param[out] value   the value.
+ * @param[out] buffer  the buffer of SP_REPORT_VALUE_BUFFER_SIZE bytes
+ *                     for string values.
+ * @return             0 for success.
+ */
+int sp_report_get_column_value(
+		sp_report_header_t* root,
+		int index,
+		sp_report_value_t* value,
+		char* buffer
+		);
+
+/**
+ * Formats a typed value as it's printed in the report.
+ *
+ * @param[out] buffer  the buffer of SP_REPORT_VALUE_BUFFER_SIZE bytes.
+ * @param[in] value    the value.
+ * @param[in] format   the value format.
+ * @return             the length of the zero terminated text.
+ */
+int sp_report_format_value(
+		char* buffer,
+		const sp_report_value_t* value,
+		const sp_report_format_t* format
+		);
+
+/**
+ * Returns the data column layout version.
+ *
+ * The version changes whenever the data columns might have changed.
+ * @param[in] root  the root of header structure.
+ * @return          the layout version.
+ */
+unsigned sp_report_get_layout_version(
+		sp_report_header_t* root
+		);
 
 #endif
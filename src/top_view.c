@@ -0,0 +1,361 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "top_view.h"
+
+/**
+ * Private API
+ */
+
+/* the screen size used when the terminal size is not available */
+#define DEFAULT_ROWS    24
+#define DEFAULT_COLS    80
+
+/* unchanged cells between two changed spans are rewritten instead of
+ * moving the cursor if there are less of them than this, as the cursor
+ * positioning sequence is about as long */
+#define SPAN_MERGE_GAP  8
+
+#define ESC_ENTER       "\033[?1049h\033[?25l"
+#define ESC_LEAVE       "\033[m\033[?25h\033[?1049l"
+#define ESC_CLEAR       "\033[m\033[H\033[2J"
+#define ESC_HIGHLIGHT   "\033[7m"
+#define ESC_NORMAL      "\033[m"
+
+/**
+ * Appends data to the terminal output buffer.
+ *
+ * @param[in] self   the view.
+ * @param[in] data   the data.
+ * @param[in] len    the data length.
+ * @return           0 for success.
+ */
+static int out_append(
+		top_view_t* self,
+		const char* data,
+		int len
+		)
+{
+	if (self->out_size + len > self->out_capacity) {
+		int capacity = self->out_capacity ? self->out_capacity : 4096;
+		while (capacity < self->out_size + len) capacity *= 2;
+		char* out = realloc(self->out, capacity);
+		if (!out) return -ENOMEM;
+		self->out = out;
+		self->out_capacity = capacity;
+	}
+	memcpy(self->out + self->out_size, data, len);
+	self->out_size += len;
+	return 0;
+}
+
+/**
+ * Writes the terminal output buffer to the terminal.
+ *
+ * @param[in] self   the view.
+ * @return           0 for success.
+ */
+static int out_write(
+		top_view_t* self
+		)
+{
+	const char* ptr = self->out;
+	int len = self->out_size;
+	while (len) {
+		ssize_t written = write(self->fd, ptr, len);
+		if (written == -1) {
+			if (errno == EINTR) continue;
+			return -errno;
+		}
+		ptr += written;
+		len -= written;
+	}
+	self->bytes_written += self->out_size;
+	self->out_size = 0;
+	return 0;
+}
+
+/**
+ * Appends a span of the drawn row to the terminal output buffer.
+ *
+ * @param[in] self       the view.
+ * @param[in] row        the row.
+ * @param[in] start      the first column of the span.
+ * @param[in] end        the column after the span.
+ * @param[in,out] cursor the cursor position as row * cols + col, -1 if
+ *                       unknown.
+ * @return               0 for success.
+ */
+static int out_append_span(
+		top_view_t* self,
+		int row,
+		int start,
+		int end,
+		int* cursor
+		)
+{
+	bool highlight = self->back_highlight[row];
+	int rc;
+
+	if (*cursor != row * self->cols + start) {
+		char buffer[32];
+		int len = sprintf(buffer, "\033[%d;%dH", row + 1, start + 1);
+		if ( (rc = out_append(self, buffer, len)) != 0) return rc;
+	}
+	if (highlight && (rc = out_append(self, ESC_HIGHLIGHT, sizeof(ESC_HIGHLIGHT) - 1)) != 0) return rc;
+	if ( (rc = out_append(self, self->back + row * self->cols + start, end - start)) != 0) return rc;
+	if (highlight && (rc = out_append(self, ESC_NORMAL, sizeof(ESC_NORMAL) - 1)) != 0) return rc;
+	/* the cursor position is unknown after writing the last column */
+	*cursor = end < self->cols ? row * self->cols + end : -1;
+	return 0;
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int top_view_init(
+		top_view_t* self,
+		int fd,
+		int input_fd
+		)
+{
+	int rc;
+
+	memset(self, 0, sizeof(*self));
+	self->fd = fd;
+	self->input_fd = -1;
+	if ( (rc = top_view_resize(self)) != 0) return rc;
+
+	if (isatty(input_fd) && tcgetattr(input_fd, &self->termios) == 0) {
+		struct termios termios = self->termios;
+		/* keep ISIG, so Ctrl-C still works */
+		termios.c_lflag &= ~(ICANON | ECHO);
+		termios.c_cc[VMIN] = 0;
+		termios.c_cc[VTIME] = 0;
+		if (tcsetattr(input_fd, TCSANOW, &termios) == 0) self->input_fd = input_fd;
+	}
+	if ( (rc = out_append(self, ESC_ENTER, sizeof(ESC_ENTER) - 1)) != 0) return rc;
+	return out_write(self);
+}
+
+
+int top_view_resize(
+		top_view_t* self
+		)
+{
+	struct winsize size;
+	int rows = DEFAULT_ROWS, cols = DEFAULT_COLS;
+
+	if (ioctl(self->fd, TIOCGWINSZ, &size) == 0 && size.ws_row && size.ws_col) {
+		rows = size.ws_row;
+		cols = size.ws_col;
+	}
+	return top_view_set_size(self, rows, cols);
+}
+
+
+int top_view_set_size(
+		top_view_t* self,
+		int rows,
+		int cols
+		)
+{
+	if (rows != self->rows || cols != self->cols || !self->front) {
+		char* front = realloc(self->front, rows * cols);
+		if (front) self->front = front;
+		char* back = realloc(self->back, rows * cols);
+		if (back) self->back = back;
+		bool* front_highlight = realloc(self->front_highlight, rows * sizeof(bool));
+		if (front_highlight) self->front_highlight = front_highlight;
+		bool* back_highlight = realloc(self->back_highlight, rows * sizeof(bool));
+		if (back_highlight) self->back_highlight = back_highlight;
+		if (!front || !back || !front_highlight || !back_highlight) return -ENOMEM;
+		self->rows = rows;
+		self->cols = cols;
+	}
+	self->is_invalid = true;
+	top_view_clear(self);
+	return 0;
+}
+
+
+void top_view_clear(
+		top_view_t* self
+		)
+{
+	memset(self->back, ' ', self->rows * self->cols);
+	memset(self->back_highlight, 0, self->rows * sizeof(bool));
+}
+
+
+void top_view_write(
+		top_view_t* self,
+		int row,
+		int col,
+		const char* text,
+		int len
+		)
+{
+	if (row < 0 || row >= self->rows || col < 0 || col >= self->cols) return;
+	/* writing the bottom right corner could scroll the screen */
+	int size = self->cols - col - (row == self->rows - 1);
+	if (len > size) len = size;
+	char* ptr = self->back + row * self->cols + col;
+	while (len-- > 0) {
+		char c = *text++;
+		*ptr++ = (unsigned char)c < ' ' || c == 0x7f ? '?' : c;
+	}
+}
+
+
+int top_view_printf(
+		top_view_t* self,
+		int row,
+		int col,
+		const char* format,
+		...
+		)
+{
+	char buffer[1024];
+	va_list ap;
+
+	va_start(ap, format);
+	int len = vsnprintf(buffer, sizeof(buffer), format, ap);
+	va_end(ap);
+	if (len < 0) return 0;
+	if (len >= (int)sizeof(buffer)) len = sizeof(buffer) - 1;
+	top_view_write(self, row, col, buffer, len);
+	return len;
+}
+
+
+void top_view_highlight(
+		top_view_t* self,
+		int row
+		)
+{
+	if (row >= 0 && row < self->rows) self->back_highlight[row] = true;
+}
+
+
+int top_view_flush(
+		top_view_t* self
+		)
+{
+	int row, col, cursor = -1, rc;
+
+	if (self->is_invalid) {
+		if ( (rc = out_append(self, ESC_CLEAR, sizeof(ESC_CLEAR) - 1)) != 0) return rc;
+		memset(self->front, ' ', self->rows * self->cols);
+		memset(self->front_highlight, 0, self->rows * sizeof(bool));
+		self->is_invalid = false;
+		cursor = 0;
+	}
+	for (row = 0; row < self->rows; row++) {
+		const char* front = self->front + row * self->cols;
+		const char* back = self->back + row * self->cols;
+		int start = -1, end = 0;
+
+		/* the highlighting covers whole rows */
+		if (self->front_highlight[row] != self->back_highlight[row]) {
+			if ( (rc = out_append_span(self, row, 0, self->cols - (row == self->rows - 1), &cursor)) != 0) return rc;
+			continue;
+		}
+		for (col = 0; col < self->cols; col++) {
+			if (front[col] == back[col]) continue;
+			if (start != -1 && col - end >= SPAN_MERGE_GAP) {
+				if ( (rc = out_append_span(self, row, start, end, &cursor)) != 0) return rc;
+				start = -1;
+			}
+			if (start == -1) start = col;
+			end = col + 1;
+		}
+		if (start != -1 && (rc = out_append_span(self, row, start, end, &cursor)) != 0) return rc;
+	}
+	memcpy(self->front, self->back, self->rows * self->cols);
+	memcpy(self->front_highlight, self->back_highlight, self->rows * sizeof(bool));
+	return out_write(self);
+}
+
+
+int top_view_read_key(
+		top_view_t* self
+		)
+{
+	unsigned char buffer[8];
+	ssize_t len;
+
+	if (self->input_fd == -1) return TOP_VIEW_NO_KEY;
+	if ( (len = read(self->input_fd, buffer, 1)) != 1) return TOP_VIEW_NO_KEY;
+	if (buffer[0] != '\033') return buffer[0];
+
+	/* the cursor keys are sent as escape sequences, which arrive at once */
+	if ( (len = read(self->input_fd, buffer + 1, sizeof(buffer) - 2)) <= 0) return buffer[0];
+	buffer[len + 1] = '\0';
+	if (!strcmp((char*)buffer, "\033[A")) return TOP_VIEW_KEY_UP;
+	if (!strcmp((char*)buffer, "\033[B")) return TOP_VIEW_KEY_DOWN;
+	if (!strcmp((char*)buffer, "\033[5~")) return TOP_VIEW_KEY_PAGE_UP;
+	if (!strcmp((char*)buffer, "\033[6~")) return TOP_VIEW_KEY_PAGE_DOWN;
+	return TOP_VIEW_NO_KEY;
+}
+
+
+void top_view_restore(
+		const top_view_t* self
+		)
+{
+	if (!self->front) return;
+	const char* ptr = ESC_LEAVE;
+	int len = sizeof(ESC_LEAVE) - 1;
+	while (len) {
+		ssize_t written = write(self->fd, ptr, len);
+		if (written == -1) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		ptr += written;
+		len -= written;
+	}
+	if (self->input_fd != -1) tcsetattr(self->input_fd, TCSANOW, &self->termios);
+}
+
+
+void top_view_release(
+		top_view_t* self
+		)
+{
+	top_view_restore(self);
+	free(self->front);
+	free(self->back);
+	free(self->front_highlight);
+	free(self->back_highlight);
+	free(self->out);
+	memset(self, 0, sizeof(*self));
+	self->fd = self->input_fd = -1;
+}
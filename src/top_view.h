@@ -0,0 +1,214 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+/** @file top_view.h
+ * Full screen terminal view updated in place.
+ *
+ * The screen contents are drawn into a character buffer, which is
+ * compared with the contents already shown on the terminal. Only the
+ * changed spans of each line are sent to the terminal, prefixed with
+ * a cursor positioning sequence when the cursor is not already there.
+ * Rows can be highlighted with reverse video as a whole.
+ *
+ * The terminal is switched into the alternate screen and the input
+ * into non-canonical mode without echo, so single key presses can be
+ * read without waiting for enter.
+ */
+#ifndef TOP_VIEW_H
+#define TOP_VIEW_H
+
+#include <stdbool.h>
+#include <termios.h>
+
+/* the key value returned when no key has been pressed */
+#define TOP_VIEW_NO_KEY         -1
+
+/* the cursor movement keys, other keys are returned as characters */
+#define TOP_VIEW_KEY_UP         0x101
+#define TOP_VIEW_KEY_DOWN       0x102
+#define TOP_VIEW_KEY_PAGE_UP    0x103
+#define TOP_VIEW_KEY_PAGE_DOWN  0x104
+
+/**
+ * The terminal view.
+ */
+typedef struct top_view_t {
+	/* the terminal output and input descriptors, input is -1 if
+	 * it's not a terminal */
+	int fd;
+	int input_fd;
+	/* the original input terminal settings */
+	struct termios termios;
+
+	/* the screen size */
+	int rows;
+	int cols;
+
+	/* the contents shown on the terminal and the contents being drawn */
+	char* front;
+	char* back;
+	/* the row highlighting of the shown and drawn contents */
+	bool* front_highlight;
+	bool* back_highlight;
+
+	/* the terminal contents are unknown and must be redrawn */
+	bool is_invalid;
+
+	/* the terminal output buffer */
+	char* out;
+	int out_size;
+	int out_capacity;
+
+	/* number of bytes written to the terminal */
+	unsigned long long bytes_written;
+} top_view_t;
+
+
+/**
+ * Initializes the view and switches the terminal to full screen mode.
+ *
+ * @param[in] self      the view.
+ * @param[in] fd        the terminal output descriptor.
+ * @param[in] input_fd  the key input descriptor, ignored unless it's
+ *                      a terminal.
+ * @return              0 for success.
+ */
+int top_view_init(
+		top_view_t* self,
+		int fd,
+		int input_fd
+		);
+
+/**
+ * Updates the view size from the terminal.
+ *
+ * The whole screen is redrawn at the next flush.
+ * @param[in] self   the view.
+ * @return           0 for success.
+ */
+int top_view_resize(
+		top_view_t* self
+		);
+
+/**
+ * Sets the view size.
+ *
+ * The whole screen is redrawn at the next flush.
+ * @param[in] self   the view.
+ * @param[in] rows   the number of rows.
+ * @param[in] cols   the number of columns.
+ * @return           0 for success.
+ */
+int top_view_set_size(
+		top_view_t* self,
+		int rows,
+		int cols
+		);
+
+/**
+ * Starts drawing a new screen by clearing the drawn contents.
+ *
+ * @param[in] self   the view.
+ */
+void top_view_clear(
+		top_view_t* self
+		);
+
+/**
+ * Writes text into the drawn contents.
+ *
+ * The text is clipped at the end of the row.
+ * @param[in] self   the view.
+ * @param[in] row    the row.
+ * @param[in] col    the column.
+ * @param[in] text   the text.
+ * @param[in] len    the text length.
+ */
+void top_view_write(
+		top_view_t* self,
+		int row,
+		int col,
+		const char* text,
+		int len
+		);
+
+/**
+ * Writes formatted text into the drawn contents.
+ *
+ * @param[in] self   the view.
+ * @param[in] row    the row.
+ * @param[in] col    the column.
+ * @param[in] format the printf style format.
+ * @return           the number of characters written.
+ */
+int top_view_printf(
+		top_view_t* self,
+		int row,
+		int col,
+		const char* format,
+		...
+		) __attribute__((format(printf, 4, 5)));
+
+/**
+ * Highlights the drawn row with reverse video.
+ *
+ * @param[in] self   the view.
+ * @param[in] row    the row.
+ */
+void top_view_highlight(
+		top_view_t* self,
+		int row
+		);
+
+/**
+ * Sends the changes of the drawn contents to the terminal.
+ *
+ * @param[in] self   the view.
+ * @return           0 for success.
+ */
+int top_view_flush(
+		top_view_t* self
+		);
+
+/**
+ * Reads a key press without blocking.
+ *
+ * @param[in] self   the view.
+ * @return           the key or TOP_VIEW_NO_KEY.
+ */
+int top_view_read_key(
+		top_view_t* self
+		);
+
+/**
+ * Restores the terminal without releasing the view resources.
+ *
+ * Only async-signal-safe functions are used, so the terminal can be
+ * restored from a signal handler before _exit().
+ * @param[in] self   the view.
+ */
+void top_view_restore(
+		const top_view_t* self
+		);
+
+/**
+ * Restores the terminal and releases the view resources.
+ *
+ * @param[in] self   the view.
+ */
+void top_view_release(
+		top_view_t* self
+		);
+
+#endif
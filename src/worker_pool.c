@@ -0,0 +1,151 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+
+#include "worker_pool.h"
+
+/**
+ * Private API
+ */
+
+/**
+ * Runs the tasks of the current batch until all indices are taken.
+ *
+ * @param[in] self    the worker pool.
+ */
+static void
+run_tasks(worker_pool_t* self)
+{
+	int index;
+	while ( (index = __atomic_fetch_add(&self->next, 1, __ATOMIC_RELAXED)) < self->count) {
+		self->task(index, self->arg);
+	}
+}
+
+/**
+ * The worker thread.
+ */
+static void*
+worker_thread(void* arg)
+{
+	worker_pool_t* self = (worker_pool_t*)arg;
+	unsigned generation = 0;
+
+	pthread_mutex_lock(&self->mutex);
+	while (true) {
+		while (!self->quit && self->generation == generation) {
+			pthread_cond_wait(&self->start_cond, &self->mutex);
+		}
+		if (self->quit) break;
+		generation = self->generation;
+		pthread_mutex_unlock(&self->mutex);
+
+		run_tasks(self);
+
+		pthread_mutex_lock(&self->mutex);
+		if (--self->active == 0) pthread_cond_signal(&self->done_cond);
+	}
+	pthread_mutex_unlock(&self->mutex);
+	return NULL;
+}
+
+
+/**
+ * Public API
+ *
+ * See header for specifications.
+ */
+
+int
+worker_pool_init(worker_pool_t* self, int jobs)
+{
+	sigset_t all, old;
+	int rc = 0;
+
+	memset(self, 0, sizeof(worker_pool_t));
+	pthread_mutex_init(&self->mutex, NULL);
+	pthread_cond_init(&self->start_cond, NULL);
+	pthread_cond_init(&self->done_cond, NULL);
+	if (jobs < 2) return 0;
+
+	self->threads = (pthread_t*)malloc((jobs - 1) * sizeof(pthread_t));
+	if (!self->threads) return -ENOMEM;
+
+	/* the created threads inherit the signal mask */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	while (self->thread_count < jobs - 1) {
+		if ( (rc = pthread_create(&self->threads[self->thread_count], NULL, worker_thread, self)) != 0) {
+			rc = -rc;
+			break;
+		}
+		self->thread_count++;
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (rc != 0) worker_pool_free(self);
+	return rc;
+}
+
+
+void
+worker_pool_run(worker_pool_t* self, int count, worker_pool_task_t task, void* arg)
+{
+	pthread_mutex_lock(&self->mutex);
+	self->task = task;
+	self->arg = arg;
+	self->count = count;
+	self->next = 0;
+	self->active = self->thread_count;
+	self->generation++;
+	pthread_cond_broadcast(&self->start_cond);
+	pthread_mutex_unlock(&self->mutex);
+
+	run_tasks(self);
+
+	pthread_mutex_lock(&self->mutex);
+	while (self->active) {
+		pthread_cond_wait(&self->done_cond, &self->mutex);
+	}
+	pthread_mutex_unlock(&self->mutex);
+}
+
+
+void
+worker_pool_free(worker_pool_t* self)
+{
+	int i;
+	pthread_mutex_lock(&self->mutex);
+	self->quit = true;
+	pthread_cond_broadcast(&self->start_cond);
+	pthread_mutex_unlock(&self->mutex);
+
+	for (i = 0; i < self->thread_count; i++) {
+		pthread_join(self->threads[i], NULL);
+	}
+	free(self->threads);
+	self->threads = NULL;
+	self->thread_count = 0;
+
+	pthread_cond_destroy(&self->done_cond);
+	pthread_cond_destroy(&self->start_cond);
+	pthread_mutex_destroy(&self->mutex);
+}
@@ -0,0 +1,102 @@
+/*
+ * This file is a part of sp-memusage.
+ *
+ * Copyright (C) 2026 by the sp-memusage contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * General Public License for more details.
+ */
+/** @file worker_pool.h
+ * Fixed size thread pool for running indexed tasks in parallel.
+ *
+ * worker_pool_run() calls the task function once for every index in
+ * range 0..count-1, distributing the indices between the worker threads
+ * and the calling thread, and returns when all the tasks are done.
+ */
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+/**
+ * The task function.
+ *
+ * @param[in] index   the task index.
+ * @param[in] arg     the argument given to worker_pool_run().
+ */
+typedef void (*worker_pool_task_t)(int index, void* arg);
+
+/**
+ * The worker pool.
+ */
+typedef struct worker_pool_t {
+	pthread_t* threads;
+	int thread_count;
+
+	pthread_mutex_t mutex;
+	/* signalled when a new batch of tasks is started */
+	pthread_cond_t start_cond;
+	/* signalled when the last worker has finished the batch */
+	pthread_cond_t done_cond;
+
+	/* the current batch */
+	worker_pool_task_t task;
+	void* arg;
+	int count;
+	/* the next task index, taken atomically */
+	int next;
+	/* number of workers still working on the current batch */
+	int active;
+	/* incremented for every batch */
+	unsigned generation;
+
+	bool quit;
+} worker_pool_t;
+
+/**
+ * Creates the worker threads.
+ *
+ * The worker threads block all signals, so the signals are delivered to
+ * the other threads.
+ * @param[out] self   the worker pool.
+ * @param[in] jobs    the number of parallel jobs, including the thread
+ *                    calling worker_pool_run().
+ * @return            0 for success, negative error code otherwise.
+ */
+int worker_pool_init(
+		worker_pool_t* self,
+		int jobs
+		);
+
+/**
+ * Runs the tasks and waits until all of them are done.
+ *
+ * @param[in] self    the worker pool.
+ * @param[in] count   the number of tasks.
+ * @param[in] task    the task function.
+ * @param[in] arg     the task function argument.
+ */
+void worker_pool_run(
+		worker_pool_t* self,
+		int count,
+		worker_pool_task_t task,
+		void* arg
+		);
+
+/**
+ * Stops the worker threads and frees the pool resources.
+ *
+ * @param[in] self    the worker pool.
+ */
+void worker_pool_free(
+		worker_pool_t* self
+		);
+
+#endif
@@ -0,0 +1,21 @@
+#!/bin/sh -e
+dump=mem-cpu-monitor-test.dump
+
+exit_cleanup ()
+{
+	rm -f $dump
+}
+trap exit_cleanup EXIT
+
+# the samples are dumped at exit
+mem-cpu-monitor -i 0.5 --self --flight-recorder=10 --dump-file=$dump > /dev/null &
+pid=$!
+sleep 3
+kill -TERM $pid
+wait $pid || true
+
+# the replayed dump has the notice and time lines with milliseconds
+mem-cpu-monitor --replay=$dump | grep -q '^# flight recorder dump'
+mem-cpu-monitor --replay=$dump | grep -q '^[0-9]\+:[0-9]\+:[0-9]\+\.[0-9]\{3\} '
+# the CSV replay has the epoch timestamps
+mem-cpu-monitor --replay=$dump --format=csv | grep -q '^[0-9]\+\.[0-9]\{3\},'
@@ -0,0 +1,21 @@
+#!/bin/sh -e
+# records, profiles and counts the allocations of a command with mallinfo
+# and replays the recorded allocation traces
+mallinfo=${MALLINFO_LIB:-/usr/lib/mallinfo.so}
+dir=$(mktemp -d)
+
+exit_cleanup ()
+{
+	rm -rf $dir
+}
+trap exit_cleanup EXIT
+
+HOME=$dir MALLINFO=period=1,counters=1,profile=4096,record=1 LD_PRELOAD=$mallinfo \
+	ls -lR /usr/share > /dev/null 2>&1
+
+# the report has the allocation counter columns
+grep -q 'allocs' $dir/mallinfo-*.trace
+# the heap profile is written at exit
+grep -q '^heap profile:' $dir/mallinfo-*.heap
+# the allocation traces are replayed
+mallinfo-replay $dir/mallinfo-*.alloc | grep -q '^Replay:'
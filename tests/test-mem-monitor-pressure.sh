@@ -0,0 +1,21 @@
+#!/bin/sh -e
+log=mem-monitor-test.log
+
+exit_cleanup ()
+{
+	rm -f $log
+}
+trap exit_cleanup EXIT
+
+if [ ! -e /proc/pressure/memory ]; then
+	echo "/proc/pressure/memory is not available, skipping"
+	exit 0
+fi
+
+# the heartbeat lines are printed every second
+mem-monitor --pressure 1 > $log &
+pid=$!
+sleep 3
+kill -TERM $pid
+wait $pid || true
+grep -q '^[0-9]\+:[0-9]\+:[0-9]\+	' $log
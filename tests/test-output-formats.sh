@@ -0,0 +1,23 @@
+#!/bin/sh -e
+log=mem-cpu-monitor-test.csv
+jsonl=mem-cpu-monitor-test.jsonl
+
+exit_cleanup ()
+{
+	rm -f $log $jsonl
+}
+trap exit_cleanup EXIT
+
+mem-cpu-monitor -i 1 --self --format=csv > $log &
+pid=$!
+mem-cpu-monitor -i 1 --self --format=jsonl > $jsonl &
+pid2=$!
+sleep 4
+kill -TERM $pid $pid2
+wait $pid $pid2 || true
+
+# the CSV header and rows with the epoch timestamp
+grep -q '^time,' $log
+grep -q '^[0-9]\+\.[0-9]\{3\},' $log
+# a JSON object for every sample
+grep -q '^{"time":[0-9]\+\.[0-9]\{3\},' $jsonl
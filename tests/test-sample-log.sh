@@ -0,0 +1,35 @@
+#!/bin/sh -e
+log=mem-cpu-monitor-test.log
+relog=mem-cpu-monitor-test-relog.log
+corrupt=mem-cpu-monitor-test-corrupt.log
+
+exit_cleanup ()
+{
+	rm -f $log $relog $relog.csv $corrupt
+}
+trap exit_cleanup EXIT
+
+mem-cpu-monitor -i 1 --self --format=log > $log &
+pid=$!
+sleep 4
+kill -TERM $pid
+wait $pid || true
+
+# the replayed text has time lines
+mem-cpu-monitor --replay=$log | grep -q '^[0-9]\+:[0-9]\+:[0-9]\+ '
+# the samples are kept when the log is replayed into a log
+mem-cpu-monitor --replay=$log --format=log > $relog
+mem-cpu-monitor --replay=$log --format=csv > $relog.csv
+mem-cpu-monitor --replay=$relog --format=csv | cmp -s - $relog.csv
+
+# corrupt logs are rejected, not crashed on
+size=$(wc -c < $log)
+offset=0
+while [ $offset -lt $size ]; do
+	cp $log $corrupt
+	printf '\377' | dd of=$corrupt bs=1 seek=$offset conv=notrunc 2>/dev/null
+	rc=0
+	mem-cpu-monitor --replay=$corrupt > /dev/null 2>&1 || rc=$?
+	[ $rc -lt 128 ]
+	offset=$((offset + 1))
+done